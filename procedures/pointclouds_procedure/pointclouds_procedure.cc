@@ -9,6 +9,7 @@
 #include "fj_vector.h"
 #include "fj_volume.h"
 
+#include <vector>
 #include <cstring>
 #include <cfloat>
 
@@ -156,27 +157,32 @@ static int FillWithPointClouds(Volume *volume,
       (ymax - ymin + 1) *
       (zmax - zmin + 1));
 
+  // noise is evaluated for a whole scanline of voxels at once
+  const int row_size = xmax >= xmin ? xmax - xmin + 1 : 0;
+  std::vector<double> distance(row_size);
+  std::vector<float> noise(row_size);
+  std::vector<float> P_noise_x(row_size);
+  std::vector<float> P_noise_y(row_size);
+  std::vector<float> P_noise_z(row_size);
+  std::vector<int> noise_index(row_size);
+
   for (k = zmin; k <= zmax; k++) {
     for (j = ymin; j <= ymax; j++) {
-      for (i = xmin; i <= xmax; i++) {
-        double sphere_func = 0;
-        double noise_func = 0;
-        double pyro_func = 0;
-        double distance = 0;
+      int noise_count = 0;
 
+      for (i = xmin; i <= xmax; i++) {
         Vector cell_center;
         Vector P_local_space;
         Vector P_noise_space;
-        float pyro_value = 0;
         float value = 0;
 
         cell_center = volume->IndexToPoint(i, j, k);
         P_local_space.x =  cell_center.x - cp->orig.x;
         P_local_space.y =  cell_center.y - cp->orig.y;
         P_local_space.z =  cell_center.z - cp->orig.z;
-        distance = Length(P_local_space);
+        distance[i - xmin] = Length(P_local_space);
 
-        if (distance < cp->radius - thresholdwidth) {
+        if (distance[i - xmin] < cp->radius - thresholdwidth) {
           value = volume->GetValue(i, j, k);
           volume->SetValue(i, j, k, Max(value, cp->density));
           progress.Increment();
@@ -189,12 +195,35 @@ static int FillWithPointClouds(Volume *volume,
         P_noise_space.y += cp->noise_space.y;
         P_noise_space.z += cp->noise_space.z;
 
-        noise_func = turbulence->Evaluate(P_noise_space);
+        P_noise_x[noise_count] = P_noise_space.x;
+        P_noise_y[noise_count] = P_noise_space.y;
+        P_noise_z[noise_count] = P_noise_space.z;
+        noise_index[noise_count] = i;
+        noise_count++;
+      }
+
+      if (noise_count == 0) {
+        continue;
+      }
+
+      turbulence->EvaluateBatch(&P_noise_x[0], &P_noise_y[0], &P_noise_z[0],
+          &noise[0], noise_count);
+
+      for (int n = 0; n < noise_count; n++) {
+        double sphere_func = 0;
+        double noise_func = 0;
+        double pyro_func = 0;
+        float pyro_value = 0;
+        float value = 0;
+
+        i = noise_index[n];
+
+        noise_func = noise[n];
         noise_func = Abs(noise_func);
         noise_func = Gamma(noise_func, .5);
         noise_func *= cp->noise_amplitude;
 
-        sphere_func = distance - cp->radius;
+        sphere_func = distance[i - xmin] - cp->radius;
         pyro_func = sphere_func - noise_func;
         pyro_value = Fit(pyro_func, -thresholdwidth, thresholdwidth, 1, 0);
         pyro_value *= cp->density;
@@ -161,6 +161,13 @@ static int FillWithSpecksAlongLine(Volume *volume,
     const WispsControlPoint *cp0, const WispsControlPoint *cp1,
     const Turbulence *turbulence)
 {
+  // specks are generated in batches so noise is evaluated at once
+  const int BATCH_SIZE = 256;
+  WispsControlPoint cp_t[BATCH_SIZE];
+  Vector P_speck[BATCH_SIZE];
+  float noise_x[BATCH_SIZE], noise_y[BATCH_SIZE], noise_z[BATCH_SIZE];
+  float P_noise_x[BATCH_SIZE], P_noise_y[BATCH_SIZE], P_noise_z[BATCH_SIZE];
+
   XorShift rng;
   int NSPECKS = 1000;
   int i = 0;
@@ -173,37 +180,47 @@ static int FillWithSpecksAlongLine(Volume *volume,
 
   progress.Start(NSPECKS);
 
-  for (i = 0; i < NSPECKS; i++) {
-    WispsControlPoint cp_t;
-    Vector P_speck;
-    Vector P_noise_space;
-    Vector noise;
+  for (i = 0; i < NSPECKS; i += BATCH_SIZE) {
+    const int count = NSPECKS - i < BATCH_SIZE ? NSPECKS - i : BATCH_SIZE;
+    int j;
+
+    for (j = 0; j < count; j++) {
+      const Vector2 disk = rng.SolidDiskRand();
+      const double line_t = rng.NextFloat01();
+      WispsControlPoint &cp = cp_t[j];
+      Vector &P = P_speck[j];
+
+      LerpWispConstrolPoint(&cp, cp0, cp1, line_t);
 
-    const Vector2 disk = rng.SolidDiskRand();
-    const double line_t = rng.NextFloat01();
+      P = cp.orig;
+      P.x += cp.radius * disk.x * cp.udir.x + cp.radius * disk.y * cp.vdir.x;
+      P.y += cp.radius * disk.x * cp.udir.y + cp.radius * disk.y * cp.vdir.y;
+      P.z += cp.radius * disk.x * cp.udir.z + cp.radius * disk.y * cp.vdir.z;
 
-    LerpWispConstrolPoint(&cp_t, cp0, cp1, line_t);
+      P_noise_x[j] = cp.noise_space.x + disk.x;
+      P_noise_y[j] = cp.noise_space.y + disk.y;
+      P_noise_z[j] = cp.noise_space.z;
+    }
 
-    P_speck = cp_t.orig;
-    P_speck.x += cp_t.radius * disk.x * cp_t.udir.x + cp_t.radius * disk.y * cp_t.vdir.x;
-    P_speck.y += cp_t.radius * disk.x * cp_t.udir.y + cp_t.radius * disk.y * cp_t.vdir.y;
-    P_speck.z += cp_t.radius * disk.x * cp_t.udir.z + cp_t.radius * disk.y * cp_t.vdir.z;
+    turbulence->Evaluate3dBatch(P_noise_x, P_noise_y, P_noise_z,
+        noise_x, noise_y, noise_z, count);
 
-    P_noise_space.x = cp_t.noise_space.x + disk.x;
-    P_noise_space.y = cp_t.noise_space.y + disk.y;
-    P_noise_space.z = cp_t.noise_space.z;
-    noise = turbulence->Evaluate3d(P_noise_space);
+    for (j = 0; j < count; j++) {
+      const WispsControlPoint &cp = cp_t[j];
+      Vector &P = P_speck[j];
+      Vector noise(noise_x[j], noise_y[j], noise_z[j]);
 
-    noise.x *= cp_t.radius * cp_t.noise_amplitude;
-    noise.y *= cp_t.radius * cp_t.noise_amplitude;
-    noise.z *= 1;
+      noise.x *= cp.radius * cp.noise_amplitude;
+      noise.y *= cp.radius * cp.noise_amplitude;
+      noise.z *= 1;
 
-    P_speck.x += noise.x * cp_t.udir.x + noise.y * cp_t.vdir.x + noise.z * cp_t.wdir.x;
-    P_speck.y += noise.x * cp_t.udir.y + noise.y * cp_t.vdir.y + noise.z * cp_t.wdir.y;
-    P_speck.z += noise.x * cp_t.udir.z + noise.y * cp_t.vdir.z + noise.z * cp_t.wdir.z;
+      P.x += noise.x * cp.udir.x + noise.y * cp.vdir.x + noise.z * cp.wdir.x;
+      P.y += noise.x * cp.udir.y + noise.y * cp.vdir.y + noise.z * cp.wdir.y;
+      P.z += noise.x * cp.udir.z + noise.y * cp.vdir.z + noise.z * cp.wdir.z;
 
-    FillWithSphere(volume, &P_speck, cp_t.speck_radius, cp_t.density);
-    progress.Increment();
+      FillWithSphere(volume, &P, cp.speck_radius, cp.density);
+      progress.Increment();
+    }
   }
   progress.Done();
 
@@ -15,6 +15,9 @@ static void *MyNew(void);
 static void MyFree(void *self);
 static void MyEvaluate(const void *self, const TraceContext *cxt,
     const SurfaceInput *in, SurfaceOutput *out);
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs);
+static int MyIsOpaque(const void *self);
 
 class ConstantShader {
 public:
@@ -29,7 +32,9 @@ public:
 static const char MyPluginName[] = "ConstantShader";
 
 static const ShaderFunctionTable MyFunctionTable = {
-  MyEvaluate
+  MyEvaluate,
+  MyEvaluateBatch,
+  MyIsOpaque
 };
 
 static int set_diffuse(void *self, const PropertyValue *value);
@@ -105,6 +110,31 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   out->Os = 1;
 }
 
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs)
+{
+  const ConstantShader *constant = (ConstantShader *) self;
+  int i;
+
+  if (constant->texture != NULL) {
+    for (i = 0; i < count; i++) {
+      MyEvaluate(self, &cxts[i], &ins[i], &outs[i]);
+    }
+    return;
+  }
+
+  // no texture. the same color for all
+  for (i = 0; i < count; i++) {
+    outs[i].Cs = constant->diffuse;
+    outs[i].Os = 1;
+  }
+}
+
+static int MyIsOpaque(const void *self)
+{
+  return 1;
+}
+
 static int set_diffuse(void *self, const PropertyValue *value)
 {
   ConstantShader *constant = (ConstantShader *) self;
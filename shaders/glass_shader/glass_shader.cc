@@ -34,11 +34,16 @@ static void *MyNew(void);
 static void MyFree(void *self);
 static void MyEvaluate(const void *self, const TraceContext *cxt,
     const SurfaceInput *in, SurfaceOutput *out);
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs);
+static int MyIsOpaque(const void *self);
 
 static const char MyPluginName[] = "GlassShader";
 
 static const ShaderFunctionTable MyFunctionTable = {
-  MyEvaluate
+  MyEvaluate,
+  MyEvaluateBatch,
+  MyIsOpaque
 };
 
 static int set_diffuse(void *self, const PropertyValue *value);
@@ -117,16 +122,18 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
 
   // reflect
   refl_cxt = SlReflectContext(cxt, in->shaded_object);
+  refl_cxt.throughput *= Kr;
   SlReflect(&in->I, &in->N, &R);
   Normalize(&R);
   // TODO fix hard-coded trace distance
   SlTrace(&refl_cxt, &in->P, &R, .0001, 1000, &C_refl, &t_hit);
-  out->Cs.r += Kr * C_refl.r;
-  out->Cs.g += Kr * C_refl.g;
-  out->Cs.b += Kr * C_refl.b;
+  out->Cindirect.r += Kr * C_refl.r;
+  out->Cindirect.g += Kr * C_refl.g;
+  out->Cindirect.b += Kr * C_refl.b;
 
   // refract
   refr_cxt = SlRefractContext(cxt, in->shaded_object);
+  refr_cxt.throughput *= Kt;
   SlRefract(&in->I, &in->N, 1/glass->ior, &T);
   Normalize(&T);
   SlTrace(&refr_cxt, &in->P, &T, .0001, 1000, &C_refr, &t_hit);
@@ -137,13 +144,29 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
     C_refr.b *= pow(glass->filter_color.b, t_hit);
   }
 
-  out->Cs.r += Kt * C_refr.r;
-  out->Cs.g += Kt * C_refr.g;
-  out->Cs.b += Kt * C_refr.b;
+  out->Cindirect.r += Kt * C_refr.r;
+  out->Cindirect.g += Kt * C_refr.g;
+  out->Cindirect.b += Kt * C_refr.b;
+  out->Cs = out->Cindirect;
 
   out->Os = 1;
 }
 
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    MyEvaluate(self, &cxts[i], &ins[i], &outs[i]);
+  }
+}
+
+static int MyIsOpaque(const void *self)
+{
+  return 1;
+}
+
 static int set_diffuse(void *self, const PropertyValue *value)
 {
   GlassShader *glass = (GlassShader *) self;
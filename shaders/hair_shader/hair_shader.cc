@@ -31,10 +31,15 @@ static void *MyNew(void);
 static void MyFree(void *self);
 static void MyEvaluate(const void *self, const TraceContext *cxt,
     const SurfaceInput *in, SurfaceOutput *out);
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs);
+static int MyIsOpaque(const void *self);
 
 static const char MyPluginName[] = "HairShader";
 static const ShaderFunctionTable MyFunctionTable = {
-  MyEvaluate
+  MyEvaluate,
+  MyEvaluateBatch,
+  MyIsOpaque
 };
 
 static int set_diffuse(void *self, const PropertyValue *value);
@@ -102,10 +107,10 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   int i = 0;
 
   LightSample *samples = NULL;
-  const int nsamples = SlGetLightSampleCount(in);
+  int nsamples = 0;
 
   // allocate samples
-  samples = SlNewLightSamples(in);
+  samples = SlNewLightSamples(cxt, in, &nsamples);
 
   out->Cs = Color();
 
@@ -123,16 +128,35 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
     diff = kajiya_diffuse(&tangent, &Lout.Ln);
     spec = kajiya_specular(&tangent, &Lout.Ln, &in->I);
 
-    out->Cs.r += (in->Cd.r * hair->diffuse.r * diff + spec) * Lout.Cl.r;
-    out->Cs.g += (in->Cd.g * hair->diffuse.g * diff + spec) * Lout.Cl.g;
-    out->Cs.b += (in->Cd.b * hair->diffuse.b * diff + spec) * Lout.Cl.b;
+    out->Cdiffuse.r += in->Cd.r * hair->diffuse.r * diff * Lout.Cl.r;
+    out->Cdiffuse.g += in->Cd.g * hair->diffuse.g * diff * Lout.Cl.g;
+    out->Cdiffuse.b += in->Cd.b * hair->diffuse.b * diff * Lout.Cl.b;
+    out->Cspecular.r += spec * Lout.Cl.r;
+    out->Cspecular.g += spec * Lout.Cl.g;
+    out->Cspecular.b += spec * Lout.Cl.b;
   }
+  out->Cs = out->Cdiffuse + out->Cspecular;
 
-  SlFreeLightSamples(samples);
+  SlFreeLightSamples(cxt, samples);
 
   out->Os = 1;
 }
 
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    MyEvaluate(self, &cxts[i], &ins[i], &outs[i]);
+  }
+}
+
+static int MyIsOpaque(const void *self)
+{
+  return 1;
+}
+
 static int set_diffuse(void *self, const PropertyValue *value)
 {
   HairShader *hair = (HairShader *) self;
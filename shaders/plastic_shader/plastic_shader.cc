@@ -39,10 +39,15 @@ static void *MyNew(void);
 static void MyFree(void *self);
 static void MyEvaluate(const void *self, const TraceContext *cxt,
     const SurfaceInput *in, SurfaceOutput *out);
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs);
+static int MyIsOpaque(const void *self);
 
 static const char MyPluginName[] = "PlasticShader";
 static const ShaderFunctionTable MyFunctionTable = {
-  MyEvaluate
+  MyEvaluate,
+  MyEvaluateBatch,
+  MyIsOpaque
 };
 
 static int set_diffuse(void *self, const PropertyValue *value);
@@ -119,7 +124,7 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   int i = 0;
 
   LightSample *samples = NULL;
-  const int nsamples = SlGetLightSampleCount(in);
+  int nsamples = 0;
 
   SlFaceforward(&in->I, &in->N, &Nf);
 
@@ -128,13 +133,13 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
     Vector N_bump;
     SlBumpMapping(plastic->bump_map,
         &in->dPdu, &in->dPdv,
-        &in->uv, plastic->bump_amplitude,
+        &in->uv, &in->uv_footprint, plastic->bump_amplitude,
         &Nf, &N_bump);
     Nf = N_bump;
   }
 
   // allocate samples
-  samples = SlNewLightSamples(in);
+  samples = SlNewLightSamples(cxt, in, &nsamples);
 
   for (i = 0; i < nsamples; i++) {
     LightOutput Lout;
@@ -154,7 +159,7 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   }
 
   // free samples
-  SlFreeLightSamples(samples);
+  SlFreeLightSamples(cxt, samples);
 
   // diffuse map
   if (plastic->diffuse_map != NULL) {
@@ -162,9 +167,11 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   }
 
   // Cs
-  out->Cs.r = diff.r * plastic->diffuse.r * diff_map.r + spec.r;
-  out->Cs.g = diff.g * plastic->diffuse.g * diff_map.g + spec.g;
-  out->Cs.b = diff.b * plastic->diffuse.b * diff_map.b + spec.b;
+  out->Cdiffuse.r = diff.r * plastic->diffuse.r * diff_map.r;
+  out->Cdiffuse.g = diff.g * plastic->diffuse.g * diff_map.g;
+  out->Cdiffuse.b = diff.b * plastic->diffuse.b * diff_map.b;
+  out->Cspecular = spec;
+  out->Cs = out->Cdiffuse + out->Cspecular;
 
   // reflect
   if (plastic->do_reflect) {
@@ -173,22 +180,40 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
     double t_hit = FLT_MAX;
     double Kr = 0;
 
-    const TraceContext refl_cxt = SlReflectContext(cxt, in->shaded_object);
+    TraceContext refl_cxt = SlReflectContext(cxt, in->shaded_object);
+
+    Kr = SlFresnel(&in->I, &Nf, 1/plastic->ior);
+    refl_cxt.throughput *= Kr * Luminance(plastic->reflect);
 
     SlReflect(&in->I, &Nf, &R);
     Normalize(&R);
     SlTrace(&refl_cxt, &in->P, &R, .001, 1000, &C_refl, &t_hit);
-
-    Kr = SlFresnel(&in->I, &Nf, 1/plastic->ior);
-    out->Cs.r += Kr * C_refl.r * plastic->reflect.r;
-    out->Cs.g += Kr * C_refl.g * plastic->reflect.g;
-    out->Cs.b += Kr * C_refl.b * plastic->reflect.b;
+    out->Cindirect.r = Kr * C_refl.r * plastic->reflect.r;
+    out->Cindirect.g = Kr * C_refl.g * plastic->reflect.g;
+    out->Cindirect.b = Kr * C_refl.b * plastic->reflect.b;
+    out->Cs += out->Cindirect;
   }
 
   out->Os = 1;
   out->Os = plastic->opacity;
 }
 
+static void MyEvaluateBatch(const void *self, const TraceContext *cxts,
+    const SurfaceInput *ins, int count, SurfaceOutput *outs)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    MyEvaluate(self, &cxts[i], &ins[i], &outs[i]);
+  }
+}
+
+static int MyIsOpaque(const void *self)
+{
+  const PlasticShader *plastic = (const PlasticShader *) self;
+  return plastic->opacity >= 1;
+}
+
 static int set_diffuse(void *self, const PropertyValue *value)
 {
   PlasticShader *plastic = (PlasticShader *) self;
@@ -2,14 +2,15 @@
 // See LICENSE and README
 
 #include "fj_shader.h"
+#include "fj_low_discrepancy.h"
 #include "fj_numeric.h"
-#include "fj_random.h"
 #include "fj_vector.h"
 #include "fj_color.h"
 
 #include <cstring>
 #include <cstdio>
 #include <cfloat>
+#include <cmath>
 
 #define COPY3(dst,src) do { \
   (dst)[0] = (src)[0]; \
@@ -42,8 +43,6 @@ public:
   int enable_single_scattering;
   int enable_multiple_scattering;
 
-  XorShift rng;
-
   float scattering_coeff[3];
   float absorption_coeff[3];
   float extinction_coeff[3];
@@ -55,6 +54,9 @@ public:
   int single_scattering_samples;
   int multiple_scattering_samples;
 
+  // multiple scattering is reused within the distance. 0 disables it
+  float irradiance_cache_spacing;
+
   float reduced_scattering_coeff[3];
   float reduced_extinction_coeff[3];
   float effective_extinction_coeff[3];
@@ -66,10 +68,13 @@ static void *MyNew(void);
 static void MyFree(void *self);
 static void MyEvaluate(const void *self, const TraceContext *cxt,
     const SurfaceInput *in, SurfaceOutput *out);
+static int MyIsOpaque(const void *self);
 
 static const char MyPluginName[] = "SSSShader";
 static const ShaderFunctionTable MyFunctionTable = {
-  MyEvaluate
+  MyEvaluate,
+  NULL,
+  MyIsOpaque
 };
 
 static void update_sss_properties(SSSShader *sss);
@@ -98,6 +103,7 @@ static int set_absorption_coeff(void *self, const PropertyValue *value);
 static int set_scattering_phase(void *self, const PropertyValue *value);
 static int set_single_scattering_intensity(void *self, const PropertyValue *value);
 static int set_multiple_scattering_intensity(void *self, const PropertyValue *value);
+static int set_irradiance_cache_spacing(void *self, const PropertyValue *value);
 
 static const Property MyProperties[] = {
   {PROP_VECTOR3, "diffuse",     {.8, .8, .8, 0}, set_diffuse},
@@ -117,6 +123,7 @@ static const Property MyProperties[] = {
   {PROP_SCALAR,  "scattering_phase", {0, 0, 0, 0}, set_scattering_phase},
   {PROP_SCALAR,  "single_scattering_intensity", {1, 0, 0, 0}, set_single_scattering_intensity},
   {PROP_SCALAR,  "multiple_scattering_intensity", {.02, 0, 0, 0}, set_multiple_scattering_intensity},
+  {PROP_SCALAR,  "irradiance_cache_spacing", {0, 0, 0, 0}, set_irradiance_cache_spacing},
   {PROP_NONE, NULL, {0, 0, 0, 0}, NULL}
 };
 
@@ -164,14 +171,20 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   const SSSShader *sss = (SSSShader *) self;
   Color diff;
   Color spec;
+  Color multiple_scatter;
   Color4 diff_map(1, 1, 1, 1);
   int i;
 
+  // diffusion is view independent and smooth over the surface
+  const int do_multiple_scattering = sss->enable_multiple_scattering &&
+      !SlLookupIrradiance(cxt, in, self, sss->irradiance_cache_spacing,
+          &multiple_scatter);
+
   LightSample *samples = NULL;
-  const int nsamples = SlGetLightSampleCount(in);
+  int nsamples = 0;
 
   // allocate samples
-  samples = SlNewLightSamples(in);
+  samples = SlNewLightSamples(cxt, in, &nsamples);
 
   for (i = 0; i < nsamples; i++) {
     LightOutput Lout;
@@ -196,18 +209,28 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
       diff.g += single_scatter.g;
       diff.b += single_scatter.b;
     }
-    if (sss->enable_multiple_scattering) {
+    if (do_multiple_scattering) {
       diffusion_scattering(sss, cxt, in, &samples[i], &diffusion_scatter);
       diffusion_scatter.r *= sss->multiple_scattering_intensity;
       diffusion_scatter.g *= sss->multiple_scattering_intensity;
       diffusion_scatter.b *= sss->multiple_scattering_intensity;
-      diff.r += diffusion_scatter.r;
-      diff.g += diffusion_scatter.g;
-      diff.b += diffusion_scatter.b;
+      multiple_scatter.r += diffusion_scatter.r;
+      multiple_scatter.g += diffusion_scatter.g;
+      multiple_scatter.b += diffusion_scatter.b;
     }
   }
 
-  SlFreeLightSamples(samples);
+  SlFreeLightSamples(cxt, samples);
+
+  if (do_multiple_scattering) {
+    SlStoreIrradiance(cxt, in, self, sss->irradiance_cache_spacing,
+        &multiple_scatter);
+  }
+  if (sss->enable_multiple_scattering) {
+    diff.r += multiple_scatter.r;
+    diff.g += multiple_scatter.g;
+    diff.b += multiple_scatter.b;
+  }
 
   // diffuse map
   if (sss->diffuse_map != NULL) {
@@ -215,9 +238,11 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   }
 
   // Cs
-  out->Cs.r = diff.r * sss->diffuse.r * diff_map.r + spec.r;
-  out->Cs.g = diff.g * sss->diffuse.g * diff_map.g + spec.g;
-  out->Cs.b = diff.b * sss->diffuse.b * diff_map.b + spec.b;
+  out->Cdiffuse.r = diff.r * sss->diffuse.r * diff_map.r;
+  out->Cdiffuse.g = diff.g * sss->diffuse.g * diff_map.g;
+  out->Cdiffuse.b = diff.b * sss->diffuse.b * diff_map.b;
+  out->Cspecular = spec;
+  out->Cs = out->Cdiffuse + out->Cspecular;
 
   // reflect
   if (sss->do_reflect) {
@@ -226,23 +251,31 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
     double t_hit = FLT_MAX;
     double Kr = 0;
 
-    const TraceContext refl_cxt = SlReflectContext(cxt, in->shaded_object);
+    TraceContext refl_cxt = SlReflectContext(cxt, in->shaded_object);
+
+    Kr = SlFresnel(&in->I, &in->N, 1/sss->ior);
+    refl_cxt.throughput *= Kr * Luminance(sss->reflect);
 
     SlReflect(&in->I, &in->N, &R);
     Normalize(&R);
     // TODO fix hard-coded trace distance
     SlTrace(&refl_cxt, &in->P, &R, .001, 1000, &C_refl, &t_hit);
-
-    Kr = SlFresnel(&in->I, &in->N, 1/sss->ior);
-    out->Cs.r += Kr * C_refl.r * sss->reflect.r;
-    out->Cs.g += Kr * C_refl.g * sss->reflect.g;
-    out->Cs.b += Kr * C_refl.b * sss->reflect.b;
+    out->Cindirect.r = Kr * C_refl.r * sss->reflect.r;
+    out->Cindirect.g = Kr * C_refl.g * sss->reflect.g;
+    out->Cindirect.b = Kr * C_refl.b * sss->reflect.b;
+    out->Cs += out->Cindirect;
   }
 
   out->Os = 1;
   out->Os = sss->opacity;
 }
 
+static int MyIsOpaque(const void *self)
+{
+  const SSSShader *sss = (const SSSShader *) self;
+  return sss->opacity >= 1;
+}
+
 static void update_sss_properties(SSSShader *sss)
 {
   const float eta = sss->ior;
@@ -311,9 +344,12 @@ static void single_scattering(const SSSShader *sss,
   SlRefract(&in->I, &in->N, one_over_eta, &To);
   Normalize(&To);
 
+  // sample patterns are unique to the shading point and the light sample
+  const uint32_t scramble =
+      LdHashCombine(LdHashPoint(*P), LdHashPoint(light_sample->P));
+
   for (i = 0; i < nsamples; i++) {
-    XorShift &mutable_rng = const_cast<XorShift &>(sss->rng);
-    const float sp_dist = -log(mutable_rng.NextFloat01());
+    const float sp_dist = -log(1 - LdVanDerCorput(i, scramble));
 
     for (j = 0; j < 3; j++) {
       Vector P_sample;
@@ -449,9 +485,14 @@ static void diffusion_scattering(const SSSShader *sss,
   Normalize(&base1);
   base2 = Cross(*N, base1);
 
+  // sample patterns are unique to the shading point and the light sample
+  const uint32_t scramble =
+      LdHashCombine(LdHashPoint(*P), LdHashPoint(light_sample->P));
+
   for (i = 0; i < nsamples; i++) {
-    XorShift &mutable_rng = const_cast<XorShift &>(sss->rng);
-    const double dist_rand = -log(mutable_rng.NextFloat01());
+    // distance and angle of the disk sample from (0,2) sequence
+    const Vector2 uv = LdSample02(i, scramble);
+    const double dist_rand = -log(1 - uv[0]);
 
     for (j = 0; j < 3; j++) {
       const TraceContext self_cxt = SlSelfHitContext(cxt, in->shaded_object);
@@ -479,7 +520,10 @@ static void diffusion_scattering(const SSSShader *sss,
 
       const double dist = dist_rand / sigma_tr[j];
 
-      disk = mutable_rng.HollowDiskRand();
+      // the three channels take the angle a third of a turn apart
+      const double angle = 2 * PI * (uv[1] + j / 3.);
+      disk.x = cos(angle);
+      disk.y = sin(angle);
       disk.x *= dist;
       disk.y *= dist;
       P_sample.x = P->x + 1/sigma_tr[j] * (disk.x * base1.x + disk.y * base2.x);
@@ -765,3 +809,15 @@ static int set_multiple_scattering_intensity(void *self, const PropertyValue *va
 
   return 0;
 }
+
+static int set_irradiance_cache_spacing(void *self, const PropertyValue *value)
+{
+  SSSShader *sss = (SSSShader *) self;
+  float spacing = value->vector[0];
+
+  spacing = Max(0, spacing);
+
+  sss->irradiance_cache_spacing = spacing;
+
+  return 0;
+}
@@ -83,12 +83,12 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
   Color diff;
 
   LightSample *samples = NULL;
-  const int nsamples = SlGetLightSampleCount(in);
+  int nsamples = 0;
 
   int i = 0;
 
   // allocate samples
-  samples = SlNewLightSamples(in);
+  samples = SlNewLightSamples(cxt, in, &nsamples);
 
   for (i = 0; i < nsamples; i++) {
     LightOutput Lout;
@@ -101,7 +101,7 @@ static void MyEvaluate(const void *self, const TraceContext *cxt,
     diff.b += Lout.Cl.b;
   }
 
-  SlFreeLightSamples(samples);
+  SlFreeLightSamples(cxt, samples);
 
   // Cs
   out->Cs.r = diff.r * volume->diffuse.r;
@@ -3,10 +3,12 @@
 
 #include "fj_accelerator.h"
 #include "fj_primitive_set.h"
+#include "fj_intersection.h"
 #include "fj_multi_thread.h"
 #include "fj_ray.h"
 
 #include <iostream>
+#include <cassert>
 
 namespace fj {
 
@@ -112,6 +114,42 @@ bool Accelerator::Intersect(const Ray &ray, Real time, Intersection *isect) cons
   return intersect(ray, time, isect);
 }
 
+void Accelerator::IntersectPacket(const Ray *rays, const Real *times, int nrays,
+    Intersection *isects, bool *hits) const
+{
+  assert(nrays >= 0 && nrays <= MAX_PACKET_RAYS);
+  intersect_packet(rays, times, nrays, isects, hits);
+}
+
+void Accelerator::intersect_packet(const Ray *rays, const Real *times, int nrays,
+    Intersection *isects, bool *hits) const
+{
+  for (int i = 0; i < nrays; i++) {
+    hits[i] = Intersect(rays[i], times[i], &isects[i]);
+  }
+}
+
+bool Accelerator::Occluded(const Ray &ray, Real time) const
+{
+  Real boxhit_tmin = 0;
+  Real boxhit_tmax = 0;
+
+  const bool hit = BoxRayIntersect(bounds_, ray.orig, ray.dir, ray.tmin, ray.tmax,
+        &boxhit_tmin, &boxhit_tmax);
+
+  if (!hit) {
+    return false;
+  }
+
+  return occluded(ray, time);
+}
+
+bool Accelerator::occluded(const Ray &ray, Real time) const
+{
+  Intersection isect;
+  return intersect(ray, time, &isect);
+}
+
 static void build_accelerator_callback(void *data)
 {
   Accelerator *acc = reinterpret_cast<Accelerator *>(data);
@@ -13,6 +13,9 @@ class Intersection;
 class PrimitiveSet;
 class Ray;
 
+// max number of rays traced together by IntersectPacket
+enum { MAX_PACKET_RAYS = 64 };
+
 class Accelerator {
 public:
   Accelerator();
@@ -27,10 +30,22 @@ public:
   void SetPrimitiveSet(PrimitiveSet *primset);
   int Build();
   bool Intersect(const Ray &ray, Real time, Intersection *isect) const;
+  // Intersects coherent rays sharing the traversal of the structure.
+  // hits[i] tells whether isects[i] has the nearest hit of rays[i].
+  void IntersectPacket(const Ray *rays, const Real *times, int nrays,
+      Intersection *isects, bool *hits) const;
+  // Tells whether the ray hits anything in its range. Traversal stops
+  // at the first hit found which is not always the nearest one.
+  bool Occluded(const Ray &ray, Real time) const;
 
 private:
   virtual int build() = 0;
   virtual bool intersect(const Ray &ray, Real time, Intersection *isect) const = 0;
+  // intersects each ray one by one unless overridden
+  virtual void intersect_packet(const Ray *rays, const Real *times, int nrays,
+      Intersection *isects, bool *hits) const;
+  // looks for the nearest hit unless overridden
+  virtual bool occluded(const Ray &ray, Real time) const;
   virtual const char *get_name() const = 0;
 
   Box bounds_;
@@ -4,7 +4,7 @@
 #include "fj_adaptive_grid_sampler.h"
 #include "fj_rectangle.h"
 #include "fj_numeric.h"
-#include "fj_random.h"
+#include "fj_low_discrepancy.h"
 
 namespace fj {
 
@@ -12,9 +12,8 @@ AdaptiveGridSampler::AdaptiveGridSampler() :
   samples_(),
 
   nsamples_(1, 1),
-  pixel_start_(0, 0),
+  region_(),
   margin_(0, 0),
-  npxlsmps_(1, 1),
   ndivision_(2, 2),
 
   curr_corner_(0)
@@ -28,7 +27,6 @@ AdaptiveGridSampler::~AdaptiveGridSampler()
 void AdaptiveGridSampler::update_sample_counts()
 {
   margin_ = count_samples_in_margin();
-  npxlsmps_ = count_samples_in_pixel();
   ndivision_ = compute_num_pixel_division();
 }
 
@@ -39,10 +37,10 @@ int AdaptiveGridSampler::generate_samples(const Rectangle &region)
   // allocate samples in region
   nsamples_ = count_samples_in_region(region);
   samples_.resize(nsamples_[0] * nsamples_[1]);
-  pixel_start_ = region.min;
+  attach_aovs(samples_);
+  region_ = region;
 
-  XorShift rng; // random number generator
-  XorShift rng_time; // for time sampling jitter
+  const uint32_t seed = LdHash(GetSeed());
 
   const Int2 div = ndivision_;
   const Int2 res = GetResolution();
@@ -54,8 +52,8 @@ int AdaptiveGridSampler::generate_samples(const Rectangle &region)
   const Real vdelta = 1./(div[1] * res[1]);
 
   // xy offset
-  const int xoffset = (pixel_start_[0] - margin_[0]) * div[0];
-  const int yoffset = (pixel_start_[1] - margin_[1]) * div[1];
+  const int xoffset = (region_.min[0] - margin_[0]) * div[0];
+  const int yoffset = (region_.min[1] - margin_[1]) * div[1];
 
   subd_flag_.clear();
   subd_flag_.resize(samples_.size(), -1);
@@ -66,19 +64,24 @@ int AdaptiveGridSampler::generate_samples(const Rectangle &region)
     for (int x = 0; x < nsamples_[0]; x++) {
       Sample &sample = samples_[sample_id];
 
+      // jitter is unique to the grid point so that neighbor regions
+      // generate the same samples in their margins
+      const uint32_t pattern =
+          LdHashCombine(LdHashCombine(seed, x + xoffset), y + yoffset);
+
       sample.uv[0] =     (x + xoffset) * udelta;
       sample.uv[1] = 1 - (y + yoffset) * vdelta;
 
       if (IsJittered()) {
-        const Real u_jitter = rng.NextFloat01() * jitter;
-        const Real v_jitter = rng.NextFloat01() * jitter;
+        const Real u_jitter = LdRandom01(0, pattern) * jitter;
+        const Real v_jitter = LdRandom01(1, pattern) * jitter;
 
         sample.uv[0] += udelta * (u_jitter - .5);
         sample.uv[1] += vdelta * (v_jitter - .5);
       }
 
       if (IsSamplingTime()) {
-        const Real rnd = rng_time.NextFloat01();
+        const Real rnd = LdRandom01(2, pattern);
         sample.time = Fit(rnd, 0, 1, sample_time_range[0], sample_time_range[1]);
       } else {
         sample.time = 0;
@@ -165,31 +168,27 @@ Sample *AdaptiveGridSampler::get_next_sample()
   return NULL;
 }
 
-void AdaptiveGridSampler::get_sampleset_in_pixel(std::vector<Sample> &pixelsamples,
-    const Int2 &pixel_pos) const
+static int floor_div(int a, int b)
 {
-  const Int2 div = ndivision_;
-
-  const int XPIXEL_OFFSET = pixel_pos[0] - pixel_start_[0];
-  const int YPIXEL_OFFSET = pixel_pos[1] - pixel_start_[1];
-
-  const int XNSAMPLES = nsamples_[0];
-  const int OFFSET =
-    YPIXEL_OFFSET * div[1] * XNSAMPLES +
-    XPIXEL_OFFSET * div[0];
-  const Sample *src = &samples_[OFFSET];
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
 
-  const Int2 NPXLSMPS = count_samples_in_pixel();
-  const std::size_t SAMPLE_COUNT = static_cast<std::size_t>(NPXLSMPS[0] * NPXLSMPS[1]);
-  if (pixelsamples.size() < SAMPLE_COUNT) {
-    pixelsamples.resize(SAMPLE_COUNT);
-  }
+void AdaptiveGridSampler::get_owned_samples(std::vector<const Sample *> &samples) const
+{
+  // samples are on pixel corners. a corner belongs to the pixel on its
+  // lower right, so corners on the max edges go to the neighbor regions
+  const Int2 div = ndivision_;
+  const Int2 offset = (region_.min - margin_) * div;
 
-  std::vector<Sample> &dst = pixelsamples;
+  for (int y = 0; y < nsamples_[1]; y++) {
+    for (int x = 0; x < nsamples_[0]; x++) {
+      const Int2 pixel(
+          floor_div(x + offset[0], div[0]),
+          floor_div(y + offset[1], div[1]));
 
-  for (int y = 0; y < npxlsmps_[1]; y++) {
-    for (int x = 0; x < npxlsmps_[0]; x++) {
-      dst[y * npxlsmps_[0] + x] = src[y * XNSAMPLES + x];
+      if (is_owned_pixel(region_, pixel)) {
+        samples.push_back(&samples_[y * nsamples_[0] + x]);
+      }
     }
   }
 }
@@ -207,11 +206,6 @@ Int2 AdaptiveGridSampler::count_samples_in_margin() const
       static_cast<int>(Ceil(beyond_one[1])));
 }
 
-Int2 AdaptiveGridSampler::count_samples_in_pixel() const
-{
-  return ndivision_ * (Int2(1, 1) + 2 * margin_) + Int2(1, 1);
-}
-
 Int2 AdaptiveGridSampler::count_samples_in_region(const Rectangle &region) const
 {
   return ndivision_ * (region.Size() + 2 * margin_) + Int2(1, 1);
@@ -306,16 +300,34 @@ void AdaptiveGridSampler::interpolate_rect(const Rectangle rect)
   const Vector4 &data2 = samples_[YMAX * nsamples_[0] + XMIN].data;
   const Vector4 &data3 = samples_[YMAX * nsamples_[0] + XMAX].data;
 
+  // copies of corners as they are overwritten while interpolating
+  const bool has_aov = samples_[YMIN * nsamples_[0] + XMIN].aov != NULL;
+  AovSample aov0, aov1, aov2, aov3;
+  if (has_aov) {
+    aov0 = *samples_[YMIN * nsamples_[0] + XMIN].aov;
+    aov1 = *samples_[YMIN * nsamples_[0] + XMAX].aov;
+    aov2 = *samples_[YMAX * nsamples_[0] + XMIN].aov;
+    aov3 = *samples_[YMAX * nsamples_[0] + XMAX].aov;
+  }
+
   // using less than equal
   for (int y = YMIN; y <= YMAX; y++) {
     const Vector4 data02 = Lerp(data0, data2, 1.*(y - YMIN) / (YMAX-YMIN));
     const Vector4 data13 = Lerp(data1, data3, 1.*(y - YMIN) / (YMAX-YMIN));
+    AovSample aov02, aov13;
+    if (has_aov) {
+      aov02 = AovLerp(aov0, aov2, 1.*(y - YMIN) / (YMAX-YMIN));
+      aov13 = AovLerp(aov1, aov3, 1.*(y - YMIN) / (YMAX-YMIN));
+    }
 
     // using less than equal
     for (int x = XMIN; x <= XMAX; x++) {
       const int OFFSET = y * nsamples_[0] + x;
       Sample &sample = samples_[OFFSET];
       sample.data = Lerp(data02, data13, 1.*(x - XMIN) / (XMAX-XMIN));
+      if (has_aov) {
+        *sample.aov = AovLerp(aov02, aov13, 1.*(x - XMIN) / (XMAX-XMIN));
+      }
 
       if (subd_flag_[OFFSET] < 0) {
         subd_flag_[OFFSET] = 0;
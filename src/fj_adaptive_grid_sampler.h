@@ -19,12 +19,10 @@ private:
   virtual void update_sample_counts();
   virtual int generate_samples(const Rectangle &region);
   virtual Sample *get_next_sample();
-  virtual void get_sampleset_in_pixel(std::vector<Sample> &pixelsamples,
-      const Int2 &pixel_pos) const;
+  virtual void get_owned_samples(std::vector<const Sample *> &samples) const;
 
   int get_sample_count() const;
   Int2 count_samples_in_region(const Rectangle &region) const;
-  Int2 count_samples_in_pixel() const;
   Int2 count_samples_in_margin() const;
 
   Int2 compute_num_pixel_division() const;
@@ -36,9 +34,8 @@ private:
   std::vector<Sample> samples_;
 
   Int2 nsamples_;
-  Int2 pixel_start_;
+  Rectangle region_;
   Int2 margin_;
-  Int2 npxlsmps_;
   Int2 ndivision_;
 
   typedef std::stack<Rectangle,std::vector<Rectangle> > Stack;
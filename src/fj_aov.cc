@@ -0,0 +1,122 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "fj_aov.h"
+#include <cstring>
+#include <cassert>
+
+namespace fj {
+
+class AovInfo {
+public:
+  const char *name;
+  int channel_count;
+  int channel_offset;
+  int filter_type;
+};
+
+// depth and object id averaged with misses or other objects would be
+// values no sample had
+static const AovInfo aov_table[] = {
+  {"depth",     1,  0, AOV_FILTER_NEAREST},
+  {"normal",    3,  1, AOV_FILTER_UNIT},
+  {"object_id", 1,  4, AOV_FILTER_NEAREST},
+  {"diffuse",   3,  5, AOV_FILTER_WEIGHTED},
+  {"specular",  3,  8, AOV_FILTER_WEIGHTED},
+  {"indirect",  3, 11, AOV_FILTER_WEIGHTED},
+  {"volume",    3, 14, AOV_FILTER_WEIGHTED}
+};
+
+static const AovInfo &get_info(int aov)
+{
+  assert(aov >= 0 && aov < AOV_COUNT);
+  return aov_table[aov];
+}
+
+AovSample::AovSample()
+{
+  for (int i = 0; i < AOV_CHANNEL_COUNT; i++) {
+    channels[i] = 0;
+  }
+}
+
+void AovSample::SetScalar(int aov, float value)
+{
+  assert(get_info(aov).channel_count == 1);
+  channels[get_info(aov).channel_offset] = value;
+}
+
+void AovSample::SetVector(int aov, const Vector &vector)
+{
+  float *dst = &channels[get_info(aov).channel_offset];
+  assert(get_info(aov).channel_count == 3);
+  dst[0] = vector.x;
+  dst[1] = vector.y;
+  dst[2] = vector.z;
+}
+
+void AovSample::SetColor(int aov, const Color &color)
+{
+  float *dst = &channels[get_info(aov).channel_offset];
+  assert(get_info(aov).channel_count == 3);
+  dst[0] = color.r;
+  dst[1] = color.g;
+  dst[2] = color.b;
+}
+
+Color AovSample::GetColor(int aov) const
+{
+  const float *src = &channels[get_info(aov).channel_offset];
+  assert(get_info(aov).channel_count == 3);
+  return Color(src[0], src[1], src[2]);
+}
+
+int AovFindByName(const char *name)
+{
+  for (int i = 0; i < AOV_COUNT; i++) {
+    if (strcmp(aov_table[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const char *AovGetName(int aov)
+{
+  return get_info(aov).name;
+}
+
+int AovGetChannelCount(int aov)
+{
+  return get_info(aov).channel_count;
+}
+
+int AovGetChannelOffset(int aov)
+{
+  return get_info(aov).channel_offset;
+}
+
+int AovGetFilterType(int aov)
+{
+  return get_info(aov).filter_type;
+}
+
+AovSample AovLerp(const AovSample &a, const AovSample &b, Real t)
+{
+  AovSample out;
+  for (int i = 0; i < AOV_COUNT; i++) {
+    const AovInfo &info = get_info(i);
+    const int end = info.channel_offset + info.channel_count;
+
+    for (int j = info.channel_offset; j < end; j++) {
+      if (info.filter_type == AOV_FILTER_NEAREST) {
+        out.channels[j] = t < .5 ? a.channels[j] : b.channels[j];
+      } else {
+        out.channels[j] = (1 - t) * a.channels[j] + t * b.channels[j];
+      }
+    }
+  }
+  return out;
+}
+
+} // namespace xxx
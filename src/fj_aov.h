@@ -0,0 +1,62 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#ifndef FJ_AOV_H
+#define FJ_AOV_H
+
+#include "fj_vector.h"
+#include "fj_color.h"
+#include "fj_types.h"
+
+namespace fj {
+
+// arbitrary output variables of camera rays. each one is filtered
+// alongside color into its own framebuffer
+enum AovType {
+  AOV_DEPTH = 0,  // distance to the first hit
+  AOV_NORMAL,     // world space normal at the first hit
+  AOV_OBJECT_ID,  // object id of the first hit. 0 for no hit
+  AOV_DIFFUSE,    // SurfaceOutput::Cdiffuse at the first hit
+  AOV_SPECULAR,   // SurfaceOutput::Cspecular at the first hit
+  AOV_INDIRECT,   // SurfaceOutput::Cindirect at the first hit
+  AOV_VOLUME,     // volume color in front of the first hit
+  AOV_COUNT
+};
+
+// channels of all aovs in a sample
+enum { AOV_CHANNEL_COUNT = 17 };
+
+// how samples of an aov make a pixel
+enum AovFilterType {
+  AOV_FILTER_WEIGHTED = 0,  // weighted by the pixel filter as color is
+  AOV_FILTER_UNIT,          // weighted, then normalized to unit length
+  AOV_FILTER_NEAREST        // value of the sample nearest to the pixel center
+};
+
+class AovSample {
+public:
+  AovSample();
+  ~AovSample() {}
+
+  void SetScalar(int aov, float value);
+  void SetVector(int aov, const Vector &vector);
+  void SetColor(int aov, const Color &color);
+  Color GetColor(int aov) const;
+
+public:
+  float channels[AOV_CHANNEL_COUNT];
+};
+
+// returns -1 for unknown names
+int AovFindByName(const char *name);
+const char *AovGetName(int aov);
+int AovGetChannelCount(int aov);
+int AovGetChannelOffset(int aov);
+int AovGetFilterType(int aov);
+
+// aovs taken from the nearest sample are not blended
+AovSample AovLerp(const AovSample &a, const AovSample &b, Real t);
+
+} // namespace xxx
+
+#endif // FJ_XXX_H
@@ -61,6 +61,11 @@ static bool intersect_bvh_recursive(const PrimitiveSet *primset,
 static bool intersect_bvh_loop(const PrimitiveSet *primset,
     const BVHNode *root, const Ray &ray, Real time,
     Intersection *isect);
+static void intersect_bvh_packet(const PrimitiveSet *primset,
+    const BVHNode *root, const Ray *rays, const Real *times, int nrays,
+    Intersection *isects, bool *hits);
+static bool occluded_bvh_loop(const PrimitiveSet *primset,
+    const BVHNode *root, const Ray &ray, Real time);
 
 static BVHNode *new_bvhnode();
 static void free_bvhnode_recursive(BVHNode *node);
@@ -116,6 +121,19 @@ bool BVHAccelerator::intersect(const Ray &ray, Real time, Intersection *isect) c
     return intersect_bvh_recursive(primset, root, ray, time, isect);
 }
 
+void BVHAccelerator::intersect_packet(const Ray *rays, const Real *times, int nrays,
+    Intersection *isects, bool *hits) const
+{
+  const PrimitiveSet *primset = GetPrimitiveSet();
+  intersect_bvh_packet(primset, root, rays, times, nrays, isects, hits);
+}
+
+bool BVHAccelerator::occluded(const Ray &ray, Real time) const
+{
+  const PrimitiveSet *primset = GetPrimitiveSet();
+  return occluded_bvh_loop(primset, root, ray, time);
+}
+
 const char *BVHAccelerator::get_name() const
 {
   return ACCELERATOR_NAME;
@@ -240,6 +258,157 @@ loop_exit:
   return hit;
 }
 
+static bool occluded_bvh_loop(const PrimitiveSet *primset,
+    const BVHNode *root, const Ray &ray, Real time)
+{
+  const BVHNode *node = root;
+  std::stack<const BVHNode*> stack;
+
+  // TODO NODE COULD BE NULL IF PRIMITIVE IS EMPTY. MIGHT BE BETTER CHANGE
+  if (node == NULL)
+    return false;
+
+  for (;;) {
+    if (node->is_leaf()) {
+      // any hit will do. no need to find the nearest one
+      if (primset->RayOccluded(node->prim_id, ray, time))
+        return true;
+
+      if (stack.empty())
+        return false;
+      node = stack.top();
+      stack.pop();
+      continue;
+    }
+
+    Real boxhit_tmin, boxhit_tmax;
+    const bool hit_left = BoxRayIntersect(node->left->bounds,
+        ray.orig, ray.dir, ray.tmin, ray.tmax,
+        &boxhit_tmin, &boxhit_tmax);
+
+    const bool hit_right = BoxRayIntersect(node->right->bounds,
+        ray.orig, ray.dir, ray.tmin, ray.tmax,
+        &boxhit_tmin, &boxhit_tmax);
+
+    if (hit_left && hit_right) {
+      stack.push(node->right);
+      node = node->left;
+    } else if (hit_left) {
+      node = node->left;
+    } else if (hit_right) {
+      node = node->right;
+    } else {
+      if (stack.empty())
+        return false;
+      node = stack.top();
+      stack.pop();
+    }
+  }
+}
+
+// node to visit and the first ray in the packet hitting its parent.
+// rays before the first one are skipped in the whole subtree
+class PacketEntry {
+public:
+  PacketEntry(const BVHNode *node_, int first_) : node(node_), first(first_) {}
+  ~PacketEntry() {}
+
+  const BVHNode *node;
+  int first;
+};
+
+static bool packet_box_intersect(const Box &box, const Ray &ray,
+    const Vector &inv_dir)
+{
+  // the same test as BoxRayIntersect with divisions done per packet
+  Real tmin = -REAL_MAX;
+  Real tmax = REAL_MAX;
+
+  for (int i = 0; i < 3; i++) {
+    Real t0 = (box.min[i] - ray.orig[i]) * inv_dir[i];
+    Real t1 = (box.max[i] - ray.orig[i]) * inv_dir[i];
+    if (inv_dir[i] < 0) {
+      std::swap(t0, t1);
+    }
+    if (tmin > t1 || t0 > tmax) {
+      return false;
+    }
+    tmin = t0 > tmin ? t0 : tmin;
+    tmax = t1 < tmax ? t1 : tmax;
+  }
+
+  return tmin < ray.tmax && tmax > ray.tmin;
+}
+
+static void intersect_bvh_packet(const PrimitiveSet *primset,
+    const BVHNode *root, const Ray *rays, const Real *times, int nrays,
+    Intersection *isects, bool *hits)
+{
+  Vector inv_dir[MAX_PACKET_RAYS];
+  for (int i = 0; i < nrays; i++) {
+    inv_dir[i] = Vector(1 / rays[i].dir[0], 1 / rays[i].dir[1], 1 / rays[i].dir[2]);
+    isects[i].t_hit = REAL_MAX;
+    hits[i] = false;
+  }
+
+  // TODO NODE COULD BE NULL IF PRIMITIVE IS EMPTY. MIGHT BE BETTER CHANGE
+  if (root == NULL)
+    return;
+
+  // rays hitting a leaf are gathered to intersect the primitive together
+  Ray leaf_rays[MAX_PACKET_RAYS];
+  Real leaf_times[MAX_PACKET_RAYS];
+  int leaf_ray_ids[MAX_PACKET_RAYS];
+  Intersection leaf_isects[MAX_PACKET_RAYS];
+  bool leaf_hits[MAX_PACKET_RAYS];
+
+  std::stack<PacketEntry> stack;
+  stack.push(PacketEntry(root, 0));
+
+  while (!stack.empty()) {
+    const PacketEntry entry = stack.top();
+    const BVHNode *node = entry.node;
+    stack.pop();
+
+    // only one ray hitting the node is enough to visit the children
+    int first = entry.first;
+    while (first < nrays &&
+        !packet_box_intersect(node->bounds, rays[first], inv_dir[first])) {
+      first++;
+    }
+    if (first == nrays) {
+      continue;
+    }
+
+    if (!node->is_leaf()) {
+      stack.push(PacketEntry(node->right, first));
+      stack.push(PacketEntry(node->left, first));
+      continue;
+    }
+
+    int nleaf_rays = 0;
+    for (int i = first; i < nrays; i++) {
+      if (i == first || packet_box_intersect(node->bounds, rays[i], inv_dir[i])) {
+        leaf_rays[nleaf_rays] = rays[i];
+        leaf_times[nleaf_rays] = times[i];
+        leaf_ray_ids[nleaf_rays] = i;
+        nleaf_rays++;
+      }
+    }
+
+    primset->RayIntersectPacket(node->prim_id, leaf_rays, leaf_times, nleaf_rays,
+        leaf_isects, leaf_hits);
+
+    for (int i = 0; i < nleaf_rays; i++) {
+      const int id = leaf_ray_ids[i];
+      if (leaf_hits[i] && leaf_isects[i].t_hit < isects[id].t_hit) {
+        isects[id] = leaf_isects[i];
+        hits[id] = true;
+      }
+    }
+  }
+}
+
 // Compares an axis component of primitive centroid for std::sort.
 template<int Axis>
 class CentroidLess {
@@ -18,6 +18,9 @@ public:
 public:
   virtual int build();
   virtual bool intersect(const Ray &ray, Real time, Intersection *isect) const;
+  virtual void intersect_packet(const Ray *rays, const Real *times, int nrays,
+      Intersection *isects, bool *hits) const;
+  virtual bool occluded(const Ray &ray, Real time) const;
   virtual const char *get_name() const;
 
   BVHNode *root;
@@ -20,6 +20,11 @@ static Interrupt no_sample_report(void *data)
   return CALLBACK_CONTINUE;
 }
 
+static Interrupt no_pass_report(void *data, const PassInfo *info)
+{
+  return CALLBACK_CONTINUE;
+}
+
 Interrupt CbReportFrameStart(FrameReport *report, const FrameInfo *info)
 {
   return report->start(report->data, info);
@@ -50,6 +55,16 @@ Interrupt CbReportSampleDone(TileReport *report)
   return report->sample_done(report->data);
 }
 
+Interrupt CbReportPassStart(PassReport *report, const PassInfo *info)
+{
+  return report->start(report->data, info);
+}
+
+Interrupt CbReportPassDone(PassReport *report, const PassInfo *info)
+{
+  return report->done(report->data, info);
+}
+
 void CbSetFrameReport(FrameReport *report, void *data,
     FrameStartCallback frame_start,
     FrameAbortCallback frame_abort,
@@ -72,4 +87,13 @@ void CbSetTileReport(TileReport *report, void *data,
   report->sample_done  = (sample_done  == NULL) ? no_sample_report : sample_done;
 }
 
+void CbSetPassReport(PassReport *report, void *data,
+    PassStartCallback pass_start,
+    PassDoneCallback pass_done)
+{
+  report->data = data;
+  report->start = (pass_start == NULL) ? no_pass_report : pass_start;
+  report->done  = (pass_done  == NULL) ? no_pass_report : pass_done;
+}
+
 } // namespace xxx
@@ -44,6 +44,7 @@ public:
       region_id(0),
       total_region_count(0),
       tile_region(),
+      update_region(),
       framebuffer(NULL)
   {}
   ~TileInfo() {}
@@ -54,6 +55,29 @@ public:
   int region_id;
   int total_region_count;
   Rectangle tile_region;
+  // pixels of the framebuffer written by the tile. the tile region
+  // and the margin its samples reach through the pixel filter
+  Rectangle update_region;
+
+  const FrameBuffer *framebuffer;
+};
+
+class PassInfo {
+public:
+  PassInfo() :
+      frame_id(0),
+      pass_id(0),
+      pass_samples(0),
+      total_samples(0),
+      framebuffer(NULL)
+  {}
+  ~PassInfo() {}
+
+public:
+  int32_t frame_id;
+  int pass_id;
+  int pass_samples;  // samples per pixel traced in this pass
+  int total_samples; // samples per pixel accumulated including this pass
 
   const FrameBuffer *framebuffer;
 };
@@ -73,6 +97,9 @@ typedef Interrupt (*TileDoneCallback)(void *data, const TileInfo *info);
 
 typedef Interrupt (*SampleDoneCallback)(void *data);
 
+typedef Interrupt (*PassStartCallback)(void *data, const PassInfo *info);
+typedef Interrupt (*PassDoneCallback)(void *data, const PassInfo *info);
+
 class FrameReport {
 public:
   FrameReport() : data(NULL), start(NULL), done(NULL) {}
@@ -97,6 +124,17 @@ public:
   TileDoneCallback done;
 };
 
+class PassReport {
+public:
+  PassReport() : data(NULL), start(NULL), done(NULL) {}
+  ~PassReport() {}
+
+public:
+  void *data;
+  PassStartCallback start;
+  PassDoneCallback done;
+};
+
 extern Interrupt CbReportFrameStart(FrameReport *report, const FrameInfo *info);
 extern Interrupt CbReportFrameAbort(FrameReport *report, const FrameInfo *info);
 extern Interrupt CbReportFrameDone(FrameReport *report, const FrameInfo *info);
@@ -105,6 +143,9 @@ extern Interrupt CbReportTileStart(TileReport *report, const TileInfo *info);
 extern Interrupt CbReportTileDone(TileReport *report, const TileInfo *info);
 extern Interrupt CbReportSampleDone(TileReport *report);
 
+extern Interrupt CbReportPassStart(PassReport *report, const PassInfo *info);
+extern Interrupt CbReportPassDone(PassReport *report, const PassInfo *info);
+
 extern void CbSetFrameReport(FrameReport *report, void *data,
     FrameStartCallback frame_start,
     FrameAbortCallback frame_abort,
@@ -115,6 +156,10 @@ extern void CbSetTileReport(TileReport *report, void *data,
     SampleDoneCallback sample_done,
     TileDoneCallback tile_done);
 
+extern void CbSetPassReport(PassReport *report, void *data,
+    PassStartCallback pass_start,
+    PassDoneCallback pass_done);
+
 } // namespace xxx
 
 #endif // FJ_XXX_H
@@ -95,6 +95,14 @@ void Camera::GetRay(const Vector2 &screen_uv, Real time, Ray *ray) const
   ray->tmax = zfar_;
 }
 
+Real Camera::GetPixelSpread(int yres) const
+{
+  if (yres < 1) {
+    return 0;
+  }
+  return uv_size_[1] / yres;
+}
+
 void Camera::compute_uv_size()
 {
   uv_size_[1] = 2 * tan(Radian(fov_ / 2.));
@@ -29,6 +29,9 @@ public:
 
   void GetRay(const Vector2 &screen_uv, Real time, Ray *ray) const;
 
+  // width of a pixel at unit distance from the eye
+  Real GetPixelSpread(int yres) const;
+
 private:
   void compute_uv_size();
   Vector compute_ray_target(const Vector2 &uv) const;
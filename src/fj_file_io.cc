@@ -26,6 +26,7 @@ int FjFile_Write##SUFFIX(FILE *file, const TYPE *src, size_t count) \
 }
 
 DEFINE_FILE_READ_WRITE(Int8,   int8_t)
+DEFINE_FILE_READ_WRITE(Int16,  int16_t)
 DEFINE_FILE_READ_WRITE(Int32,  int32_t)
 DEFINE_FILE_READ_WRITE(Int64,  int64_t)
 DEFINE_FILE_READ_WRITE(Float,  float)
@@ -12,12 +12,14 @@ See LICENSE and README
 namespace fj {
 
 int FjFile_ReadInt8    (FILE *file, int8_t  *dst, size_t count);
+int FjFile_ReadInt16   (FILE *file, int16_t *dst, size_t count);
 int FjFile_ReadInt32   (FILE *file, int32_t *dst, size_t count);
 int FjFile_ReadInt64   (FILE *file, int64_t *dst, size_t count);
 int FjFile_ReadFloat   (FILE *file, float   *dst, size_t count);
 int FjFile_ReadDouble  (FILE *file, double  *dst, size_t count);
 
 int FjFile_WriteInt8   (FILE *file, const int8_t  *src, size_t count);
+int FjFile_WriteInt16  (FILE *file, const int16_t *src, size_t count);
 int FjFile_WriteInt32  (FILE *file, const int32_t *src, size_t count);
 int FjFile_WriteInt64  (FILE *file, const int64_t *src, size_t count);
 int FjFile_WriteFloat  (FILE *file, const float   *src, size_t count);
@@ -2,19 +2,28 @@
 // See LICENSE and README
 
 #include "fj_filter.h"
+#include "fj_numeric.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
 namespace fj {
 
-static Real eval_gaussian(Real xwidth, Real ywidth, Real x, Real y);
-static Real eval_box(Real xwidth, Real ywidth, Real x, Real y);
+static const int TABLE_SIZE = 64;
 
-Filter::Filter() :
-    xwidth_(1),
-    ywidth_(1),
-    evaluate_(eval_box)
+typedef Real (*FilterFunction)(Real width, Real x);
+
+static Real eval_box(Real width, Real x);
+static Real eval_gaussian(Real width, Real x);
+static Real eval_mitchell(Real width, Real x);
+static Real eval_blackman_harris(Real width, Real x);
+
+static Real make_table(std::vector<float> &table,
+    FilterFunction evaluate, Real width, Real radius);
+
+Filter::Filter()
 {
+  SetFilterType(FLT_BOX, 1, 1);
 }
 
 Filter::~Filter()
@@ -26,12 +35,20 @@ void Filter::SetFilterType(int filtertype, Real xwidth, Real ywidth)
   assert(xwidth > 0);
   assert(ywidth > 0);
 
+  FilterFunction evaluate = eval_box;
+
   switch (filtertype) {
   case FLT_GAUSSIAN:
-    evaluate_ = eval_gaussian;
+    evaluate = eval_gaussian;
     break;
   case FLT_BOX:
-    evaluate_ = eval_box;
+    evaluate = eval_box;
+    break;
+  case FLT_MITCHELL:
+    evaluate = eval_mitchell;
+    break;
+  case FLT_BLACKMAN_HARRIS:
+    evaluate = eval_blackman_harris;
     break;
   default:
     assert(!"invalid filter type");
@@ -39,27 +56,94 @@ void Filter::SetFilterType(int filtertype, Real xwidth, Real ywidth)
   }
   xwidth_ = xwidth;
   ywidth_ = ywidth;
+
+  // every sample reaches at least the pixel it is in
+  xradius_ = Max(.5 * xwidth, .5);
+  yradius_ = Max(.5 * ywidth, .5);
+
+  xscale_ = make_table(xtable_, evaluate, xwidth_, xradius_);
+  yscale_ = make_table(ytable_, evaluate, ywidth_, yradius_);
+
+  has_negative_lobes_ =
+      *std::min_element(xtable_.begin(), xtable_.end()) < 0 ||
+      *std::min_element(ytable_.begin(), ytable_.end()) < 0;
 }
 
 Real Filter::Evaluate(Real x, Real y) const
 {
-  return evaluate_(xwidth_, ywidth_, x, y);
+  return EvaluateX(x) * EvaluateY(y);
+}
+
+static Real make_table(std::vector<float> &table,
+    FilterFunction evaluate, Real width, Real radius)
+{
+  table.resize(TABLE_SIZE + 1);
+
+  // each entry holds the weight at the middle of its interval
+  for (int i = 0; i < TABLE_SIZE; i++) {
+    const Real x = (i + .5) / TABLE_SIZE * radius;
+    table[i] = evaluate(width, x);
+  }
+  // samples exactly on the radius still reach the pixel
+  table[TABLE_SIZE] = evaluate(width, radius);
+
+  return TABLE_SIZE / radius;
+}
+
+static Real eval_box(Real width, Real x)
+{
+  return 1;
 }
 
-static Real eval_gaussian(Real xwidth, Real ywidth, Real x, Real y)
+static Real eval_gaussian(Real width, Real x)
 {
   // The RenderMan Interface
   // Version 3.2.1
   // November, 2005
-  const Real xx = 2 * x / xwidth;
-  const Real yy = 2 * y / ywidth;
+  const Real xx = 2 * x / width;
 
-  return exp(-2 * ( xx * xx + yy * yy ));
+  return exp(-2 * xx * xx);
 }
 
-static Real eval_box(Real xwidth, Real ywidth, Real x, Real y)
+static Real eval_mitchell(Real width, Real x)
 {
-  return 1;
+  // Mitchell and Netravali, Reconstruction Filters in Computer Graphics
+  // with B = C = 1/3
+  const Real B = 1./3;
+  const Real C = 1./3;
+  const Real xx = Abs(4 * x / width);
+
+  if (xx < 1) {
+    return ((12 - 9 * B - 6 * C) * xx * xx * xx +
+        (-18 + 12 * B + 6 * C) * xx * xx +
+        (6 - 2 * B)) / 6;
+  }
+  else if (xx < 2) {
+    return ((-B - 6 * C) * xx * xx * xx +
+        (6 * B + 30 * C) * xx * xx +
+        (-12 * B - 48 * C) * xx +
+        (8 * B + 24 * C)) / 6;
+  }
+  else {
+    return 0;
+  }
+}
+
+static Real eval_blackman_harris(Real width, Real x)
+{
+  // four term window over the filter width
+  const Real a0 = .35875;
+  const Real a1 = .48829;
+  const Real a2 = .14128;
+  const Real a3 = .01168;
+  const Real n = x / width + .5;
+
+  if (n < 0 || n > 1) {
+    return 0;
+  }
+
+  const Real theta = 2 * PI * n;
+  return a0 - a1 * cos(theta) + a2 * cos(2 * theta) - a3 * cos(3 * theta);
 }
 
 } // namespace xxx
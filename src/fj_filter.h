@@ -5,14 +5,19 @@
 #define FJ_FILTER_H
 
 #include "fj_types.h"
+#include <vector>
 
 namespace fj {
 
 enum {
   FLT_BOX = 0,
-  FLT_GAUSSIAN
+  FLT_GAUSSIAN,
+  FLT_MITCHELL,
+  FLT_BLACKMAN_HARRIS
 };
 
+// filters are separable and evaluated from tables
+// of one dimensional weights along x and y
 class Filter {
 public:
   Filter();
@@ -21,9 +26,28 @@ public:
   void SetFilterType(int filtertype, Real xwidth, Real ywidth);
   Real Evaluate(Real x, Real y) const;
 
+  Real EvaluateX(Real x) const { return lookup(xtable_, xscale_, x); }
+  Real EvaluateY(Real y) const { return lookup(ytable_, yscale_, y); }
+
+  // distance from the center where weights are non-zero
+  Real GetXRadius() const { return xradius_; }
+  Real GetYRadius() const { return yradius_; }
+  // weights of sparse samples can sum up to zero or less with negative lobes
+  bool HasNegativeLobes() const { return has_negative_lobes_; }
+
 private:
+  static Real lookup(const std::vector<float> &table, Real scale, Real x)
+  {
+    const int index = static_cast<int>((x < 0 ? -x : x) * scale);
+    return index < static_cast<int>(table.size()) ? table[index] : 0;
+  }
+
   Real xwidth_, ywidth_;
-  Real (*evaluate_)(Real xwidth, Real ywidth, Real x, Real y);
+  Real xradius_, yradius_;
+  Real xscale_, yscale_;
+  std::vector<float> xtable_;
+  std::vector<float> ytable_;
+  bool has_negative_lobes_;
 };
 
 } // namespace xxx
@@ -4,7 +4,7 @@
 #include "fj_fixed_grid_sampler.h"
 #include "fj_rectangle.h"
 #include "fj_numeric.h"
-#include "fj_random.h"
+#include "fj_low_discrepancy.h"
 
 namespace fj {
 
@@ -14,9 +14,9 @@ FixedGridSampler::FixedGridSampler() :
   nsamples_(1, 1),
   pixel_start_(0, 0),
   margin_(0, 0),
-  npxlsmps_(1, 1),
 
-  current_index_(0)
+  current_index_(0),
+  current_block_(0)
 {
 }
 
@@ -27,21 +27,37 @@ FixedGridSampler::~FixedGridSampler()
 void FixedGridSampler::update_sample_counts()
 {
   margin_ = count_samples_in_margin();
-  npxlsmps_ = count_samples_in_pixel();
+}
+
+static int floor_div(int a, int b)
+{
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
 }
 
 int FixedGridSampler::generate_samples(const Rectangle &region)
 {
+  // samples in the filter margin are traced by the neighbor regions
+  // except on the border of render region
+  const Rectangle &render = GetRenderRegion();
+  Int2 margin_min(0, 0);
+  Int2 margin_max(0, 0);
+  for (int i = 0; i < 2; i++) {
+    margin_min[i] = region.min[i] == render.min[i] ? margin_[i] : 0;
+    margin_max[i] = region.max[i] == render.max[i] ? margin_[i] : 0;
+  }
+
   // allocate samples in region
-  nsamples_ = count_samples_in_region(region);
+  nsamples_ = GetPixelSamples() * region.Size() + margin_min + margin_max;
   samples_.resize(nsamples_[0] * nsamples_[1]);
+  attach_aovs(samples_);
   pixel_start_ = region.min;
   current_index_ = 0;
+  current_block_ = 0;
 
-  XorShift rng; // random number generator
-  XorShift rng_time; // for time sampling jitter
+  const uint32_t seed = LdHash(GetSeed());
 
   const Int2 rate = GetPixelSamples();
+  const int pixel_sample_count = rate[0] * rate[1];
   const Int2 res  = GetResolution();
   const Real jitter = GetJitter();
   const Vector2 sample_time_range = GetSampleTimeRange();
@@ -51,26 +67,34 @@ int FixedGridSampler::generate_samples(const Rectangle &region)
   const Real vdelta = 1./(rate[1] * res[1]);
 
   // xy offset
-  const int xoffset = pixel_start_[0] * rate[0] - margin_[0];
-  const int yoffset = pixel_start_[1] * rate[1] - margin_[1];
+  const int xoffset = pixel_start_[0] * rate[0] - margin_min[0];
+  const int yoffset = pixel_start_[1] * rate[1] - margin_min[1];
 
   Sample *sample = &samples_[0];
 
   for (int y = 0; y < nsamples_[1]; y++) {
     for (int x = 0; x < nsamples_[0]; x++) {
-      sample->uv.x =     (.5 + x + xoffset) * udelta;
-      sample->uv.y = 1 - (.5 + y + yoffset) * vdelta;
-
-      if (IsJittered()) {
-        const Real u_jitter = rng.NextFloat01() * jitter;
-        const Real v_jitter = rng.NextFloat01() * jitter;
-
-        sample->uv.x += udelta * (u_jitter - .5);
-        sample->uv.y += vdelta * (v_jitter - .5);
-      }
+      // samples of a pixel are stratified together with a pattern
+      // unique to the pixel, so neighbor regions generate the same
+      // samples in their margins
+      const int xsample = x + xoffset;
+      const int ysample = y + yoffset;
+      const int xpixel = floor_div(xsample, rate[0]);
+      const int ypixel = floor_div(ysample, rate[1]);
+      const int xstratum = xsample - xpixel * rate[0];
+      const int ystratum = ysample - ypixel * rate[1];
+      const int pixel_sample_id = ystratum * rate[0] + xstratum;
+      const uint32_t pattern =
+          LdHashCombine(LdHashCombine(seed, xpixel), ypixel);
+
+      const Vector2 pos = LdMultiJitter(pixel_sample_id, rate[0], rate[1],
+          pattern, IsJittered() ? jitter : 0);
+
+      sample->uv.x =     (xpixel * rate[0] + pos[0] * rate[0]) * udelta;
+      sample->uv.y = 1 - (ypixel * rate[1] + pos[1] * rate[1]) * vdelta;
 
       if (IsSamplingTime()) {
-        const Real rnd = rng_time.NextFloat01();
+        const Real rnd = LdStratified(pixel_sample_id, pixel_sample_count, pattern);
         sample->time = Fit(rnd, 0, 1, sample_time_range[0], sample_time_range[1]);
       } else {
         sample->time = 0;
@@ -94,32 +118,43 @@ Sample *FixedGridSampler::get_next_sample()
   return sample;
 }
 
-void FixedGridSampler::get_sampleset_in_pixel(std::vector<Sample> &pixelsamples,
-    const Int2 &pixel_pos) const
+int FixedGridSampler::get_next_samples(Sample **samples, int max_samples)
 {
-  const Int2 rate = GetPixelSamples();
-
-  const int XPIXEL_OFFSET = pixel_pos[0] - pixel_start_[0];
-  const int YPIXEL_OFFSET = pixel_pos[1] - pixel_start_[1];
-
-  const int XNSAMPLES = nsamples_[0];
-  const int OFFSET =
-    YPIXEL_OFFSET * rate[1] * XNSAMPLES +
-    XPIXEL_OFFSET * rate[0];
-  const Sample *src = &samples_[OFFSET];
+  // square blocks of samples make coherent packets of camera rays
+  int block_size = 1;
+  while (4 * block_size * block_size <= max_samples) {
+    block_size *= 2;
+  }
 
-  const Int2 NPXLSMPS = count_samples_in_pixel();
-  const std::size_t SAMPLE_COUNT = static_cast<std::size_t>(NPXLSMPS[0] * NPXLSMPS[1]);
-  if (pixelsamples.size() < SAMPLE_COUNT) {
-    pixelsamples.resize(SAMPLE_COUNT);
+  const int xblocks = (nsamples_[0] + block_size - 1) / block_size;
+  const int yblocks = (nsamples_[1] + block_size - 1) / block_size;
+  if (current_block_ >= xblocks * yblocks)
+    return 0;
+
+  const int xmin = (current_block_ % xblocks) * block_size;
+  const int ymin = (current_block_ / xblocks) * block_size;
+  const int xend = xmin + block_size;
+  const int yend = ymin + block_size;
+  const int xmax = xend < nsamples_[0] ? xend : nsamples_[0];
+  const int ymax = yend < nsamples_[1] ? yend : nsamples_[1];
+  current_block_++;
+
+  int count = 0;
+  for (int y = ymin; y < ymax; y++) {
+    for (int x = xmin; x < xmax; x++) {
+      samples[count++] = &samples_[y * nsamples_[0] + x];
+    }
   }
 
-  std::vector<Sample> &dst = pixelsamples;
+  return count;
+}
 
-  for (int y = 0; y < npxlsmps_[1]; y++) {
-    for (int x = 0; x < npxlsmps_[0]; x++) {
-      dst[y * npxlsmps_[0] + x] = src[y * XNSAMPLES + x];
-    }
+void FixedGridSampler::get_owned_samples(std::vector<const Sample *> &samples) const
+{
+  // no sample is shared with neighbor regions
+  samples.reserve(samples_.size());
+  for (std::size_t i = 0; i < samples_.size(); i++) {
+    samples.push_back(&samples_[i]);
   }
 }
 
@@ -135,14 +170,4 @@ Int2 FixedGridSampler::count_samples_in_margin() const
       static_cast<int>(Ceil(((GetFilterWidth()[1] - 1) * GetPixelSamples()[1]) * .5)));
 }
 
-Int2 FixedGridSampler::count_samples_in_pixel() const
-{
-  return  GetPixelSamples() + 2 * margin_;
-}
-
-Int2 FixedGridSampler::count_samples_in_region(const Rectangle &region) const
-{
-  return GetPixelSamples() * region.Size() + 2 * margin_;
-}
-
 } // namespace xxx
@@ -17,12 +17,10 @@ private:
   virtual void update_sample_counts();
   virtual int generate_samples(const Rectangle &region);
   virtual Sample *get_next_sample();
-  virtual void get_sampleset_in_pixel(std::vector<Sample> &pixelsamples,
-      const Int2 &pixel_pos) const;
+  virtual int get_next_samples(Sample **samples, int max_samples);
+  virtual void get_owned_samples(std::vector<const Sample *> &samples) const;
 
   int get_sample_count() const;
-  Int2 count_samples_in_region(const Rectangle &region) const;
-  Int2 count_samples_in_pixel() const;
   Int2 count_samples_in_margin() const;
 
   std::vector<Sample> samples_;
@@ -30,9 +28,9 @@ private:
   Int2 nsamples_;
   Int2 pixel_start_;
   Int2 margin_;
-  Int2 npxlsmps_;
 
   int current_index_;
+  int current_block_;
 };
 
 } // namespace xxx
@@ -194,25 +194,29 @@ int FbSaveCroppedData(FrameBuffer *fb, const char *filename)
     return -1;
   }
 
-  fb->ComputeBounds(databox);
+  BOX2_SET(viewbox, 0, 0, fb->GetWidth(), fb->GetHeight());
+
+  // framebuffers without alpha such as aovs are saved uncropped
+  if (fb->ComputeBounds(databox)) {
+    BOX2_COPY(databox, viewbox);
+  }
 
   xmin = databox[0];
   ymin = databox[1];
   xmax = databox[2];
   ymax = databox[3];
-  BOX2_SET(viewbox, 0, 0, fb->GetWidth(), fb->GetHeight());
 
+  const int nchannels = fb->GetChannelCount();
   FrameBuffer cropped;
-  cropped.Resize(xmax-xmin, ymax-ymin, fb->GetChannelCount());
+  cropped.Resize(xmax-xmin, ymax-ymin, nchannels);
 
   for ( y = ymin; y < ymax; y++) {
     for ( x = xmin; x < xmax; x++) {
       const float *src = (float *) fb->GetReadOnly(x, y, 0);
       float *dst = cropped.GetWritable(x-xmin, y-ymin, 0);
-      dst[0] = src[0];
-      dst[1] = src[1];
-      dst[2] = src[2];
-      dst[3] = src[3];
+      for (int i = 0; i < nchannels; i++) {
+        dst[i] = src[i];
+      }
     }
   }
 
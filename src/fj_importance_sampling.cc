@@ -6,9 +6,11 @@
 #include "fj_texture.h"
 #include "fj_random.h"
 #include "fj_vector.h"
+#include "fj_os.h"
 
+#include <algorithm>
+#include <string>
 #include <vector>
-#include <cstdlib>
 #include <cfloat>
 
 namespace fj {
@@ -22,7 +24,29 @@ public:
   int x, y;
   int label;
 };
-static int compare_sample_point(const void *ptr0, const void *ptr1);
+// Compares labels of sample points for std::stable_sort.
+class LabelLess {
+public:
+  bool operator()(const SamplePoint &a, const SamplePoint &b) const
+  {
+    return a.label < b.label;
+  }
+};
+
+// distributions built for map files. reloading the same file without
+// changes reuses them
+class CachedDistribution {
+public:
+  CachedDistribution() : filename(), modified_time(-1), distribution() {}
+  ~CachedDistribution() {}
+
+  std::string filename;
+  long modified_time;
+  DomeDistribution distribution;
+};
+
+enum { MAX_CACHED_DISTRIBUTIONS = 4 };
+static std::vector<CachedDistribution> distribution_cache;
 
 static void make_histgram(Texture *texture,
     int sample_xres, int sample_yres, double *histgram);
@@ -53,6 +77,101 @@ static void generate_dome_samples(int sample_xres, int sample_yres,
     const int *connected_label, int label_count,
     DomeSample *dome_samples, int sample_count);
 
+DomeDistribution::DomeDistribution() :
+    xres_(0),
+    yres_(0),
+    row_cdf_(),
+    pixel_cdf_(),
+    colors_()
+{
+}
+
+DomeDistribution::~DomeDistribution()
+{
+}
+
+int DomeDistribution::Build(Texture *texture, int xres, int yres)
+{
+  if (texture == NULL || xres < 1 || yres < 1) {
+    return -1;
+  }
+
+  const std::string &filename = texture->GetFilename();
+  const long modified_time = OsGetFileModifiedTime(filename.c_str());
+
+  for (size_t i = 0; i < distribution_cache.size(); i++) {
+    const CachedDistribution &cached = distribution_cache[i];
+    if (cached.filename == filename &&
+        cached.modified_time == modified_time &&
+        cached.distribution.xres_ == xres &&
+        cached.distribution.yres_ == yres) {
+      *this = cached.distribution;
+      return 0;
+    }
+  }
+
+  std::vector<Color4> tex_rgba;
+  if (texture->LookupGrid(xres, yres, &tex_rgba)) {
+    return -1;
+  }
+
+  const int NPIXELS = xres * yres;
+  xres_ = xres;
+  yres_ = yres;
+  row_cdf_.resize(yres);
+  pixel_cdf_.resize(NPIXELS);
+  colors_.resize(NPIXELS);
+
+  double row_sum = 0;
+  for (int y = 0; y < yres; y++) {
+    double pixel_sum = 0;
+    for (int x = 0; x < xres; x++) {
+      const int i = y * xres + x;
+      colors_[i] = Color(tex_rgba[i].r, tex_rgba[i].g, tex_rgba[i].b);
+
+      pixel_sum += Luminance4(tex_rgba[i]);
+      pixel_cdf_[i] = pixel_sum;
+    }
+    row_sum += pixel_sum;
+    row_cdf_[y] = row_sum;
+  }
+
+  // the oldest one goes first
+  if (distribution_cache.size() == MAX_CACHED_DISTRIBUTIONS) {
+    distribution_cache.erase(distribution_cache.begin());
+  }
+  distribution_cache.push_back(CachedDistribution());
+  distribution_cache.back().filename = filename;
+  distribution_cache.back().modified_time = modified_time;
+  distribution_cache.back().distribution = *this;
+
+  return 0;
+}
+
+bool DomeDistribution::IsEmpty() const
+{
+  return colors_.empty();
+}
+
+void DomeDistribution::Sample(const Vector2 &rand, DomeSample *sample) const
+{
+  // zero luminance rows and pixels are never chosen since their cdfs
+  // equal the previous ones
+  const double row_key = rand[0] * row_cdf_.back();
+  int y = std::upper_bound(row_cdf_.begin(), row_cdf_.end(), row_key) -
+      row_cdf_.begin();
+  y = y < yres_ ? y : yres_ - 1;
+
+  const double *row = &pixel_cdf_[y * xres_];
+  const double pixel_key = rand[1] * row[xres_ - 1];
+  int x = std::upper_bound(row, row + xres_, pixel_key) - row;
+  x = x < xres_ ? x : xres_ - 1;
+
+  xy_to_uv(xres_, yres_, x, y, &sample->uv);
+  uv_to_dir(sample->uv.u, sample->uv.v, &sample->dir);
+  sample->color = colors_[y * xres_ + x];
+}
+
 int ImportanceSampling(Texture *texture, int seed,
     int sample_xres, int sample_yres,
     DomeSample *dome_samples, int sample_count)
@@ -223,31 +342,27 @@ static void make_histgram(Texture *texture,
     int sample_xres, int sample_yres, double *histgram)
 {
   const int NPIXELS = sample_xres * sample_yres;
+  std::vector<Color4> tex_rgba;
   double sum = 0;
   int i;
 
-  for (i = 0; i < NPIXELS; i++) {
-    Color4 tex_rgba;
-    TexCoord uv;
+  // the grid has the same pixel centers as index_to_uv()
+  texture->LookupGrid(sample_xres, sample_yres, &tex_rgba);
 
-    index_to_uv(sample_xres, sample_yres, i, &uv);
-    tex_rgba = texture->Lookup(uv.u, uv.v);
-
-    sum += Luminance4(tex_rgba);
+  for (i = 0; i < NPIXELS; i++) {
+    sum += Luminance4(tex_rgba[i]);
     histgram[i] = sum;
   }
 }
 
 static int lookup_histgram(const double *histgram, int pixel_count, double key_value)
 {
-  int i;
+  const double *found = std::upper_bound(histgram, histgram + pixel_count, key_value);
 
-  for (i = 0; i < pixel_count; i++) {
-    if (key_value < histgram[i]) {
-      return i;
-    }
+  if (found == histgram + pixel_count) {
+    return -1;
   }
-  return -1;
+  return found - histgram;
 }
 
 static void index_to_uv(int xres, int yres, int index, TexCoord *uv)
@@ -284,16 +399,13 @@ static void setup_structured_importance_sampling(Texture *texture,
   double *L = illum_values;
   double L_whole = 0;
   double L_mean = 0;
+  std::vector<Color4> tex_rgba;
   int i;
 
-  for (i = 0; i < NPIXELS; i++) {
-    Color4 tex_rgba;
-    TexCoord uv;
+  texture->LookupGrid(sample_xres, sample_yres, &tex_rgba);
 
-    index_to_uv(sample_xres, sample_yres, i, &uv);
-    tex_rgba = texture->Lookup(uv.u, uv.v);
-
-    L[i] = Luminance4(tex_rgba);
+  for (i = 0; i < NPIXELS; i++) {
+    L[i] = Luminance4(tex_rgba[i]);
     L_whole += L[i];
   }
   L_mean = L_whole / NPIXELS;
@@ -479,10 +591,7 @@ static void generate_dome_samples(int sample_xres, int sample_yres,
     samples[i].y = (int) (i / sample_xres);
     samples[i].label = connected_label[i];
   }
-  // TODO use std::sort
-  qsort(&samples[0], NPIXELS,
-      sizeof(SamplePoint),
-      compare_sample_point);
+  std::stable_sort(samples.begin(), samples.end(), LabelLess());
 
   {
     int curr = 0;
@@ -559,19 +668,4 @@ static void generate_dome_samples(int sample_xres, int sample_yres,
   }
 }
 
-static int compare_sample_point(const void *ptr0, const void *ptr1)
-{
-  const SamplePoint *sample0 = (const SamplePoint *) ptr0;
-  const SamplePoint *sample1 = (const SamplePoint *) ptr1;
-  const double x = sample0->label;
-  const double y = sample1->label;
-
-  if (x > y)
-    return 1;
-  else if (x < y)
-    return -1;
-  else
-    return 0;
-}
-
 } // namespace xxx
@@ -8,6 +8,8 @@
 #include "fj_vector.h"
 #include "fj_color.h"
 
+#include <vector>
+
 namespace fj {
 
 class Texture;
@@ -23,6 +25,31 @@ public:
   Vector dir;
 };
 
+// Distribution of directions over an environment map proportional to
+// the luminance of its pixels. Each shading point can draw its own
+// samples with binary searches in the cdf of rows and the cdf of
+// pixels in the chosen row.
+class DomeDistribution {
+public:
+  DomeDistribution();
+  ~DomeDistribution();
+
+  // the map is resampled to xres x yres pixels
+  int Build(Texture *texture, int xres, int yres);
+  bool IsEmpty() const;
+
+  // draws a direction and its color for a point in [0, 1)^2
+  void Sample(const Vector2 &rand, DomeSample *sample) const;
+
+private:
+  int xres_;
+  int yres_;
+  // cumulative luminance of rows and of pixels in each row
+  std::vector<double> row_cdf_;
+  std::vector<double> pixel_cdf_;
+  std::vector<Color> colors_;
+};
+
 extern int ImportanceSampling(Texture *texture, int seed,
     int sample_xres, int sample_yres,
     DomeSample *dome_samples, int sample_count);
@@ -4,16 +4,22 @@
 #include "fj_interval.h"
 #include "fj_numeric.h"
 
+#include <algorithm>
+#include <cassert>
+
 namespace fj {
 
-static void free_interval_nodes(Interval *head);
-static int closer_than(const Interval *interval, const Interval *other);
-static Interval *dup_interval(const Interval &src);
-static void free_interval(Interval *interval);
+class IntervalLess {
+public:
+  bool operator()(const Interval &a, const Interval &b) const
+  {
+    return a.tmin < b.tmin;
+  }
+};
 
 IntervalList::IntervalList() :
-    root_(),
-    num_nodes_(0),
+    intervals_(),
+    spans_(),
     tmin_(REAL_MAX),
     tmax_(-REAL_MAX)
 {
@@ -21,29 +27,53 @@ IntervalList::IntervalList() :
 
 IntervalList::~IntervalList()
 {
-  free_interval_nodes(root_.next);
 }
 
 void IntervalList::Push(const Interval &interval)
 {
-  Interval *new_node = dup_interval(interval);
-  Interval *current = NULL;
-
-  for (current = &root_; current != NULL; current = current->next) {
-    if (current->next == NULL || closer_than(&interval, current->next)) {
-      new_node->next = current->next;
-      current->next = new_node;
-      break;
-    }
-  }
-  num_nodes_++;
+  intervals_.push_back(interval);
+  intervals_.back().next = NULL;
+
   tmin_ = Min(tmin_, interval.tmin);
   tmax_ = Max(tmax_, interval.tmax);
 }
 
+void IntervalList::SortAndMerge()
+{
+  spans_.clear();
+  if (intervals_.empty()) {
+    return;
+  }
+
+  // stable sort keeps push order of intervals with the same tmin
+  std::stable_sort(intervals_.begin(), intervals_.end(), IntervalLess());
+
+  const int N = static_cast<int>(intervals_.size());
+  for (int i = 0; i < N - 1; i++) {
+    intervals_[i].next = &intervals_[i + 1];
+  }
+  intervals_[N - 1].next = NULL;
+
+  Interval span;
+  span.tmin = intervals_[0].tmin;
+  span.tmax = intervals_[0].tmax;
+
+  for (int i = 1; i < N; i++) {
+    const Interval &interval = intervals_[i];
+    if (interval.tmin > span.tmax) {
+      spans_.push_back(span);
+      span.tmin = interval.tmin;
+      span.tmax = interval.tmax;
+    } else {
+      span.tmax = Max(span.tmax, interval.tmax);
+    }
+  }
+  spans_.push_back(span);
+}
+
 int IntervalList::GetCount() const
 {
-  return num_nodes_;
+  return static_cast<int>(intervals_.size());
 }
 
 Real IntervalList::GetMinT() const
@@ -58,41 +88,21 @@ Real IntervalList::GetMaxT() const
 
 const Interval *IntervalList::GetHead() const
 {
-  return root_.next;
-}
-
-static void free_interval_nodes(Interval *head)
-{
-  Interval *current = head;
-
-  while (current != NULL) {
-    Interval *kill = current;
-    Interval *next = current->next;
-    free_interval(kill);
-    current = next;
+  if (intervals_.empty()) {
+    return NULL;
   }
+  return &intervals_[0];
 }
 
-static int closer_than(const Interval *interval, const Interval *other)
+int IntervalList::GetSpanCount() const
 {
-  if (interval->tmin < other->tmin)
-    return 1;
-  else
-    return 0;
-}
-
-static Interval *dup_interval(const Interval &src)
-{
-  Interval *new_interval = new Interval(src);
-
-  new_interval->next = NULL;
-
-  return new_interval;
+  return static_cast<int>(spans_.size());
 }
 
-static void free_interval(Interval *interval)
+const Interval &IntervalList::GetSpan(int index) const
 {
-  delete interval;
+  assert(index >= 0 && index < GetSpanCount());
+  return spans_[index];
 }
 
 } // namespace xxx
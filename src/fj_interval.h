@@ -6,6 +6,7 @@
 
 #include "fj_types.h"
 #include <cstddef>
+#include <vector>
 
 namespace fj {
 
@@ -30,12 +31,15 @@ public:
   Interval *next;
 };
 
+// Intervals are pushed in any order then SortAndMerge() links them
+// by tmin and builds the merged spans where any volume is present.
 class IntervalList {
 public:
   IntervalList();
   ~IntervalList();
 
   void Push(const Interval &interval);
+  void SortAndMerge();
   int GetCount() const;
 
   Real GetMinT() const;
@@ -43,9 +47,13 @@ public:
 
   const Interval *GetHead() const;
 
+  // spans have no object
+  int GetSpanCount() const;
+  const Interval &GetSpan(int index) const;
+
 private:
-  Interval root_;
-  int num_nodes_;
+  std::vector<Interval> intervals_;
+  std::vector<Interval> spans_;
   Real tmin_;
   Real tmax_;
 };
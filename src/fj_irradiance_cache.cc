@@ -0,0 +1,130 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "fj_irradiance_cache.h"
+#include <functional>
+#include <cmath>
+
+namespace fj {
+
+// records facing away more than this are not interpolated
+static const Real NORMAL_TOLERANCE = .9;
+
+static int cell_index(Real x, Real cell_size)
+{
+  return (int) floor(x / cell_size);
+}
+
+bool IrradianceCache::CellKey::operator<(const CellKey &other) const
+{
+  if (obj != other.obj)         return obj < other.obj;
+  if (owner != other.owner)     return std::less<const void *>()(owner, other.owner);
+  if (spacing != other.spacing) return spacing < other.spacing;
+  if (x != other.x)             return x < other.x;
+  if (y != other.y)             return y < other.y;
+  return z < other.z;
+}
+
+IrradianceCache::IrradianceCache()
+{
+}
+
+IrradianceCache::~IrradianceCache()
+{
+}
+
+bool IrradianceCache::Lookup(const ObjectInstance *obj, const void *owner,
+    const Vector &P, const Vector &N, Real spacing, Color *irradiance) const
+{
+  // a cell is twice as large as the spacing so that a record
+  // overlaps no more than two cells on each axis
+  const Real cell_size = 2 * spacing;
+  CellKey key;
+  key.obj = obj;
+  key.owner = owner;
+  key.spacing = spacing;
+  key.x = cell_index(P.x, cell_size);
+  key.y = cell_index(P.y, cell_size);
+  key.z = cell_index(P.z, cell_size);
+
+  std::map<CellKey, std::vector<int> >::const_iterator it = cell_map_.find(key);
+  if (it == cell_map_.end()) {
+    return false;
+  }
+
+  const std::vector<int> &cell = it->second;
+  Color sum;
+  Real weight_sum = 0;
+
+  for (std::size_t i = 0; i < cell.size(); i++) {
+    const IrradianceRecord &rec = records_[cell[i]];
+    const Real dist = Length(P - rec.P);
+    const Real N_dot_Ni = Dot(N, rec.N);
+
+    if (dist >= spacing || N_dot_Ni <= NORMAL_TOLERANCE) {
+      continue;
+    }
+
+    const Real weight = (1 - dist / spacing) *
+        (N_dot_Ni - NORMAL_TOLERANCE) / (1 - NORMAL_TOLERANCE);
+    sum += weight * rec.irradiance;
+    weight_sum += weight;
+  }
+
+  if (weight_sum <= 0) {
+    return false;
+  }
+
+  *irradiance = sum / weight_sum;
+  return true;
+}
+
+void IrradianceCache::Insert(const ObjectInstance *obj, const void *owner,
+    const Vector &P, const Vector &N, Real spacing, const Color &irradiance)
+{
+  const Real cell_size = 2 * spacing;
+  const int record_id = records_.size();
+
+  IrradianceRecord rec;
+  rec.P = P;
+  rec.N = N;
+  rec.irradiance = irradiance;
+  records_.push_back(rec);
+
+  // register the record to every cell its sphere of the spacing overlaps
+  const int xmin = cell_index(P.x - spacing, cell_size);
+  const int ymin = cell_index(P.y - spacing, cell_size);
+  const int zmin = cell_index(P.z - spacing, cell_size);
+  const int xmax = cell_index(P.x + spacing, cell_size);
+  const int ymax = cell_index(P.y + spacing, cell_size);
+  const int zmax = cell_index(P.z + spacing, cell_size);
+
+  CellKey key;
+  key.obj = obj;
+  key.owner = owner;
+  key.spacing = spacing;
+
+  for (int z = zmin; z <= zmax; z++) {
+    for (int y = ymin; y <= ymax; y++) {
+      for (int x = xmin; x <= xmax; x++) {
+        key.x = x;
+        key.y = y;
+        key.z = z;
+        cell_map_[key].push_back(record_id);
+      }
+    }
+  }
+}
+
+void IrradianceCache::Clear()
+{
+  cell_map_.clear();
+  records_.clear();
+}
+
+int IrradianceCache::GetRecordCount() const
+{
+  return records_.size();
+}
+
+} // namespace xxx
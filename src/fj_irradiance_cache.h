@@ -0,0 +1,65 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#ifndef FJ_IRRADIANCE_CACHE_H
+#define FJ_IRRADIANCE_CACHE_H
+
+#include "fj_vector.h"
+#include "fj_color.h"
+#include "fj_types.h"
+#include <vector>
+#include <map>
+
+namespace fj {
+
+class ObjectInstance;
+
+class IrradianceRecord {
+public:
+  IrradianceRecord() {}
+  ~IrradianceRecord() {}
+
+  Vector P;
+  Vector N;
+  Color irradiance;
+};
+
+// caches view independent shading results such as diffusion of
+// subsurface scattering so that neighboring shading points can reuse
+// them. records are valid within the spacing of the shader and only
+// for the object and the shader that stored them. one cache is owned by one thread
+// and needs no locks. renderer clears it for every tile
+class IrradianceCache {
+public:
+  IrradianceCache();
+  ~IrradianceCache();
+
+  // returns false when no record is close enough to P and N
+  bool Lookup(const ObjectInstance *obj, const void *owner,
+      const Vector &P, const Vector &N,
+      Real spacing, Color *irradiance) const;
+  void Insert(const ObjectInstance *obj, const void *owner,
+      const Vector &P, const Vector &N,
+      Real spacing, const Color &irradiance);
+
+  void Clear();
+  int GetRecordCount() const;
+
+private:
+  class CellKey {
+  public:
+    bool operator<(const CellKey &other) const;
+
+    const ObjectInstance *obj;
+    const void *owner;
+    Real spacing;
+    int x, y, z;
+  };
+
+  std::map<CellKey, std::vector<int> > cell_map_;
+  std::vector<IrradianceRecord> records_;
+};
+
+} // namespace xxx
+
+#endif // FJ_XXX_H
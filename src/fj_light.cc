@@ -6,34 +6,37 @@
 #include "fj_framebuffer.h"
 #include "fj_numeric.h"
 #include "fj_texture.h"
+#include "fj_low_discrepancy.h"
+#include <cassert>
 #include <cfloat>
+#include <cmath>
 
 namespace fj {
 
 static int point_light_get_sample_count(const Light *light);
-static void point_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples);
+static void point_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble);
 static void point_light_illuminate(const Light *light,
     const LightSample *sample,
     const Vector *Ps, Color *Cl);
 
 static int grid_light_get_sample_count(const Light *light);
-static void grid_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples);
+static void grid_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble);
 static void grid_light_illuminate(const Light *light,
     const LightSample *sample,
     const Vector *Ps, Color *Cl);
 
 static int sphere_light_get_sample_count(const Light *light);
-static void sphere_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples);
+static void sphere_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble);
 static void sphere_light_illuminate(const Light *light,
     const LightSample *sample,
     const Vector *Ps, Color *Cl);
 
 static int dome_light_get_sample_count(const Light *light);
-static void dome_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples);
+static void dome_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble);
 static void dome_light_illuminate(const Light *light,
     const LightSample *sample,
     const Vector *Ps, Color *Cl);
@@ -45,7 +48,6 @@ Light::Light() :
   color_(1, 1, 1),
   intensity_(1),
   transform_samples_(),
-  rng_(),
 
   type_(LGT_POINT),
   double_sided_(false),
@@ -53,7 +55,14 @@ Light::Light() :
   sample_intensity_(intensity_ / sample_count_),
 
   environment_map_(NULL),
-  dome_samples_(),
+  dome_distribution_(),
+  distribution_xres_(0),
+  distribution_yres_(0),
+  has_preprocessed_(false),
+  static_transform_(),
+  is_static_(false),
+  center_(),
+  radius_(0),
 
   GetSampleCount_(NULL),
   GetSamples_(NULL),
@@ -70,9 +79,9 @@ Light::~Light()
 void Light::SetLightType(int light_type)
 {
   type_ = light_type;
+  has_preprocessed_ = false;
 
   XfmInitTransformSampleList(&transform_samples_);
-  rng_ = XorShift();
 
   switch (type_) {
   case LGT_POINT:
@@ -137,6 +146,14 @@ void Light::SetDoubleSided(bool on_or_off)
 void Light::SetEnvironmentMap(Texture *texture)
 {
   environment_map_ = texture;
+  has_preprocessed_ = false;
+}
+
+void Light::SetDistributionResolution(int xres, int yres)
+{
+  distribution_xres_ = xres > 0 ? xres : 0;
+  distribution_yres_ = yres > 0 ? yres : 0;
+  has_preprocessed_ = false;
 }
 
 void Light::SetTranslate(Real tx, Real ty, Real tz, Real time)
@@ -164,9 +181,17 @@ void Light::SetRotateOrder(int order)
   XfmSetSampleRotateOrder(&transform_samples_, order);
 }
 
-void Light::GetSamples(LightSample *samples, int max_samples) const
+void Light::GetSamples(LightSample *samples, int max_samples,
+    uint32_t scramble, Real time) const
 {
-  GetSamples_(this, samples, max_samples);
+  if (is_static_) {
+    GetSamples_(this, &static_transform_, samples, max_samples, scramble);
+    return;
+  }
+
+  Transform transform_interp;
+  get_transform(time, &transform_interp);
+  GetSamples_(this, &transform_interp, samples, max_samples, scramble);
 }
 
 int Light::GetSampleCount() const
@@ -174,6 +199,25 @@ int Light::GetSampleCount() const
   return GetSampleCount_(this);
 }
 
+bool Light::IsInfinite() const
+{
+  return type_ == LGT_DOME;
+}
+
+Real Light::EstimateContribution(const Vector &Ps) const
+{
+  const Real power = intensity_ * Luminance(color_);
+
+  if (IsInfinite()) {
+    return power;
+  }
+
+  // points closer than the size of the light do not get brighter
+  const Vector to_light = center_ - Ps;
+  const Real dist2 = Dot(to_light, to_light);
+  return power / Max(Max(dist2, radius_ * radius_), .0001);
+}
+
 Color Light::Illuminate(const LightSample &sample, const Vector &Ps) const
 {
   Color Cl;
@@ -183,7 +227,98 @@ Color Light::Illuminate(const LightSample &sample, const Vector &Ps) const
 
 int Light::Preprocess()
 {
-  return Preprocess_(this);
+  // transforms can change between renders without clearing the flag
+  update_static_transform();
+  update_extent();
+
+  if (has_preprocessed_) {
+    return 0;
+  }
+
+  const int err = Preprocess_(this);
+  if (err == 0) {
+    has_preprocessed_ = true;
+  }
+  return err;
+}
+
+LightSampleStack::LightSampleStack() : arrays_(), capacities_(), top_(0)
+{
+}
+
+LightSampleStack::~LightSampleStack()
+{
+  for (std::size_t i = 0; i < arrays_.size(); i++) {
+    delete [] arrays_[i];
+  }
+}
+
+LightSample *LightSampleStack::Push(int count)
+{
+  if (top_ == (int) arrays_.size()) {
+    arrays_.push_back(NULL);
+    capacities_.push_back(0);
+  }
+
+  // arrays above the top are not in use and can be reallocated
+  if (capacities_[top_] < count) {
+    delete [] arrays_[top_];
+    arrays_[top_] = new LightSample[count];
+    capacities_[top_] = count;
+  }
+
+  return arrays_[top_++];
+}
+
+void LightSampleStack::Pop(const LightSample *samples)
+{
+  assert(top_ > 0 && arrays_[top_ - 1] == samples);
+  top_--;
+}
+
+void Light::update_static_transform()
+{
+  const TransformSampleList &list = transform_samples_;
+
+  is_static_ =
+      list.translate.sample_count <= 1 &&
+      list.rotate.sample_count <= 1 &&
+      list.scale.sample_count <= 1;
+
+  if (is_static_) {
+    XfmLerpTransformSample(&list, 0, &static_transform_);
+  }
+}
+
+void Light::get_transform(Real time, Transform *transform) const
+{
+  if (is_static_) {
+    *transform = static_transform_;
+    return;
+  }
+  XfmLerpTransformSample(&transform_samples_, time, transform);
+}
+
+void Light::update_extent()
+{
+  Transform transform;
+  get_transform(0, &transform);
+
+  center_ = Vector(0, 0, 0);
+  XfmTransformPoint(&transform, &center_);
+
+  const Vector &scale = transform.scale;
+  radius_ = Max(Abs(scale.x), Max(Abs(scale.y), Abs(scale.z)));
+  switch (type_) {
+  case LGT_POINT:
+    radius_ = 0;
+    break;
+  case LGT_GRID:
+    radius_ *= .5;
+    break;
+  default:
+    break;
+  }
 }
 
 // point light
@@ -192,17 +327,13 @@ static int point_light_get_sample_count(const Light *light)
   return 1;
 }
 
-static void point_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples)
+static void point_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble)
 {
   if (max_samples == 0)
     return;
 
-  Transform transform_interp;
-  // TODO time sampling
-  XfmLerpTransformSample(&light->transform_samples_, 0, &transform_interp);
-
-  samples[0].P = transform_interp.translate;
+  samples[0].P = transform->translate;
   samples[0].N = Vector(0, 0, 0);
   samples[0].light = light;
 }
@@ -220,29 +351,25 @@ static int grid_light_get_sample_count(const Light *light)
   return light->sample_count_;
 }
 
-static void grid_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples)
+static void grid_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble)
 {
-  Transform transform_interp;
-  // TODO time sampling
-  XfmLerpTransformSample(&light->transform_samples_, 0, &transform_interp);
-
   Vector N_sample(0, 1, 0);
-  XfmTransformVector(&transform_interp, &N_sample);
+  XfmTransformVector(transform, &N_sample);
   Normalize(&N_sample);
 
   int nsamples = light->GetSampleCount();
   nsamples = Min(nsamples, max_samples);
 
   for (int i = 0; i < nsamples; i++) {
-    XorShift &mutable_rng = const_cast<XorShift &>(light->rng_);
-    const Real x = mutable_rng.NextFloat01() - .5;
-    const Real z = mutable_rng.NextFloat01() - .5;
+    const Vector2 uv = LdSample02(i, scramble);
+    const Real x = uv[0] - .5;
+    const Real z = uv[1] - .5;
     Vector P_sample;
     P_sample.x = x;
     P_sample.z = z;
 
-    XfmTransformPoint(&transform_interp, &P_sample);
+    XfmTransformPoint(transform, &P_sample);
 
     samples[i].P = P_sample;
     samples[i].N = N_sample;
@@ -274,26 +401,25 @@ static int sphere_light_get_sample_count(const Light *light)
   return light->sample_count_;
 }
 
-static void sphere_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples)
+static void sphere_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble)
 {
-  Transform transform_interp;
-  // TODO time sampling
-  XfmLerpTransformSample(&light->transform_samples_, 0, &transform_interp);
-
   int nsamples = light->GetSampleCount();
   nsamples = Min(nsamples, max_samples);
 
   for (int i = 0; i < nsamples; i++) {
-    XorShift &mutable_rng = const_cast<XorShift &>(light->rng_);
-    Vector P_sample;
+    // uniform on the unit sphere
+    const Vector2 uv = LdSample02(i, scramble);
+    const Real z = 1 - 2 * uv[0];
+    const Real r = sqrt(Max(1 - z * z, 0.));
+    const Real phi = 2 * PI * uv[1];
+    Vector P_sample(r * cos(phi), r * sin(phi), z);
     Vector N_sample;
 
-    P_sample = mutable_rng.HollowSphereRand();
     N_sample = P_sample;
 
-    XfmTransformPoint(&transform_interp, &P_sample);
-    XfmTransformVector(&transform_interp, &N_sample);
+    XfmTransformPoint(transform, &P_sample);
+    XfmTransformVector(transform, &N_sample);
     Normalize(&N_sample);
 
     samples[i].P = P_sample;
@@ -323,30 +449,36 @@ static int dome_light_get_sample_count(const Light *light)
   return light->sample_count_;
 }
 
-static void dome_light_get_samples(const Light *light,
-    LightSample *samples, int max_samples)
+static void dome_light_get_samples(const Light *light, const Transform *transform,
+    LightSample *samples, int max_samples, uint32_t scramble)
 {
-  Transform transform_interp;
-  // TODO time sampling
-  XfmLerpTransformSample(&light->transform_samples_, 0, &transform_interp);
-
   int nsamples = light->GetSampleCount();
   nsamples = Min(nsamples, max_samples);
 
+  // no environment map
+  DomeSample dome_sample;
+  dome_sample.uv = TexCoord(1./nsamples, 1./nsamples);
+  dome_sample.color = Color(1, .63, .63);
+  dome_sample.dir = Vector(1./nsamples, 1, 1./nsamples);
+  Normalize(&dome_sample.dir);
+
   for (int i = 0; i < nsamples; i++) {
-    const DomeSample *dome_sample = &light->dome_samples_[i];
+    // fresh directions for each shading point
+    if (!light->dome_distribution_.IsEmpty()) {
+      light->dome_distribution_.Sample(LdSample02(i, scramble), &dome_sample);
+    }
 
     // TODO CHANGE IT TO REAL_MAX WHEN FINISHING IT TO OTHERS
-    Vector P_sample = dome_sample->dir * FLT_MAX;
-    Vector N_sample = -1 * dome_sample->dir;
+    Vector P_sample = dome_sample.dir * FLT_MAX;
+    Vector N_sample = -1 * dome_sample.dir;
 
     // TODO cancel translate and scale
-    XfmTransformPoint(&transform_interp, &P_sample);
-    XfmTransformVector(&transform_interp, &N_sample);
+    XfmTransformPoint(transform, &P_sample);
+    XfmTransformVector(transform, &N_sample);
 
     samples[i].P = P_sample;
     samples[i].N = N_sample;
-    samples[i].color = dome_sample->color;
+    samples[i].color = dome_sample.color;
     samples[i].light = light;
   }
 }
@@ -360,40 +492,23 @@ static void dome_light_illuminate(const Light *light,
 
 static int dome_light_preprocess(Light *light)
 {
-  const int NSAMPLES = light->GetSampleCount();
-  DomeSample init_sample;
-  init_sample.uv = TexCoord(1./NSAMPLES, 1./NSAMPLES);
-  init_sample.color = Color(1, .63, .63);
-  init_sample.dir = Vector(1./NSAMPLES, 1, 1./NSAMPLES);
-  Normalize(&init_sample.dir);
-
-  light->dome_samples_.resize(NSAMPLES, init_sample);
-  std::vector<DomeSample>(light->dome_samples_).swap(light->dome_samples_);
+  light->dome_distribution_ = DomeDistribution();
 
   if (light->environment_map_ == NULL) {
     // TODO should be an error?
     return 0;
   }
 
-  int XRES = light->environment_map_->GetWidth();
-  int YRES = light->environment_map_->GetHeight();
-  // TODO parameteraize
-  XRES /= 8;
-  YRES /= 8;
-
-  if (0) {
-    ImportanceSampling(light->environment_map_, 0,
-        XRES, YRES,
-        &light->dome_samples_[0], NSAMPLES);
-  } else if (1) {
-    StratifiedImportanceSampling(light->environment_map_, 0,
-        XRES, YRES,
-        &light->dome_samples_[0], NSAMPLES);
-  } else {
-    StructuredImportanceSampling(light->environment_map_, 0,
-        XRES, YRES,
-        &light->dome_samples_[0], NSAMPLES);
+  int XRES = light->distribution_xres_;
+  int YRES = light->distribution_yres_;
+  if (XRES == 0) {
+    XRES = light->environment_map_->GetWidth() / 8;
   }
+  if (YRES == 0) {
+    YRES = light->environment_map_->GetHeight() / 8;
+  }
+
+  light->dome_distribution_.Build(light->environment_map_, XRES, YRES);
 
   return 0;
 }
@@ -7,7 +7,6 @@
 #include "fj_compatibility.h"
 #include "fj_importance_sampling.h"
 #include "fj_transform.h"
-#include "fj_random.h"
 #include "fj_vector.h"
 #include "fj_color.h"
 #include "fj_types.h"
@@ -27,13 +26,31 @@ class Texture;
 
 class LightSample {
 public:
-  LightSample() : light(NULL), P(), N(), color() {}
+  LightSample() : light(NULL), P(), N(), color(), weight(1) {}
   ~LightSample() {}
 
   const Light *light;
   Vector P;
   Vector N;
   Color color;
+  // scales the illumination when only some of the lights are sampled
+  float weight;
+};
+
+// light sample arrays reused by a thread. shaders nest through traced
+// rays so that arrays are taken and given back in last in first out order
+class LightSampleStack {
+public:
+  LightSampleStack();
+  ~LightSampleStack();
+
+  LightSample *Push(int count);
+  void Pop(const LightSample *samples);
+
+private:
+  std::vector<LightSample *> arrays_;
+  std::vector<int> capacities_;
+  int top_;
 };
 
 class Light {
@@ -49,6 +66,9 @@ public:
   void SetSampleCount(int sample_count);
   void SetDoubleSided(bool on_or_off);
   void SetEnvironmentMap(Texture *texture);
+  // resolution of the map that dome light samples are drawn from.
+  // 0 uses 1/8 of the environment map resolution
+  void SetDistributionResolution(int xres, int yres);
 
   // transformation
   void SetTranslate(Real tx, Real ty, Real tz, Real time);
@@ -58,9 +78,20 @@ public:
   void SetRotateOrder(int order);
 
   // samples
-  void GetSamples(LightSample *samples, int max_samples) const;
+  // scramble decorrelates the sample patterns between shading points.
+  // samples are taken from the light transformed at time
+  void GetSamples(LightSample *samples, int max_samples,
+      uint32_t scramble, Real time) const;
   int GetSampleCount() const;
+  // lights at infinity have no position to estimate contribution
+  bool IsInfinite() const;
+  // rough estimate of light arriving at Ps ignoring occlusion and
+  // orientation. used to choose lights to sample among many lights.
+  // valid after Preprocess()
+  Real EstimateContribution(const Vector &Ps) const;
   Color Illuminate(const LightSample &sample, const Vector &Ps) const;
+  // does nothing but caching the transforms and the extent of the light
+  // until the type or environment map changes
   int Preprocess();
 
 public: // TODO ONCE FINISHING INHERITANCE MAKE IT PRAIVATE
@@ -70,9 +101,6 @@ public: // TODO ONCE FINISHING INHERITANCE MAKE IT PRAIVATE
   // transformation properties
   TransformSampleList transform_samples_;
 
-  // for area light sampling
-  XorShift rng_;
-
   int type_;
   bool double_sided_;
   int sample_count_;
@@ -80,13 +108,29 @@ public: // TODO ONCE FINISHING INHERITANCE MAKE IT PRAIVATE
 
   Texture *environment_map_;
   // TODO tmp solution for dome light data
-  std::vector<DomeSample> dome_samples_;
+  DomeDistribution dome_distribution_;
+  int distribution_xres_;
+  int distribution_yres_;
+  bool has_preprocessed_;
+
+  // transform of a light without motion. moving lights compute
+  // the exact one at the time of each sampling
+  Transform static_transform_;
+  bool is_static_;
+
+  // sphere bounding the light at time 0 for EstimateContribution
+  Vector center_;
+  Real radius_;
+
+  void update_static_transform();
+  void update_extent();
+  void get_transform(Real time, Transform *transform) const;
 
   // TODO USE INHERITANCE
   // functions
   int (*GetSampleCount_)(const Light *light);
-  void (*GetSamples_)(const Light *light,
-      LightSample *samples, int max_samples);
+  void (*GetSamples_)(const Light *light, const Transform *transform,
+      LightSample *samples, int max_samples, uint32_t scramble);
   void (*Illuminate_)(const Light *light,
       const LightSample *sample,
       const Vector *Ps, Color *Cl);
@@ -0,0 +1,143 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "fj_low_discrepancy.h"
+#include <cstring>
+
+namespace fj {
+
+static const double ONE_OVER_2_32 = 1. / 4294967296.;
+
+uint32_t LdHash(uint32_t a)
+{
+  // integer hash by Thomas Wang
+  a = (a ^ 61) ^ (a >> 16);
+  a = a + (a << 3);
+  a = a ^ (a >> 4);
+  a = a * 0x27d4eb2d;
+  a = a ^ (a >> 15);
+  return a;
+}
+
+uint32_t LdHashCombine(uint32_t seed, uint32_t a)
+{
+  return LdHash(seed ^ (a + 0x9e3779b9 + (seed << 6) + (seed >> 2)));
+}
+
+uint32_t LdHashPoint(const Vector &P)
+{
+  uint32_t hash = 0;
+
+  for (int i = 0; i < 3; i++) {
+    const float x = static_cast<float>(P[i]);
+    uint32_t bits = 0;
+    memcpy(&bits, &x, sizeof(bits));
+    hash = LdHashCombine(hash, bits);
+  }
+  return hash;
+}
+
+uint32_t LdPermute(uint32_t i, uint32_t n, uint32_t p)
+{
+  // Andrew Kensler, Correlated Multi-Jittered Sampling, 2013
+  uint32_t w = n - 1;
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+
+  do {
+    i ^= p;
+    i *= 0xe170893d;
+    i ^= p >> 16;
+    i ^= (i & w) >> 4;
+    i ^= p >> 8;
+    i *= 0x0929eb3f;
+    i ^= p >> 23;
+    i ^= (i & w) >> 1;
+    i *= 1 | p >> 27;
+    i *= 0x6935fa69;
+    i ^= (i & w) >> 11;
+    i *= 0x74dcb303;
+    i ^= (i & w) >> 2;
+    i *= 0x9e501cc3;
+    i ^= (i & w) >> 2;
+    i *= 0xc860a3df;
+    i &= w;
+    i ^= i >> 5;
+  } while (i >= n);
+
+  return (i + p) % n;
+}
+
+double LdRandom01(uint32_t i, uint32_t p)
+{
+  i ^= p;
+  i ^= i >> 17;
+  i ^= i >> 10;
+  i *= 0xb36534e5;
+  i ^= i >> 12;
+  i ^= i >> 21;
+  i *= 0x93fc4795;
+  i ^= 0xdf6e307f;
+  i ^= i >> 17;
+  i *= 1 | p >> 18;
+
+  return i * ONE_OVER_2_32;
+}
+
+double LdVanDerCorput(uint32_t index, uint32_t scramble)
+{
+  // reverse bits
+  index = (index << 16) | (index >> 16);
+  index = ((index & 0x00ff00ff) << 8) | ((index & 0xff00ff00) >> 8);
+  index = ((index & 0x0f0f0f0f) << 4) | ((index & 0xf0f0f0f0) >> 4);
+  index = ((index & 0x33333333) << 2) | ((index & 0xcccccccc) >> 2);
+  index = ((index & 0x55555555) << 1) | ((index & 0xaaaaaaaa) >> 1);
+
+  return (index ^ scramble) * ONE_OVER_2_32;
+}
+
+double LdSobol(uint32_t index, uint32_t scramble)
+{
+  for (uint32_t v = 1U << 31; index != 0; index >>= 1, v ^= v >> 1) {
+    if (index & 1) {
+      scramble ^= v;
+    }
+  }
+
+  return scramble * ONE_OVER_2_32;
+}
+
+Vector2 LdSample02(uint32_t index, uint32_t scramble)
+{
+  return Vector2(
+      LdVanDerCorput(index, scramble),
+      LdSobol(index, LdHash(scramble)));
+}
+
+Vector2 LdMultiJitter(int s, int m, int n, uint32_t p, double jitter)
+{
+  // Andrew Kensler, Correlated Multi-Jittered Sampling, 2013
+  const int sx = LdPermute(s % m, m, p * 0xa511e9b3);
+  const int sy = LdPermute(s / m, n, p * 0x63d83595);
+  const double jx = LdRandom01(s, p * 0xa399d265);
+  const double jy = LdRandom01(s, p * 0x711ad6a5);
+
+  // without jitter, substrata collapse to the center of the stratum
+  const double x = .5 + jitter * ((sy + jx) / n - .5);
+  const double y = .5 + jitter * ((sx + jy) / m - .5);
+
+  return Vector2(
+      (s % m + x) / m,
+      (s / m + y) / n);
+}
+
+double LdStratified(int s, int n, uint32_t p)
+{
+  const int stratum = LdPermute(s, n, p * 0x68bc21eb);
+  return (stratum + LdRandom01(s, p * 0x02e5be93)) / n;
+}
+
+} // namespace xxx
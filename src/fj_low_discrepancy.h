@@ -0,0 +1,39 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#ifndef FJ_LOW_DISCREPANCY_H
+#define FJ_LOW_DISCREPANCY_H
+
+#include "fj_compatibility.h"
+#include "fj_vector.h"
+
+namespace fj {
+
+// hashes to decorrelate sequences per pixel, light and shading point
+FJ_API uint32_t LdHash(uint32_t a);
+FJ_API uint32_t LdHashCombine(uint32_t seed, uint32_t a);
+FJ_API uint32_t LdHashPoint(const Vector &P);
+
+// random permutation of i in [0, n) and random number in [0, 1)
+// both determined by i and the pattern p
+FJ_API uint32_t LdPermute(uint32_t i, uint32_t n, uint32_t p);
+FJ_API double LdRandom01(uint32_t i, uint32_t p);
+
+// van der Corput and the second dimension of Sobol' sequence with
+// random digit scrambling. the first n points of the (0,2) sequence
+// are well stratified for any n and form a (0,2)-net for powers of 2
+FJ_API double LdVanDerCorput(uint32_t index, uint32_t scramble);
+FJ_API double LdSobol(uint32_t index, uint32_t scramble);
+FJ_API Vector2 LdSample02(uint32_t index, uint32_t scramble);
+
+// correlated multi-jittered sample s of m x n samples in [0, 1)^2
+// stratified both on the m x n grid and on the x and y projections.
+// jitter 0 puts samples on the centers of the grid
+FJ_API Vector2 LdMultiJitter(int s, int m, int n, uint32_t p, double jitter);
+
+// stratified sample s of n samples in [0, 1) in a random order
+FJ_API double LdStratified(int s, int n, uint32_t p);
+
+} // namespace xxx
+
+#endif // FJ_XXX_H
@@ -6,6 +6,7 @@ See LICENSE and README
 #include "fj_noise.h"
 #include "fj_vector.h"
 #include <cmath>
+#include <cstring>
 
 #define PERMUTAION \
 151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69, \
@@ -127,4 +128,207 @@ Real PeriodicNoise3d(Real x, Real y, Real z)
   return result;
 }
 
+// batch evaluation
+// every kernel below works on exactly NOISE_BATCH_WIDTH lanes so that
+// the lane loops have a constant trip count and get vectorized.
+static const int W = NOISE_BATCH_WIDTH;
+
+// offsets used by PerlinNoise3d to decorrelate the three components
+static const float noise3d_offset[3][3] = {
+  {  0.f,      0.f,      0.f},
+  {131.977f,  21.1823f, 71.0231f},
+  {237.492f,  11.1312f, 133.129f}
+};
+
+static inline float fade_f(float t)
+{
+  return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+static inline float lerp_f(float t, float a, float b)
+{
+  return a + t * (b - a);
+}
+
+static inline float grad_f(int hash, float x, float y, float z)
+{
+  const int h = hash & 15;
+  const float u = h < 8 ? x : y;
+  const float v = h < 4 ? y : h==12 || h==14 ? x : z;
+
+  return ((h&1) == 0 ? u : -u) + ((h&2) == 0 ? v : -v);
+}
+
+static void periodic_noise_lanes(
+    const float *x, const float *y, const float *z, float *noise)
+{
+  int X[W], Y[W], Z[W];
+  float xx[W], yy[W], zz[W];
+  int h[8][W];
+  int i;
+
+  // Find unit cube and relative position in it.
+  for (i = 0; i < W; i++) {
+    const float fx = std::floor(x[i]);
+    const float fy = std::floor(y[i]);
+    const float fz = std::floor(z[i]);
+    X[i] = (int) fx & 255;
+    Y[i] = (int) fy & 255;
+    Z[i] = (int) fz & 255;
+    xx[i] = x[i] - fx;
+    yy[i] = y[i] - fy;
+    zz[i] = z[i] - fz;
+  }
+
+  // Hash coordinates of the 8 cube corners. These are table lookups
+  // so they stay in a separate loop from the arithmetic.
+  for (i = 0; i < W; i++) {
+    const int A =  perm[X[i]] + Y[i];
+    const int AA = perm[A] + Z[i];
+    const int AB = perm[A + 1] + Z[i];
+    const int B =  perm[X[i] + 1] + Y[i];
+    const int BA = perm[B] + Z[i];
+    const int BB = perm[B + 1] + Z[i];
+    h[0][i] = perm[AA];
+    h[1][i] = perm[BA];
+    h[2][i] = perm[AB];
+    h[3][i] = perm[BB];
+    h[4][i] = perm[AA + 1];
+    h[5][i] = perm[BA + 1];
+    h[6][i] = perm[AB + 1];
+    h[7][i] = perm[BB + 1];
+  }
+
+  // Add blended results from 8 corners of cube.
+  for (i = 0; i < W; i++) {
+    const float u = fade_f(xx[i]);
+    const float v = fade_f(yy[i]);
+    const float w = fade_f(zz[i]);
+    const float x0 = xx[i], x1 = xx[i] - 1;
+    const float y0 = yy[i], y1 = yy[i] - 1;
+    const float z0 = zz[i], z1 = zz[i] - 1;
+
+    noise[i] =
+      lerp_f(w,
+        lerp_f(v,
+          lerp_f(u, grad_f(h[0][i], x0, y0, z0),
+                    grad_f(h[1][i], x1, y0, z0)),
+          lerp_f(u, grad_f(h[2][i], x0, y1, z0),
+                    grad_f(h[3][i], x1, y1, z0))),
+        lerp_f(v,
+          lerp_f(u, grad_f(h[4][i], x0, y0, z1),
+                    grad_f(h[5][i], x1, y0, z1)),
+          lerp_f(u, grad_f(h[6][i], x0, y1, z1),
+                    grad_f(h[7][i], x1, y1, z1))));
+  }
+}
+
+static void perlin_noise_lanes(
+    const float *x, const float *y, const float *z, const float *offset,
+    float lacunarity, float persistence, int octaves, float *noise)
+{
+  float px[W], py[W], pz[W];
+  float n[W];
+  float amp = 1;
+  int i, oct;
+
+  for (i = 0; i < W; i++) {
+    px[i] = x[i] + offset[0];
+    py[i] = y[i] + offset[1];
+    pz[i] = z[i] + offset[2];
+    noise[i] = 0;
+  }
+
+  for (oct = 0; oct < octaves; oct++) {
+    periodic_noise_lanes(px, py, pz, n);
+
+    for (i = 0; i < W; i++) {
+      noise[i] += amp * n[i];
+      px[i] *= lacunarity;
+      py[i] *= lacunarity;
+      pz[i] *= lacunarity;
+    }
+    amp *= persistence;
+  }
+}
+
+// copies a partial block into zero padded lanes
+static inline const float *load_lanes(const float *src, int n, float *dst)
+{
+  if (n == W)
+    return src;
+
+  memset(dst, 0, sizeof(float) * W);
+  memcpy(dst, src, sizeof(float) * n);
+  return dst;
+}
+
+static inline void store_lanes(const float *src, int n, float *dst)
+{
+  memcpy(dst, src, sizeof(float) * n);
+}
+
+void PeriodicNoise3dBatch(
+    const float *x, const float *y, const float *z,
+    float *noise, int count)
+{
+  float tx[W], ty[W], tz[W];
+  float out[W];
+
+  for (int i = 0; i < count; i += W) {
+    const int n = count - i < W ? count - i : W;
+
+    periodic_noise_lanes(
+        load_lanes(x + i, n, tx),
+        load_lanes(y + i, n, ty),
+        load_lanes(z + i, n, tz),
+        out);
+    store_lanes(out, n, noise + i);
+  }
+}
+
+void PerlinNoiseBatch(
+    const float *x, const float *y, const float *z,
+    float lacunarity, float persistence, int octaves,
+    float *noise, int count)
+{
+  float tx[W], ty[W], tz[W];
+  float out[W];
+
+  for (int i = 0; i < count; i += W) {
+    const int n = count - i < W ? count - i : W;
+
+    perlin_noise_lanes(
+        load_lanes(x + i, n, tx),
+        load_lanes(y + i, n, ty),
+        load_lanes(z + i, n, tz),
+        noise3d_offset[0],
+        lacunarity, persistence, octaves, out);
+    store_lanes(out, n, noise + i);
+  }
+}
+
+void PerlinNoise3dBatch(
+    const float *x, const float *y, const float *z,
+    float lacunarity, float persistence, int octaves,
+    float *noise_x, float *noise_y, float *noise_z, int count)
+{
+  float tx[W], ty[W], tz[W];
+  float out[W];
+  float *dst[3] = {noise_x, noise_y, noise_z};
+
+  for (int i = 0; i < count; i += W) {
+    const int n = count - i < W ? count - i : W;
+    const float *px = load_lanes(x + i, n, tx);
+    const float *py = load_lanes(y + i, n, ty);
+    const float *pz = load_lanes(z + i, n, tz);
+
+    for (int axis = 0; axis < 3; axis++) {
+      perlin_noise_lanes(px, py, pz, noise3d_offset[axis],
+          lacunarity, persistence, octaves, out);
+      store_lanes(out, n, dst[axis] + i);
+    }
+  }
+}
+
 } // namespace xxx
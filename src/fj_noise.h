@@ -19,6 +19,25 @@ FJ_API Vector PerlinNoise3d(const Vector &position,
 
 FJ_API Real PeriodicNoise3d(Real x, Real y, Real z);
 
+// Batch versions evaluate noise for arrays of points in SoA layout.
+// Points are processed NOISE_BATCH_WIDTH at a time in single precision
+// so that the compiler can vectorize the inner lane loops.
+enum { NOISE_BATCH_WIDTH = 8 };
+
+FJ_API void PeriodicNoise3dBatch(
+    const float *x, const float *y, const float *z,
+    float *noise, int count);
+
+FJ_API void PerlinNoiseBatch(
+    const float *x, const float *y, const float *z,
+    float lacunarity, float persistence, int octaves,
+    float *noise, int count);
+
+FJ_API void PerlinNoise3dBatch(
+    const float *x, const float *y, const float *z,
+    float lacunarity, float persistence, int octaves,
+    float *noise_x, float *noise_y, float *noise_z, int count);
+
 } // namespace xxx
 
 #endif // FJ_XXX_H
@@ -4,35 +4,31 @@ See LICENSE and README
 */
 
 #include "fj_object_group.h"
-#include "fj_volume_accelerator.h"
+#include "fj_volume_bvh_accelerator.h"
 #include "fj_bvh_accelerator.h"
 #include "fj_object_instance.h"
 #include "fj_accelerator.h"
-#include "fj_interval.h"
-#include "fj_ray.h"
 
 #include <cassert>
 
 namespace fj {
 
-static void volume_bounds(const void *prim_set, int prim_id, Box *bounds);
-static int volume_ray_intersect(const void *prim_set, int prim_id, double time,
-    const Ray *ray, Interval *interval);
-
 ObjectGroup::ObjectGroup() :
     surface_set(),
     volume_set(),
     surface_acc(NULL),
-    volume_acc(NULL)
+    volume_acc(NULL),
+    has_transparent_shadow(false)
 {
   surface_acc = new BVHAccelerator();
-  volume_acc = VolumeAccNew(VOLACC_BVH);
+  volume_acc = new VolumeBVHAccelerator();
+  volume_acc->SetObjectSet(&volume_set);
 }
 
 ObjectGroup::~ObjectGroup()
 {
   delete surface_acc;
-  VolumeAccFree(volume_acc);
+  delete volume_acc;
 }
 
 void ObjectGroup::AddObject(const ObjectInstance *obj)
@@ -43,13 +39,6 @@ void ObjectGroup::AddObject(const ObjectInstance *obj)
   }
   else if (obj->IsVolume()) {
     volume_set.AddObject(obj);
-
-    VolumeAccSetTargetGeometry(volume_acc,
-        &volume_set,
-        volume_set.GetObjectCount(),
-        &volume_set.GetBounds(),
-        volume_ray_intersect,
-        volume_bounds);
   }
 }
 
@@ -63,12 +52,28 @@ const VolumeAccelerator *ObjectGroup::GetVolumeAccelerator() const
   return volume_acc;
 }
 
+bool ObjectGroup::HasTransparentShadow() const
+{
+  return has_transparent_shadow;
+}
+
 void ObjectGroup::ComputeBounds()
 {
   surface_set.ComputeBounds();
   volume_set.ComputeBounds();
 }
 
+void ObjectGroup::UpdateTransparentShadow()
+{
+  has_transparent_shadow = false;
+  for (Index i = 0; i < surface_set.GetObjectCount(); i++) {
+    if (surface_set.GetObject(i)->HasTransparentShadow()) {
+      has_transparent_shadow = true;
+      break;
+    }
+  }
+}
+
 ObjectGroup *ObjGroupNew(void)
 {
   return new ObjectGroup();
@@ -79,19 +84,4 @@ void ObjGroupFree(ObjectGroup *grp)
   delete grp;
 }
 
-static void volume_bounds(const void *prim_set, int prim_id, Box *bounds)
-{
-  const ObjectSet *objset = (const ObjectSet *) prim_set;
-  const ObjectInstance *obj = objset->GetObject(prim_id);
-  *bounds = obj->GetBounds();
-}
-
-static int volume_ray_intersect(const void *prim_set, int prim_id, double time,
-    const Ray *ray, Interval *interval)
-{
-  const ObjectSet *objset = (const ObjectSet *) prim_set;
-  const ObjectInstance *obj = objset->GetObject(prim_id);
-  return obj->RayVolumeIntersect(*ray, time, interval);
-}
-
 } // namespace xxx
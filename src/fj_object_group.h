@@ -20,8 +20,12 @@ public:
   void AddObject(const ObjectInstance *obj);
   const Accelerator *GetSurfaceAccelerator() const;
   const VolumeAccelerator *GetVolumeAccelerator() const;
+  // true if any surface object needs shading to cast its shadow
+  bool HasTransparentShadow() const;
 
   void ComputeBounds();
+  // call after shaders or objects change their opacity
+  void UpdateTransparentShadow();
 
 private:
   ObjectSet surface_set;
@@ -29,6 +33,8 @@ private:
 
   Accelerator *surface_acc;
   VolumeAccelerator *volume_acc;
+
+  bool has_transparent_shadow;
 };
 
 extern ObjectGroup *ObjGroupNew(void);
@@ -6,6 +6,8 @@
 #include "fj_accelerator.h"
 #include "fj_object_group.h"
 #include "fj_interval.h"
+#include "fj_light.h"
+#include "fj_shader.h"
 #include "fj_numeric.h"
 #include "fj_vector.h"
 #include "fj_volume.h"
@@ -13,10 +15,13 @@
 #include "fj_ray.h"
 
 #include <cassert>
+#include <cmath>
 
 namespace fj {
 
 ObjectInstance::ObjectInstance() :
+    id_(0),
+
     acc_(NULL),
     volume_(NULL),
     bounds_(),
@@ -26,11 +31,14 @@ ObjectInstance::ObjectInstance() :
     shader_list_(1, NULL),
     target_lights_(NULL),
     n_target_lights_(0),
+    light_sample_count_(0),
+    local_light_sample_count_(0),
 
     reflection_target_(NULL),
     refraction_target_(NULL),
     shadow_target_(NULL),
-    self_target_(NULL)
+    self_target_(NULL),
+    transparent_shadow_(false)
 {
   XfmInitTransformSampleList(&transform_samples_);
   update_bounds();
@@ -40,6 +48,16 @@ ObjectInstance::~ObjectInstance()
 {
 }
 
+void ObjectInstance::SetID(int id)
+{
+  id_ = id;
+}
+
+int ObjectInstance::GetID() const
+{
+  return id_;
+}
+
 int ObjectInstance::SetSurface(const Accelerator *acc)
 {
   if (acc_ != NULL)
@@ -131,6 +149,16 @@ void ObjectInstance::SetLightList(const Light **lights, int count)
 {
   target_lights_ = lights;
   n_target_lights_ = count;
+
+  light_sample_count_ = 0;
+  local_light_sample_count_ = 0;
+  for (int i = 0; i < count; i++) {
+    const int nsamples = lights[i]->GetSampleCount();
+    light_sample_count_ += nsamples;
+    if (!lights[i]->IsInfinite()) {
+      local_light_sample_count_ += nsamples;
+    }
+  }
 }
 
 void ObjectInstance::SetReflectTarget(const ObjectGroup *group)
@@ -154,6 +182,11 @@ void ObjectInstance::SetSelfHitTarget(const ObjectGroup *group)
   self_target_ = group;
 }
 
+void ObjectInstance::SetTransparentShadow(bool transparent)
+{
+  transparent_shadow_ = transparent;
+}
+
 const ObjectGroup *ObjectInstance::GetReflectTarget() const
 {
   return reflection_target_;
@@ -174,6 +207,21 @@ const ObjectGroup *ObjectInstance::GetSelfHitTarget() const
   return self_target_;
 }
 
+bool ObjectInstance::HasTransparentShadow() const
+{
+  if (transparent_shadow_) {
+    return true;
+  }
+
+  for (std::size_t i = 0; i < shader_list_.size(); i++) {
+    const Shader *shader = shader_list_[i];
+    if (shader != NULL && !shader->IsOpaque()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 const Shader *ObjectInstance::GetShader(int shading_group_id) const
 {
   if (shading_group_id < 0 ||
@@ -200,6 +248,16 @@ int ObjectInstance::GetLightCount() const
   return n_target_lights_;
 }
 
+int ObjectInstance::GetLightSampleCount() const
+{
+  return light_sample_count_;
+}
+
+int ObjectInstance::GetLocalLightSampleCount() const
+{
+  return local_light_sample_count_;
+}
+
 const Box &ObjectInstance::GetBounds() const
 {
   return bounds_;
@@ -242,6 +300,75 @@ bool ObjectInstance::RayIntersect(const Ray &ray, Real time, Intersection *isect
   return true;
 }
 
+bool ObjectInstance::RayOccluded(const Ray &ray, Real time) const
+{
+  if (!IsSurface()) {
+    return false;
+  }
+
+  Transform transform_interp;
+  XfmLerpTransformSample(&transform_samples_, time, &transform_interp);
+
+  // transform ray to object space
+  Ray ray_object_space = ray;
+  XfmTransformPointInverse(&transform_interp, &ray_object_space.orig);
+  XfmTransformVectorInverse(&transform_interp, &ray_object_space.dir);
+
+  return acc_->Occluded(ray_object_space, time);
+}
+
+void ObjectInstance::RayIntersectPacket(const Ray *rays, const Real *times,
+    int nrays, Intersection *isects, bool *hits) const
+{
+  if (!IsSurface()) {
+    for (int i = 0; i < nrays; i++) {
+      hits[i] = false;
+    }
+    return;
+  }
+
+  Transform transform_interp[MAX_PACKET_RAYS];
+  int transform_id[MAX_PACKET_RAYS];
+  int ntransforms = 0;
+  Ray rays_object_space[MAX_PACKET_RAYS];
+
+  // transform rays to object space. rays at the same time as the
+  // previous one share its transform
+  for (int i = 0; i < nrays; i++) {
+    if (i == 0 || times[i] != times[i - 1]) {
+      XfmLerpTransformSample(&transform_samples_, times[i],
+          &transform_interp[ntransforms]);
+      ntransforms++;
+    }
+    transform_id[i] = ntransforms - 1;
+
+    const Transform &xfm = transform_interp[transform_id[i]];
+    rays_object_space[i] = rays[i];
+    XfmTransformPointInverse(&xfm, &rays_object_space[i].orig);
+    XfmTransformVectorInverse(&xfm, &rays_object_space[i].dir);
+  }
+
+  acc_->IntersectPacket(rays_object_space, times, nrays, isects, hits);
+
+  // transform intersections back to world space
+  for (int i = 0; i < nrays; i++) {
+    if (!hits[i]) {
+      continue;
+    }
+
+    const Transform &xfm = transform_interp[transform_id[i]];
+    Intersection *isect = &isects[i];
+    XfmTransformPoint(&xfm, &isect->P);
+    XfmTransformVector(&xfm, &isect->N);
+    Normalize(&isect->N);
+
+    XfmTransformVector(&xfm, &isect->dPdu);
+    XfmTransformVector(&xfm, &isect->dPdv);
+
+    isect->object = this;
+  }
+}
+
 bool ObjectInstance::RayVolumeIntersect(const Ray &ray, Real time,
     Interval *interval) const
 {
@@ -286,14 +413,38 @@ bool ObjectInstance::GetVolumeSample(const Vector &point, Real time,
     return false;
   }
 
+  const Vector point_in_objspace = point_to_object_space(point, time);
+  const bool hit = volume_->GetSample(point_in_objspace, sample);
+  return hit;
+}
+
+bool ObjectInstance::GetVolumeShadowSample(const Vector &point, Real time,
+    VolumeSample *sample) const
+{
+  if (!IsVolume()) {
+    return false;
+  }
+
+  const Vector point_in_objspace = point_to_object_space(point, time);
+  const bool hit = volume_->GetShadowSample(point_in_objspace, sample);
+  return hit;
+}
+
+Real ObjectInstance::GetVolumeFilterSize(Real time) const
+{
+  if (!IsVolume()) {
+    return 0;
+  }
+
   Transform transform_interp;
   XfmLerpTransformSample(&transform_samples_, time, &transform_interp);
 
-  Vector point_in_objspace = point;
-  XfmTransformPointInverse(&transform_interp, &point_in_objspace);
+  // filter size is the length of voxel diagonal
+  const Real size = volume_->GetFilterSize() / sqrt(3.);
+  Vector diagonal(size, size, size);
+  XfmTransformVector(&transform_interp, &diagonal);
 
-  const bool hit = volume_->GetSample(point_in_objspace, sample);
-  return hit;
+  return Length(diagonal);
 }
 
 void ObjectInstance::update_bounds()
@@ -355,4 +506,15 @@ void ObjectInstance::merge_sampled_bounds()
   bounds_ = merged_bounds;
 }
 
+Vector ObjectInstance::point_to_object_space(const Vector &point, Real time) const
+{
+  Transform transform_interp;
+  XfmLerpTransformSample(&transform_samples_, time, &transform_interp);
+
+  Vector point_in_objspace = point;
+  XfmTransformPointInverse(&transform_interp, &point_in_objspace);
+
+  return point_in_objspace;
+}
+
 } // namespace xxx
@@ -34,6 +34,10 @@ public:
   bool IsSurface() const;
   bool IsVolume() const;
 
+  // ids are unique in scene and written to object id aov
+  void SetID(int id);
+  int GetID() const;
+
   // transformation
   void SetTranslate(Real tx, Real ty, Real tz, Real time);
   void SetRotate(Real rx, Real ry, Real rz, Real time);
@@ -48,27 +52,45 @@ public:
   void SetRefractTarget(const ObjectGroup *group);
   void SetShadowTarget(const ObjectGroup *group);
   void SetSelfHitTarget(const ObjectGroup *group);
+  // objects with shaders that can output opacity less than 1 cast
+  // partial shadows by shading. this turns it on for the other objects.
+  // opaque ones block shadow rays without shading
+  void SetTransparentShadow(bool transparent);
 
   const ObjectGroup *GetReflectTarget() const;
   const ObjectGroup *GetRefractTarget() const;
   const ObjectGroup *GetShadowTarget() const;
   const ObjectGroup *GetSelfHitTarget() const;
+  bool HasTransparentShadow() const;
 
   const Shader *GetShader(int shading_group_id) const;
   const Light **GetLightList() const;
   int   GetLightCount() const;
+  // sample counts of the light list counted when the list is set.
+  // local ones exclude lights at infinity
+  int   GetLightSampleCount() const;
+  int   GetLocalLightSampleCount() const;
   const Box &GetBounds() const;
   void  ComputeBounds();
 
   // sampling
   bool RayIntersect(const Ray &ray, Real time, Intersection *isect) const;
+  void RayIntersectPacket(const Ray *rays, const Real *times, int nrays,
+      Intersection *isects, bool *hits) const;
+  bool RayOccluded(const Ray &ray, Real time) const;
   bool RayVolumeIntersect(const Ray &ray, Real time, Interval *interval) const;
   bool GetVolumeSample(const Vector &point, Real time, VolumeSample *sample) const;
+  bool GetVolumeShadowSample(const Vector &point, Real time, VolumeSample *sample) const;
+  // length of voxel diagonal in world space
+  Real GetVolumeFilterSize(Real time) const;
 
 private:
   void update_bounds();
+  Vector point_to_object_space(const Vector &point, Real time) const;
   void merge_sampled_bounds();
 
+  int id_;
+
   // geometric properties
   const Accelerator *acc_;
   const Volume *volume_;
@@ -81,10 +103,13 @@ private:
   std::vector<const Shader *> shader_list_;
   const Light **target_lights_;
   int n_target_lights_;
+  int light_sample_count_;
+  int local_light_sample_count_;
   const ObjectGroup *reflection_target_;
   const ObjectGroup *refraction_target_;
   const ObjectGroup *shadow_target_;
   const ObjectGroup *self_target_;
+  bool transparent_shadow_;
 };
 
 } // namespace xxx
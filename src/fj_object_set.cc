@@ -61,6 +61,23 @@ bool ObjectSet::ray_intersect(Index prim_id, const Ray &ray,
   return obj->RayIntersect(ray, time, isect);
 }
 
+void ObjectSet::ray_intersect_packet(Index prim_id, const Ray *rays,
+    const Real *times, int nrays, Intersection *isects, bool *hits) const
+{
+  const ObjectInstance *obj = GetObject(prim_id);
+  obj->RayIntersectPacket(rays, times, nrays, isects, hits);
+}
+
+bool ObjectSet::ray_occluded(Index prim_id, const Ray &ray, Real time) const
+{
+  const ObjectInstance *obj = GetObject(prim_id);
+  // objects with transparent shadows are left to their shaders
+  if (obj->HasTransparentShadow()) {
+    return false;
+  }
+  return obj->RayOccluded(ray, time);
+}
+
 void ObjectSet::get_primitive_bounds(Index prim_id, Box *bounds) const
 {
   const ObjectInstance *obj = GetObject(prim_id);
@@ -32,6 +32,9 @@ public:
 private:
   virtual bool ray_intersect(Index prim_id, const Ray &ray,
       Real time, Intersection *isect) const;
+  virtual void ray_intersect_packet(Index prim_id, const Ray *rays,
+      const Real *times, int nrays, Intersection *isects, bool *hits) const;
+  virtual bool ray_occluded(Index prim_id, const Ray &ray, Real time) const;
   virtual void get_primitive_bounds(Index prim_id, Box *bounds) const;
   virtual void get_bounds(Box *bounds) const;
   virtual Index get_primitive_count() const;
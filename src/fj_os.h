@@ -13,6 +13,13 @@ extern void *OsDlsym(void *handle, const char *symbol);
 extern char *OsDlerror(void *handle);
 extern int OsDlclose(void *handle);
 
+/* returns -1 when the file does not exist */
+extern long OsGetFileModifiedTime(const char *filename);
+
+/* seconds from an arbitrary point with sub-millisecond resolution
+ * for measuring intervals */
+extern double OsGetTime(void);
+
 } // namespace xxx
 
 #endif /* FJ_XXX_H */
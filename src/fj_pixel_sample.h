@@ -6,19 +6,24 @@
 
 #include "fj_vector.h"
 #include "fj_color.h"
+#include "fj_aov.h"
 #include "fj_types.h"
 
 namespace fj {
 
 class Sample {
 public:
-  Sample() : uv(), data(), time(0.) {}
+  Sample() : uv(), data(), aov(NULL), time(0.), weight(1.) {}
   ~Sample() {}
 
 public:
   Vector2 uv;
   Vector4 data;
+  // owned by the sampler. NULL unless the renderer has aov framebuffers
+  AovSample *aov;
   Real time;
+  // multiplied to filter weight when samples are denser than others
+  Real weight;
 };
 
 inline Vector4 ToData(const Color4 &color)
@@ -8,7 +8,7 @@
 #include <string>
 #include <cstddef>
 
-#define PLUGIN_API_VERSION 1
+#define PLUGIN_API_VERSION 2
 
 namespace fj {
 
@@ -25,6 +25,38 @@ bool PrimitiveSet::RayIntersect(Index prim_id, const Ray &ray,
   return true;
 }
 
+void PrimitiveSet::RayIntersectPacket(Index prim_id, const Ray *rays,
+    const Real *times, int nrays, Intersection *isects, bool *hits) const
+{
+  ray_intersect_packet(prim_id, rays, times, nrays, isects, hits);
+
+  for (int i = 0; i < nrays; i++) {
+    if (!hits[i] || !RayInRange(rays[i], isects[i].t_hit)) {
+      isects[i].t_hit = REAL_MAX;
+      hits[i] = false;
+    }
+  }
+}
+
+void PrimitiveSet::ray_intersect_packet(Index prim_id, const Ray *rays,
+    const Real *times, int nrays, Intersection *isects, bool *hits) const
+{
+  for (int i = 0; i < nrays; i++) {
+    hits[i] = ray_intersect(prim_id, rays[i], times[i], &isects[i]);
+  }
+}
+
+bool PrimitiveSet::RayOccluded(Index prim_id, const Ray &ray, Real time) const
+{
+  return ray_occluded(prim_id, ray, time);
+}
+
+bool PrimitiveSet::ray_occluded(Index prim_id, const Ray &ray, Real time) const
+{
+  Intersection isect;
+  return RayIntersect(prim_id, ray, time, &isect);
+}
+
 bool PrimitiveSet::BoxIntersect(Index prim_id, const Box &box) const
 {
   return box_intersect(prim_id, box);
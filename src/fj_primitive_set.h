@@ -20,6 +20,13 @@ public:
   virtual ~PrimitiveSet() {}
 
   bool RayIntersect(Index prim_id, const Ray &ray, Real time, Intersection *isect) const;
+  // intersects rays of a packet with the primitive. hits[i] tells
+  // whether isects[i] is set
+  void RayIntersectPacket(Index prim_id, const Ray *rays, const Real *times,
+      int nrays, Intersection *isects, bool *hits) const;
+  // tells whether the ray hits the primitive in its range. primitives
+  // which never block rays can return false
+  bool RayOccluded(Index prim_id, const Ray &ray, Real time) const;
   bool BoxIntersect(Index prim_id, const Box &box) const;
 
   void GetPrimitiveBounds(Index prim_id, Box *bounds) const;
@@ -29,6 +36,9 @@ public:
 private:
   virtual bool ray_intersect(Index prim_id, const Ray &ray,
       Real time, Intersection *isect) const = 0;
+  virtual void ray_intersect_packet(Index prim_id, const Ray *rays,
+      const Real *times, int nrays, Intersection *isects, bool *hits) const;
+  virtual bool ray_occluded(Index prim_id, const Ray &ray, Real time) const;
   // TODO make this pure virtual
   virtual bool box_intersect(Index prim_id, const Box &box) const
   {
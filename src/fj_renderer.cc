@@ -4,15 +4,20 @@
 #include "fj_renderer.h"
 #include "fj_adaptive_grid_sampler.h"
 #include "fj_fixed_grid_sampler.h"
+#include "fj_variance_sampler.h"
 #include "fj_multi_thread.h"
 #include "fj_pixel_sample.h"
 #include "fj_framebuffer.h"
+#include "fj_intersection.h"
+#include "fj_irradiance_cache.h"
+#include "fj_accelerator.h"
 #include "fj_rectangle.h"
 #include "fj_property.h"
 #include "fj_protocol.h"
 #include "fj_numeric.h"
 #include "fj_sampler.h"
 #include "fj_shading.h"
+#include "fj_random.h"
 #include "fj_camera.h"
 #include "fj_filter.h"
 #include "fj_socket.h"
@@ -36,6 +41,10 @@ namespace fj {
 static bool is_socket_ready = false;
 static int renderer_instance_count = 0;
 
+// pixels with less filter weight than this take the samples in their
+// area instead when the filter has negative lobes. filters peak near 1
+static const float MIN_WEIGHT_SUM = .05f;
+
 static int32_t generate_frame_id()
 {
   const unsigned int seed = static_cast<unsigned int>(clock());
@@ -141,6 +150,34 @@ static Interrupt default_tile_done(void *data, const TileInfo *info)
   return CALLBACK_CONTINUE;
 }
 
+static Interrupt default_pass_start(void *data, const PassInfo *info)
+{
+  FrameProgress *fp = reinterpret_cast<FrameProgress *>(data);
+
+  // restart progress for each pass
+  if (info->pass_id > 0) {
+    fp->current_segment = 0;
+    const int idx = fp->current_segment;
+    fp->progress.Start(fp->iteration_list[idx]);
+  }
+
+  return CALLBACK_CONTINUE;
+}
+
+static Interrupt default_pass_done(void *data, const PassInfo *info)
+{
+  FrameProgress *fp = reinterpret_cast<FrameProgress *>(data);
+  const Elapse elapse = fp->timer.GetElapse();
+
+  printf("# Pass %d Done\n", info->pass_id);
+  printf("#   Samples: %d/pixel (total %d/pixel)\n",
+      info->pass_samples, info->total_samples);
+  printf("#   %dh %dm %ds\n", elapse.hour, elapse.min, elapse.sec);
+  printf("\n");
+
+  return CALLBACK_CONTINUE;
+}
+
 // TODO TEST
 static Interrupt default_frame_start2(void *data, const FrameInfo *info)
 {
@@ -292,14 +329,17 @@ static Interrupt default_tile_done2(void *data, const TileInfo *info)
     return CALLBACK_CONTINUE;
   }
 
-  const int tile_w = info->tile_region.Size()[0];
-  const int tile_h = info->tile_region.Size()[1];
+  // pixels in the filter margin are shared with the neighbor tiles.
+  // they are sent again with the sums of neighbors as they finish
+  const Rectangle &region = info->update_region;
+  const int tile_w = region.Size()[0];
+  const int tile_h = region.Size()[1];
   FrameBuffer tile_fb;
   tile_fb.Resize(tile_w, tile_h, info->framebuffer->GetChannelCount());
 
   {
-    const int xoffset = info->tile_region.min[0];
-    const int yoffset = info->tile_region.min[1];
+    const int xoffset = region.min[0];
+    const int yoffset = region.min[1];
     for (int y = 0; y < tile_h; y++) {
       for (int x = 0; x < tile_w; x++) {
         const int xx = x + xoffset;
@@ -329,10 +369,10 @@ static Interrupt default_tile_done2(void *data, const TileInfo *info)
     err = SendRenderTileDone(socket,
         info->frame_id,
         info->region_id,
-        info->tile_region.min[0],
-        info->tile_region.min[1],
-        info->tile_region.max[0],
-        info->tile_region.max[1],
+        region.min[0],
+        region.min[1],
+        region.max[0],
+        region.max[1],
         tile_fb);
     if (err == -1) {
       // TODO ERROR HANDLING
@@ -361,21 +401,32 @@ Renderer::Renderer()
 {
   camera_ = NULL;
   framebuffer_ = NULL;
+  for (int i = 0; i < AOV_COUNT; i++) {
+    aov_framebuffers_[i] = NULL;
+  }
   target_objects_ = NULL;
   target_lights_ = NULL;
   nlights_ = 0;
 
   SetResolution(320, 240);
   SetTileSize(64, 64);
+  SetTileOrder(TILE_SCANLINE);
   SetFilterWidth(2, 2);
+  SetFilterType(FLT_GAUSSIAN);
 
   SetSamplerType(RENDERER_FIXED_GRID_SAMPLER);
   SetPixelSamples(3, 3);
   SetMaxSubdivision(1);
   SetSubdivisionThreshold(.05);
+  SetMaxPixelSamples(64);
+  SetVarianceThreshold(.02);
   SetSampleJitter(1);
   SetSampleTimeRange(0, 1);
 
+  SetProgressive(0);
+  SetProgressiveTimeBudget(0);
+  SetPreview(0);
+
   SetShadowEnable(1);
   SetMaxReflectDepth(3);
   SetMaxRefractDepth(3);
@@ -384,6 +435,9 @@ Renderer::Renderer()
   SetRaymarchShadowStep(.1);
   SetRaymarchReflectStep(.1);
   SetRaymarchRefractStep(.1);
+  SetRaymarchAdaptive(0);
+  SetLightSampleBudget(0);
+  SetRussianRouletteThreshold(0);
 
   SetUseMaxThread(0);
   SetThreadCount(1);
@@ -413,6 +467,10 @@ Renderer::Renderer()
         default_tile_done2);
   }
 
+  SetPassReportCallback(&frame_progress_,
+      default_pass_start,
+      default_pass_done);
+
   if (renderer_instance_count == 0) {
     const int err = SocketStartup();
     if (err) {
@@ -472,6 +530,21 @@ void Renderer::SetTileSize(int xtilesize, int ytilesize)
   tilesize_[1] = ytilesize;
 }
 
+void Renderer::SetTileOrder(int tile_order)
+{
+  switch (tile_order) {
+  case TILE_SCANLINE:
+  case TILE_SPIRAL:
+  case TILE_HILBERT:
+  case TILE_CENTER_OUT:
+    tile_order_ = tile_order;
+    break;
+  default:
+    tile_order_ = TILE_SCANLINE;
+    break;
+  }
+}
+
 void Renderer::SetFilterWidth(float xfwidth, float yfwidth)
 {
   assert(xfwidth > 0);
@@ -480,11 +553,27 @@ void Renderer::SetFilterWidth(float xfwidth, float yfwidth)
   filterwidth_[1] = yfwidth;
 }
 
+void Renderer::SetFilterType(int filtertype)
+{
+  switch (filtertype) {
+  case FLT_BOX:
+  case FLT_GAUSSIAN:
+  case FLT_MITCHELL:
+  case FLT_BLACKMAN_HARRIS:
+    filtertype_ = filtertype;
+    break;
+  default:
+    filtertype_ = FLT_GAUSSIAN;
+    break;
+  }
+}
+
 void Renderer::SetSamplerType(int sampler_type)
 {
   switch (sampler_type) {
   case RENDERER_FIXED_GRID_SAMPLER:
   case RENDERER_ADAPTIVE_GRID_SAMPLER:
+  case RENDERER_VARIANCE_SAMPLER:
     sampler_type_ = sampler_type;
     break;
   default:
@@ -513,6 +602,18 @@ void Renderer::SetSubdivisionThreshold(float subd_threshold)
   subd_threshold_ = subd_threshold;
 }
 
+void Renderer::SetMaxPixelSamples(int max_samples)
+{
+  assert(max_samples > 0);
+  max_samples_ = max_samples;
+}
+
+void Renderer::SetVarianceThreshold(float variance_threshold)
+{
+  assert(variance_threshold >= 0);
+  variance_threshold_ = variance_threshold;
+}
+
 void Renderer::SetSampleJitter(float jitter)
 {
   assert(jitter >= 0 && jitter <= 1);
@@ -527,6 +628,22 @@ void Renderer::SetSampleTimeRange(double start_time, double end_time)
   sample_time_end_ = end_time;
 }
 
+void Renderer::SetProgressive(int progressive)
+{
+  progressive_ = (progressive != 0);
+}
+
+void Renderer::SetPreview(int preview)
+{
+  preview_ = (preview != 0);
+}
+
+void Renderer::SetProgressiveTimeBudget(double seconds)
+{
+  assert(seconds >= 0);
+  time_budget_ = seconds;
+}
+
 void Renderer::SetShadowEnable(int enable)
 {
   assert(enable == 0 || enable == 1);
@@ -569,6 +686,24 @@ void Renderer::SetRaymarchRefractStep(double step)
   raymarch_refract_step_ = Max(step, .001);
 }
 
+void Renderer::SetRaymarchAdaptive(int adaptive)
+{
+  assert(adaptive == 0 || adaptive == 1);
+  raymarch_adaptive_ = adaptive;
+}
+
+void Renderer::SetLightSampleBudget(int budget)
+{
+  assert(budget >= 0);
+  light_sample_budget_ = budget;
+}
+
+void Renderer::SetRussianRouletteThreshold(double threshold)
+{
+  assert(threshold >= 0);
+  russian_roulette_threshold_ = threshold;
+}
+
 void Renderer::SetCamera(Camera *cam)
 {
   assert(cam != NULL);
@@ -581,6 +716,12 @@ void Renderer::SetFrameBuffers(FrameBuffer *fb)
   framebuffer_ = fb;
 }
 
+void Renderer::SetAovFrameBuffer(int aov, FrameBuffer *fb)
+{
+  assert(aov >= 0 && aov < AOV_COUNT);
+  aov_framebuffers_[aov] = fb;
+}
+
 void Renderer::SetTargetObjects(ObjectGroup *grp)
 {
   assert(grp != NULL);
@@ -648,6 +789,16 @@ void Renderer::SetTileReportCallback(void *data,
       tile_done);
 }
 
+void Renderer::SetPassReportCallback(void *data,
+    PassStartCallback pass_start,
+    PassDoneCallback pass_done)
+{
+  CbSetPassReport(&pass_report_,
+      data,
+      pass_start,
+      pass_done);
+}
+
 int Renderer::RenderScene()
 {
   int err = 0;
@@ -667,10 +818,43 @@ int Renderer::RenderScene()
   return 0;
 }
 
+// fields of a camera ray hit that preview shading reads. hit points
+// are recomputed from the pixel center ray and the hit distance
+class GBufferPixel {
+public:
+  GBufferPixel() :
+      object(NULL),
+      shading_group_id(0),
+      t_hit(REAL_MAX) {}
+  ~GBufferPixel() {}
+
+  Vector N;
+  Color Cd;
+  TexCoord uv;
+
+  Vector dPdu;
+  Vector dPdv;
+
+  const ObjectInstance *object;
+  int shading_group_id;
+
+  Real t_hit;
+};
+
 // TODO TMP REMOVE LATER
 class Worker {
 public:
-  Worker() : camera(NULL), framebuffer(NULL), sampler(NULL) {}
+  Worker() :
+    camera(NULL),
+    framebuffer(NULL),
+    aov_framebuffers(NULL),
+    has_aovs(false),
+    nchannels(5),
+    box_channel(-1),
+    aov_channel(-1),
+    accumulation(NULL),
+    gbuffer(NULL),
+    sampler(NULL) {}
   ~Worker()
   {
     delete sampler;
@@ -685,13 +869,37 @@ public:
 
   const Camera *camera;
   FrameBuffer *framebuffer;
+  FrameBuffer *const *aov_framebuffers;
+  // channels of splat and accumulation. rgba and weight, then the
+  // same sums over the pixel area for filters with negative lobes and
+  // aovs with the distance to their nearest sample if any. offsets of
+  // the optional ones are -1 when not used
+  bool has_aovs;
+  int nchannels;
+  int box_channel;
+  int aov_channel;
+  FrameBuffer *accumulation;
+  // hits of camera rays in the frame region for preview
+  std::vector<GBufferPixel> *gbuffer;
   Sampler *sampler;
   Filter filter;
-  std::vector<Sample> pixel_samples;
+  Vector2 filter_radius;
+  std::vector<float> xweights;
+  std::vector<float> yweights;
+  Rectangle render_region;
+
+  // weighted sums of the tile and its filter margin
+  std::vector<const Sample *> owned_samples;
+  FrameBuffer splat_buffer;
+  Rectangle splat_region;
 
   TraceContext context;
   Rectangle tile_region;
 
+  // records live for a tile. a worker is run by one thread at a time
+  IrradianceCache irradiance_cache;
+  LightSampleStack light_sample_stack;
+
   TileReport tile_report;
 
   const Tiler *tiler;
@@ -700,7 +908,10 @@ public:
 static void init_worker(Worker *worker, int id,
     const Renderer *renderer, const Tiler *tiler);
 static int render_frame_start(Renderer *renderer, const Tiler *tiler);
+static Int2 pass_pixel_samples(const Int2 &target_rate, int pass_id);
 static ThreadStatus render_tile(void *data, const ThreadContext *context);
+static ThreadStatus intersect_preview_tile(void *data, const ThreadContext *context);
+static ThreadStatus shade_preview_tile(void *data, const ThreadContext *context);
 static void render_frame_done(Renderer *renderer, const Tiler *tiler);
 
 int Renderer::prepare_rendering()
@@ -743,7 +954,9 @@ int Renderer::execute_rendering()
   // Tiler
   Tiler tiler;
   tiler.Divide(xres, yres, xtilesize, ytilesize);
+  tiler.SetTileOrder(tile_order_);
   tiler.GenerateTiles(frame_region_);
+  tiler.SplitTailTiles(thread_count);
   const int tile_count = tiler.GetTileCount();
 
   // Worker
@@ -752,6 +965,13 @@ int Renderer::execute_rendering()
     init_worker(&worker_list[i], i, this, &tiler);
   }
 
+  // weighted color sums and weight sums shared by all tiles
+  FrameBuffer accumulation;
+  accumulation.Resize(xres, yres, worker_list[0].nchannels);
+  for (std::size_t i = 0; i < worker_list.size(); i++) {
+    worker_list[i].accumulation = &accumulation;
+  }
+
   // FrameProgress
   init_frame_progress(&frame_progress_, tile_count);
 
@@ -761,7 +981,80 @@ int Renderer::execute_rendering()
     return -1;
   }
 
-  MtRunThreadLoop(&worker_list[0], render_tile, thread_count, 0, tile_count);
+  if (preview_) {
+    const Int2 size = frame_region_.Size();
+    std::vector<GBufferPixel> gbuffer(size[0] * size[1]);
+
+    for (std::size_t i = 0; i < worker_list.size(); i++) {
+      TraceContext &cxt = worker_list[i].context;
+      cxt.cast_shadow = 0;
+      cxt.max_reflect_depth = 0;
+      cxt.max_refract_depth = 0;
+      worker_list[i].gbuffer = &gbuffer;
+    }
+
+    const ThreadStatus status = MtRunThreadLoop(&worker_list[0],
+        intersect_preview_tile, thread_count, 0, tile_count);
+    if (status != THREAD_LOOP_CANCEL) {
+      MtRunThreadLoop(&worker_list[0],
+          shade_preview_tile, thread_count, 0, tile_count);
+    }
+
+    render_frame_done(this, &tiler);
+    return 0;
+  }
+
+  // Passes accumulate into the same weighted sums
+  const Int2 target_rate(pixelsamples_[0], pixelsamples_[1]);
+  Timer timer;
+  timer.Start();
+  int total_samples = 0;
+
+  for (int pass_id = 0; ; pass_id++) {
+    const Int2 rate = progressive_ ?
+        pass_pixel_samples(target_rate, pass_id) : target_rate;
+
+    for (std::size_t i = 0; i < worker_list.size(); i++) {
+      worker_list[i].sampler->SetPixelSamples(rate);
+      worker_list[i].sampler->SetSeed(pass_id);
+    }
+
+    PassInfo info;
+    info.frame_id = frame_id_;
+    info.pass_id = pass_id;
+    info.pass_samples = rate[0] * rate[1];
+    info.total_samples = total_samples + info.pass_samples;
+    info.framebuffer = framebuffer_;
+
+    if (progressive_) {
+      const Interrupt interrupt = CbReportPassStart(&pass_report_, &info);
+      if (interrupt == CALLBACK_INTERRUPT) {
+        break;
+      }
+    }
+
+    const ThreadStatus status = MtRunThreadLoop(&worker_list[0], render_tile,
+        thread_count, 0, tile_count);
+    total_samples = info.total_samples;
+
+    if (!progressive_ || status == THREAD_LOOP_CANCEL) {
+      break;
+    }
+
+    const Interrupt interrupt = CbReportPassDone(&pass_report_, &info);
+    if (interrupt == CALLBACK_INTERRUPT) {
+      break;
+    }
+
+    // budget is checked between passes so that every pass covers the frame
+    if (time_budget_ > 0) {
+      if (timer.GetElapsedSeconds() >= time_budget_) {
+        break;
+      }
+    } else if (rate[0] == target_rate[0] && rate[1] == target_rate[1]) {
+      break;
+    }
+  }
 
   render_frame_done(this, &tiler);
 
@@ -787,7 +1080,26 @@ int Renderer::preprocess_framebuffer() const
 
   const int xres = resolution_[0];
   const int yres = resolution_[1];
-  framebuffer_->Resize(xres, yres, 4);
+
+  // keeps pixels outside of the frame region when rendering the next crop
+  if (framebuffer_->GetWidth() != xres ||
+      framebuffer_->GetHeight() != yres ||
+      framebuffer_->GetChannelCount() != 4) {
+    framebuffer_->Resize(xres, yres, 4);
+  }
+
+  for (int i = 0; i < AOV_COUNT; i++) {
+    FrameBuffer *fb = aov_framebuffers_[i];
+    const int nchannels = AovGetChannelCount(i);
+    if (fb == NULL) {
+      continue;
+    }
+    if (fb->GetWidth() != xres ||
+        fb->GetHeight() != yres ||
+        fb->GetChannelCount() != nchannels) {
+      fb->Resize(xres, yres, nchannels);
+    }
+  }
 
   return 0;
 }
@@ -819,6 +1131,15 @@ int Renderer::preprocess_lights()
   return 0;
 }
 
+static Int2 pass_pixel_samples(const Int2 &target_rate, int pass_id)
+{
+  // doubles per axis to 1, 4, 16 ... samples per pixel
+  const int rate = 1 << (pass_id < 15 ? pass_id : 15);
+  return Int2(
+      rate < target_rate[0] ? rate : target_rate[0],
+      rate < target_rate[1] ? rate : target_rate[1]);
+}
+
 static void init_worker(Worker *worker, int id,
     const Renderer *renderer, const Tiler *tiler)
 {
@@ -834,6 +1155,13 @@ static void init_worker(Worker *worker, int id,
 
   worker->camera = renderer->camera_;
   worker->framebuffer = renderer->framebuffer_;
+  worker->aov_framebuffers = renderer->aov_framebuffers_;
+  worker->has_aovs = false;
+  for (int i = 0; i < AOV_COUNT; i++) {
+    if (renderer->aov_framebuffers_[i] != NULL) {
+      worker->has_aovs = true;
+    }
+  }
   worker->tiler = tiler;
   worker->id = id;
 
@@ -852,6 +1180,9 @@ static void init_worker(Worker *worker, int id,
   case RENDERER_ADAPTIVE_GRID_SAMPLER:
     worker->sampler = new AdaptiveGridSampler();
     break;
+  case RENDERER_VARIANCE_SAMPLER:
+    worker->sampler = new VarianceSampler();
+    break;
   default:
     worker->sampler = new FixedGridSampler();
     break;
@@ -868,13 +1199,33 @@ static void init_worker(Worker *worker, int id,
   worker->sampler->SetFilterWidth(Vector2(xfwidth, yfwidth));
   worker->sampler->SetMaxSubdivision(max_subd);
   worker->sampler->SetSubdivisionThreshold(subd_threshold);
+  worker->sampler->SetMaxPixelSamples(renderer->max_samples_);
+  worker->sampler->SetVarianceThreshold(renderer->variance_threshold_);
 
+  worker->sampler->SetRenderRegion(renderer->frame_region_);
   worker->sampler->SetJitter(renderer->jitter_);
+  worker->sampler->SetAovStored(worker->has_aovs);
   worker->sampler->SetSampleTimeRange(
       renderer->sample_time_start_, renderer->sample_time_end_);
 
   // Filter
-  worker->filter.SetFilterType(FLT_GAUSSIAN, xfwidth, yfwidth);
+  worker->filter.SetFilterType(renderer->filtertype_, xfwidth, yfwidth);
+  worker->filter_radius = Vector2(
+      worker->filter.GetXRadius(),
+      worker->filter.GetYRadius());
+
+  worker->nchannels = 5;
+  worker->box_channel = -1;
+  worker->aov_channel = -1;
+  if (worker->filter.HasNegativeLobes()) {
+    worker->box_channel = worker->nchannels;
+    worker->nchannels += 5;
+  }
+  if (worker->has_aovs) {
+    worker->aov_channel = worker->nchannels;
+    worker->nchannels += AOV_CHANNEL_COUNT + 1;
+  }
+  worker->render_region = renderer->frame_region_;
 
   /* context */
   worker->context = SlCameraContext(renderer->target_objects_);
@@ -885,6 +1236,13 @@ static void init_worker(Worker *worker, int id,
   worker->context.raymarch_shadow_step = renderer->raymarch_shadow_step_;
   worker->context.raymarch_reflect_step = renderer->raymarch_reflect_step_;
   worker->context.raymarch_refract_step = renderer->raymarch_refract_step_;
+  worker->context.raymarch_adaptive = renderer->raymarch_adaptive_;
+  worker->context.light_sample_budget = renderer->light_sample_budget_;
+  worker->context.russian_roulette_threshold =
+      renderer->russian_roulette_threshold_;
+  worker->context.irradiance_cache = &worker->irradiance_cache;
+  worker->context.light_sample_stack = &worker->light_sample_stack;
+  worker->context.pixel_spread = renderer->camera_->GetPixelSpread(yres);
 
   /* region */
   worker->tile_region.min[0] = 0;
@@ -906,70 +1264,259 @@ static void set_working_region(Worker *worker, int region_id)
   worker->tile_region.min[1] = tile->ymin;
   worker->tile_region.max[0] = tile->xmax;
   worker->tile_region.max[1] = tile->ymax;
+  worker->splat_region = worker->tile_region;
 
-  if (worker->sampler->GenerateSamples(worker->tile_region)) {
-    /* TODO error handling */
+  // records reused only within a tile make images independent of
+  // which threads rendered the tiles before
+  worker->irradiance_cache.Clear();
+}
+
+// aov sums in splat and accumulation are followed by the squared
+// distance from the pixel center to the nearest sample plus one, so
+// that 0 means no sample has reached the pixel yet
+static bool is_nearer(float dist, float nearest)
+{
+  return nearest == 0 || dist < nearest;
+}
+
+static void splat_aovs(float *aov_sum, const AovSample &aov,
+    float wgt, float dist2)
+{
+  float *nearest = aov_sum + AOV_CHANNEL_COUNT;
+  const bool nearer = is_nearer(1 + dist2, *nearest);
+
+  for (int i = 0; i < AOV_COUNT; i++) {
+    const int offset = AovGetChannelOffset(i);
+    const int end = offset + AovGetChannelCount(i);
+
+    if (AovGetFilterType(i) == AOV_FILTER_NEAREST) {
+      if (nearer) {
+        for (int j = offset; j < end; j++) {
+          aov_sum[j] = aov.channels[j];
+        }
+      }
+    } else {
+      for (int j = offset; j < end; j++) {
+        aov_sum[j] += wgt * aov.channels[j];
+      }
+    }
+  }
+
+  if (nearer) {
+    *nearest = 1 + dist2;
+  }
+}
+
+static void merge_aov_sums(float *aov_sum, const float *src)
+{
+  float *nearest = aov_sum + AOV_CHANNEL_COUNT;
+  const float src_nearest = src[AOV_CHANNEL_COUNT];
+  const bool nearer = src_nearest > 0 && is_nearer(src_nearest, *nearest);
+
+  for (int i = 0; i < AOV_COUNT; i++) {
+    const int offset = AovGetChannelOffset(i);
+    const int end = offset + AovGetChannelCount(i);
+
+    if (AovGetFilterType(i) == AOV_FILTER_NEAREST) {
+      if (nearer) {
+        for (int j = offset; j < end; j++) {
+          aov_sum[j] = src[j];
+        }
+      }
+    } else {
+      for (int j = offset; j < end; j++) {
+        aov_sum[j] += src[j];
+      }
+    }
+  }
+
+  if (nearer) {
+    *nearest = src_nearest;
   }
 }
 
-static Color4 apply_pixel_filter(Worker *worker, int x, int y)
+static void splat_samples(Worker *worker)
 {
-  const int nsamples = worker->pixel_samples.size();
   const int xres = worker->xres;
   const int yres = worker->yres;
   const Filter &filter = worker->filter;
+  const Vector2 &radius = worker->filter_radius;
+  const Rectangle &tile = worker->tile_region;
+
+  // pixels reached by samples in the tile and its margin
+  Rectangle &splat = worker->splat_region;
+  splat.min[0] = Max(tile.min[0] - (int) Ceil(radius[0]), worker->render_region.min[0]);
+  splat.min[1] = Max(tile.min[1] - (int) Ceil(radius[1]), worker->render_region.min[1]);
+  splat.max[0] = Min(tile.max[0] + (int) Ceil(radius[0]), worker->render_region.max[0]);
+  splat.max[1] = Min(tile.max[1] + (int) Ceil(radius[1]), worker->render_region.max[1]);
+
+  const Int2 size = splat.Size();
+  const int NCHANNELS = worker->nchannels;
+  FrameBuffer &buffer = worker->splat_buffer;
+  buffer.Resize(size[0], size[1], NCHANNELS);
+
+  std::vector<float> &xweights = worker->xweights;
+  std::vector<float> &yweights = worker->yweights;
+  xweights.resize(2 * (int) Ceil(radius[0]) + 1);
+  yweights.resize(2 * (int) Ceil(radius[1]) + 1);
+
+  worker->sampler->GetOwnedSamples(worker->owned_samples);
+  const std::size_t nsamples = worker->owned_samples.size();
+
+  for (std::size_t i = 0; i < nsamples; i++) {
+    const Sample &sample = *worker->owned_samples[i];
+    const double sx = xres * sample.uv.x;
+    const double sy = yres * (1-sample.uv.y);
+
+    if (worker->box_channel >= 0) {
+      const int x = (int) Floor(sx);
+      const int y = (int) Floor(sy);
+      if (x >= splat.min[0] && x < splat.max[0] &&
+          y >= splat.min[1] && y < splat.max[1]) {
+        float *dst = buffer.GetWritable(x - splat.min[0], y - splat.min[1],
+            worker->box_channel);
+        dst[0] += sample.weight * sample.data[0];
+        dst[1] += sample.weight * sample.data[1];
+        dst[2] += sample.weight * sample.data[2];
+        dst[3] += sample.weight * sample.data[3];
+        dst[4] += sample.weight;
+      }
+    }
 
-  Color4 pixel;
-  float wgt_sum = 0.f;
-  float inv_sum = 0.f;
-  int i;
+    // pixel centers within the filter radius
+    const int xmin = Max((int) Ceil(sx - radius[0] - .5), splat.min[0]);
+    const int ymin = Max((int) Ceil(sy - radius[1] - .5), splat.min[1]);
+    const int xmax = Min((int) Floor(sx + radius[0] - .5), splat.max[0] - 1);
+    const int ymax = Min((int) Floor(sy + radius[1] - .5), splat.max[1] - 1);
+    if (xmin > xmax || ymin > ymax) {
+      continue;
+    }
+
+    // separable weights are looked up once per column and row
+    float *xwgt = &xweights[0];
+    float *ywgt = &yweights[0];
+    for (int x = xmin; x <= xmax; x++) {
+      xwgt[x - xmin] = sample.weight * filter.EvaluateX(sx - (x + .5));
+    }
+    for (int y = ymin; y <= ymax; y++) {
+      ywgt[y - ymin] = filter.EvaluateY(sy - (y + .5));
+    }
+
+    for (int y = ymin; y <= ymax; y++) {
+      float *dst = buffer.GetWritable(xmin - splat.min[0], y - splat.min[1], 0);
 
-  for (i = 0; i < nsamples; i++) {
-    const Sample &sample = worker->pixel_samples[i];
-    double filtx = 0, filty = 0;
-    double wgt = 0;
+      for (int x = xmin; x <= xmax; x++, dst += NCHANNELS) {
+        const float wgt = xwgt[x - xmin] * ywgt[y - ymin];
 
-    filtx = xres * sample.uv.x - (x + .5);
-    filty = yres * (1-sample.uv.y) - (y + .5);
-    wgt = filter.Evaluate(filtx, filty);
+        dst[0] += wgt * sample.data[0];
+        dst[1] += wgt * sample.data[1];
+        dst[2] += wgt * sample.data[2];
+        dst[3] += wgt * sample.data[3];
+        dst[4] += wgt;
 
-    pixel.r += wgt * sample.data[0];
-    pixel.g += wgt * sample.data[1];
-    pixel.b += wgt * sample.data[2];
-    pixel.a += wgt * sample.data[3];
-    wgt_sum += wgt;
+        if (sample.aov != NULL) {
+          const float dx = sx - (x + .5);
+          const float dy = sy - (y + .5);
+          splat_aovs(dst + worker->aov_channel, *sample.aov, wgt,
+              dx * dx + dy * dy);
+        }
+      }
+    }
   }
+}
+
+static void accumulate_aovs(Worker *worker, int x, int y,
+    const float *aov_sum, float inv_sum)
+{
+  for (int i = 0; i < AOV_COUNT; i++) {
+    FrameBuffer *fb = worker->aov_framebuffers[i];
+    if (fb == NULL) {
+      continue;
+    }
+
+    const int filter_type = AovGetFilterType(i);
+    const float *src = aov_sum + AovGetChannelOffset(i);
+    float *dst = fb->GetWritable(x, y, 0);
 
-  inv_sum = 1.f / wgt_sum;
-  pixel.r *= inv_sum;
-  pixel.g *= inv_sum;
-  pixel.b *= inv_sum;
-  pixel.a *= inv_sum;
+    if (filter_type == AOV_FILTER_NEAREST) {
+      for (int j = 0; j < AovGetChannelCount(i); j++) {
+        dst[j] = src[j];
+      }
+      continue;
+    }
+
+    for (int j = 0; j < AovGetChannelCount(i); j++) {
+      dst[j] = src[j] * inv_sum;
+    }
 
-  return pixel;
+    if (filter_type == AOV_FILTER_UNIT) {
+      const Vector v(dst[0], dst[1], dst[2]);
+      const double len = Length(v);
+      if (len > 0) {
+        dst[0] = v.x / len;
+        dst[1] = v.y / len;
+        dst[2] = v.z / len;
+      }
+    }
+  }
 }
 
-static void reconstruct_image(Worker *worker)
+static void accumulate_splats(void *data)
 {
+  Worker *worker = (Worker *) data;
   FrameBuffer *fb = worker->framebuffer;
-  const int xmin = worker->tile_region.min[0];
-  const int ymin = worker->tile_region.min[1];
-  const int xmax = worker->tile_region.max[0];
-  const int ymax = worker->tile_region.max[1];
-  int x, y;
-
-  for (y = ymin; y < ymax; y++) {
-    for (x = xmin; x < xmax; x++) {
-      Color4 pixel;
+  FrameBuffer *accum = worker->accumulation;
+  const Rectangle &splat = worker->splat_region;
+
+  // pixels shared with neighbor tiles are updated as they finish
+  for (int y = splat.min[1]; y < splat.max[1]; y++) {
+    for (int x = splat.min[0]; x < splat.max[0]; x++) {
+      const float *src = worker->splat_buffer.GetReadOnly(
+          x - splat.min[0], y - splat.min[1], 0);
+      float *sum = accum->GetWritable(x, y, 0);
+
+      const int nsums = worker->has_aovs ? worker->aov_channel : worker->nchannels;
+      for (int i = 0; i < nsums; i++) {
+        sum[i] += src[i];
+      }
+      if (worker->has_aovs) {
+        merge_aov_sums(sum + worker->aov_channel, src + worker->aov_channel);
+      }
 
-      worker->sampler->GetSampleSetInPixel(worker->pixel_samples, x, y);
-      pixel = apply_pixel_filter(worker, x, y);
+      // negative lobes can cancel the weights of sparse samples. the
+      // pixel takes the samples in its area when weights hardly remain
+      const float *color_sum = sum;
+      if (worker->box_channel >= 0 && sum[4] < MIN_WEIGHT_SUM) {
+        const float *box_sum = sum + worker->box_channel;
+        if (box_sum[4] > 0) {
+          color_sum = box_sum;
+        }
+      }
+      if (color_sum[4] <= 0) {
+        continue;
+      }
 
+      const float inv_sum = 1.f / color_sum[4];
+      const Color4 pixel(
+          color_sum[0] * inv_sum,
+          color_sum[1] * inv_sum,
+          color_sum[2] * inv_sum,
+          color_sum[3] * inv_sum);
       fb->SetColor(x, y, pixel);
+
+      if (worker->has_aovs && sum[4] > 0) {
+        accumulate_aovs(worker, x, y, sum + worker->aov_channel, 1.f / sum[4]);
+      }
     }
   }
 }
 
+static void reconstruct_image(Worker *worker)
+{
+  splat_samples(worker);
+  MtCriticalSection(worker, accumulate_splats);
+}
+
 static int render_frame_start(Renderer *renderer, const Tiler *tiler)
 {
   FrameInfo info;
@@ -1011,6 +1558,7 @@ static int render_tile_start(Worker *worker)
   info.region_id = worker->region_id;
   info.total_region_count = worker->region_count;
   info.tile_region = worker->tile_region;
+  info.update_region = worker->splat_region;
   info.framebuffer = worker->framebuffer;
 
   const Interrupt interrupt = CbReportTileStart(&worker->tile_report, &info);
@@ -1029,6 +1577,7 @@ static void render_tile_done(Worker *worker)
   info.region_id = worker->region_id;
   info.total_region_count = worker->region_count;
   info.tile_region = worker->tile_region;
+  info.update_region = worker->splat_region;
   info.framebuffer = worker->framebuffer;
 
   CbReportTileDone(&worker->tile_report, &info);
@@ -1036,36 +1585,51 @@ static void render_tile_done(Worker *worker)
 
 static int integrate_samples(Worker *worker)
 {
-  Sample *smp = NULL;
-  TraceContext cxt = worker->context;
-  Ray ray;
-
-  while ((smp = worker->sampler->GetNextSample()) != NULL) {
-    Color4 C_trace;
-    double t_hit = FLT_MAX;
-    int hit = 0;
-    int interrupted = 0;
-
-    worker->camera->GetRay(smp->uv, smp->time, &ray);
-    cxt.time = smp->time;
-
-    hit = SlTrace(&cxt, &ray.orig, &ray.dir, ray.tmin, ray.tmax, &C_trace, &t_hit);
-    if (hit) {
-      smp->data[0] = C_trace.r;
-      smp->data[1] = C_trace.g;
-      smp->data[2] = C_trace.b;
-      smp->data[3] = C_trace.a;
-    } else {
-      smp->data[0] = 0;
-      smp->data[1] = 0;
-      smp->data[2] = 0;
-      smp->data[3] = 0;
+  Sample *packet[MAX_PACKET_RAYS];
+  Ray rays[MAX_PACKET_RAYS];
+  double times[MAX_PACKET_RAYS];
+  Color4 C_trace[MAX_PACKET_RAYS];
+  int hits[MAX_PACKET_RAYS];
+  AovSample aovs[MAX_PACKET_RAYS];
+  AovSample *out_aovs = worker->has_aovs ? aovs : NULL;
+  const TraceContext cxt = worker->context;
+  int nsamples = 0;
+
+  // camera rays are traced in packets as long as the sampler gives
+  // samples independent of each other. secondary rays are traced one
+  // by one from shaders
+  while ((nsamples = worker->sampler->GetNextSamples(packet, MAX_PACKET_RAYS)) > 0) {
+    for (int i = 0; i < nsamples; i++) {
+      worker->camera->GetRay(packet[i]->uv, packet[i]->time, &rays[i]);
+      times[i] = packet[i]->time;
     }
 
-    interrupted = CbReportSampleDone(&worker->tile_report);
-    if (interrupted) {
-      printf("integrate_samples CANCELED!\n");
-      return -1;
+    SlTracePacket(&cxt, rays, times, nsamples, C_trace, hits, out_aovs);
+
+    for (int i = 0; i < nsamples; i++) {
+      Sample *smp = packet[i];
+      int interrupted = 0;
+
+      if (hits[i]) {
+        smp->data[0] = C_trace[i].r;
+        smp->data[1] = C_trace[i].g;
+        smp->data[2] = C_trace[i].b;
+        smp->data[3] = C_trace[i].a;
+      } else {
+        smp->data[0] = 0;
+        smp->data[1] = 0;
+        smp->data[2] = 0;
+        smp->data[3] = 0;
+      }
+      if (smp->aov != NULL) {
+        *smp->aov = out_aovs[i];
+      }
+
+      interrupted = CbReportSampleDone(&worker->tile_report);
+      if (interrupted) {
+        printf("integrate_samples CANCELED!\n");
+        return -1;
+      }
     }
   }
   return 0;
@@ -1078,6 +1642,9 @@ static ThreadStatus render_tile(void *data, const ThreadContext *context)
   int interrupted = 0;
 
   set_working_region(worker, context->iteration_id);
+  if (worker->sampler->GenerateSamples(worker->tile_region)) {
+    /* TODO error handling */
+  }
 
   interrupted = render_tile_start(worker);
   if (interrupted) {
@@ -1096,4 +1663,128 @@ static ThreadStatus render_tile(void *data, const ThreadContext *context)
   return THREAD_LOOP_CONTINUE;
 }
 
+static Ray get_pixel_center_ray(const Worker *worker, int x, int y)
+{
+  const Vector2 uv(
+          (x + .5) / worker->xres,
+      1 - (y + .5) / worker->yres);
+  Ray ray;
+
+  worker->camera->GetRay(uv, worker->sampler->GetSampleTimeRange()[0], &ray);
+  return ray;
+}
+
+static GBufferPixel *get_gbuffer_pixel(Worker *worker, int x, int y)
+{
+  const Rectangle &region = worker->render_region;
+  const int width = region.Size()[0];
+  const int index = (y - region.min[1]) * width + (x - region.min[0]);
+
+  return &(*worker->gbuffer)[index];
+}
+
+static void store_gbuffer_pixel(const Intersection &isect, GBufferPixel *pixel)
+{
+  pixel->N = isect.N;
+  pixel->Cd = isect.Cd;
+  pixel->uv = isect.uv;
+  pixel->dPdu = isect.dPdu;
+  pixel->dPdv = isect.dPdv;
+  pixel->object = isect.object;
+  pixel->shading_group_id = isect.shading_group_id;
+  pixel->t_hit = isect.t_hit;
+}
+
+static void load_gbuffer_pixel(const GBufferPixel &pixel, const Ray &ray,
+    Intersection *isect)
+{
+  if (pixel.object == NULL) {
+    return;
+  }
+  isect->P = RayPointAt(ray, pixel.t_hit);
+  isect->N = pixel.N;
+  isect->Cd = pixel.Cd;
+  isect->uv = pixel.uv;
+  isect->dPdu = pixel.dPdu;
+  isect->dPdv = pixel.dPdv;
+  isect->object = pixel.object;
+  isect->shading_group_id = pixel.shading_group_id;
+  isect->t_hit = pixel.t_hit;
+}
+
+static ThreadStatus intersect_preview_tile(void *data, const ThreadContext *context)
+{
+  Worker *worker_list = (Worker *) data;
+  Worker *worker = &worker_list[context->thread_id];
+  Ray rays[MAX_PACKET_RAYS];
+  double times[MAX_PACKET_RAYS];
+  Intersection isects[MAX_PACKET_RAYS];
+
+  set_working_region(worker, context->iteration_id);
+  const Rectangle &tile = worker->tile_region;
+  const double time = worker->sampler->GetSampleTimeRange()[0];
+
+  if (render_tile_start(worker)) {
+    return THREAD_LOOP_CANCEL;
+  }
+
+  // runs of pixels in a row are contiguous in g-buffer
+  for (int y = tile.min[1]; y < tile.max[1]; y++) {
+    for (int x = tile.min[0]; x < tile.max[0]; x += MAX_PACKET_RAYS) {
+      const int xend = x + MAX_PACKET_RAYS < tile.max[0] ?
+          x + MAX_PACKET_RAYS : tile.max[0];
+      const int nrays = xend - x;
+
+      for (int i = 0; i < nrays; i++) {
+        rays[i] = get_pixel_center_ray(worker, x + i, y);
+        times[i] = time;
+      }
+
+      SlIntersectPacket(&worker->context, rays, times, nrays, isects);
+
+      GBufferPixel *pixels = get_gbuffer_pixel(worker, x, y);
+      for (int i = 0; i < nrays; i++) {
+        store_gbuffer_pixel(isects[i], &pixels[i]);
+      }
+    }
+  }
+
+  return THREAD_LOOP_CONTINUE;
+}
+
+static ThreadStatus shade_preview_tile(void *data, const ThreadContext *context)
+{
+  Worker *worker_list = (Worker *) data;
+  Worker *worker = &worker_list[context->thread_id];
+  AovSample aov;
+  AovSample *out_aov = worker->has_aovs ? &aov : NULL;
+
+  set_working_region(worker, context->iteration_id);
+  const Rectangle &tile = worker->tile_region;
+
+  if (render_tile_start(worker)) {
+    return THREAD_LOOP_CANCEL;
+  }
+
+  for (int y = tile.min[1]; y < tile.max[1]; y++) {
+    for (int x = tile.min[0]; x < tile.max[0]; x++) {
+      const Ray ray = get_pixel_center_ray(worker, x, y);
+      Intersection isect;
+      Color4 color;
+
+      load_gbuffer_pixel(*get_gbuffer_pixel(worker, x, y), ray, &isect);
+      SlShadeIntersection(&worker->context, &ray, &isect, &color, out_aov);
+
+      worker->framebuffer->SetColor(x, y, color);
+      if (out_aov != NULL) {
+        accumulate_aovs(worker, x, y, out_aov->channels, 1);
+      }
+    }
+  }
+
+  render_tile_done(worker);
+
+  return THREAD_LOOP_CONTINUE;
+}
+
 } // namespace xxx
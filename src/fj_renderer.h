@@ -6,6 +6,7 @@
 
 #include "fj_compatibility.h"
 #include "fj_callback.h"
+#include "fj_aov.h"
 #include "fj_progress.h"
 #include "fj_timer.h"
 
@@ -38,7 +39,8 @@ public:
 
 enum RendererSamplerType {
   RENDERER_FIXED_GRID_SAMPLER = 0,
-  RENDERER_ADAPTIVE_GRID_SAMPLER
+  RENDERER_ADAPTIVE_GRID_SAMPLER,
+  RENDERER_VARIANCE_SAMPLER
 };
 
 class Renderer {
@@ -49,15 +51,30 @@ public:
   void SetResolution(int xres, int yres);
   void SetRenderRegion(int xmin, int ymin, int xmax, int ymax);
   void SetTileSize(int xtilesize, int ytilesize);
+  void SetTileOrder(int tile_order);
   void SetFilterWidth(float xfwidth, float yfwidth);
+  void SetFilterType(int filtertype);
 
   void SetSamplerType(int sampler_type);
   void SetPixelSamples(int xrate, int yrate);
   void SetMaxSubdivision(int max_subd);
   void SetSubdivisionThreshold(float subd_threshold);
+  void SetMaxPixelSamples(int max_samples);
+  void SetVarianceThreshold(float variance_threshold);
   void SetSampleJitter(float jitter);
   void SetSampleTimeRange(double start_time, double end_time);
 
+  // progressive rendering refines the whole frame in passes of
+  // 1, 4, 16 ... samples per pixel up to the pixel samples.
+  // with a time budget in seconds, passes at the pixel samples
+  // keep being added until the budget runs out.
+  void SetProgressive(int progressive);
+  void SetProgressiveTimeBudget(double seconds);
+  // preview traces only camera rays through pixel centers into a
+  // g-buffer, then shades the hits in a separate pass without shadows,
+  // secondary rays and volumes
+  void SetPreview(int preview);
+
   void SetShadowEnable(int enable);
   void SetMaxReflectDepth(int max_depth);
   void SetMaxRefractDepth(int max_depth);
@@ -66,9 +83,17 @@ public:
   void SetRaymarchShadowStep(double step);
   void SetRaymarchReflectStep(double step);
   void SetRaymarchRefractStep(double step);
+  void SetRaymarchAdaptive(int adaptive);
+  // max light samples per shading point. 0 samples all lights
+  void SetLightSampleBudget(int budget);
+  // reflect and refract rays carrying less than the threshold to the
+  // camera are terminated at random. 0 traces all of them
+  void SetRussianRouletteThreshold(double threshold);
 
   void SetCamera(Camera *cam);
   void SetFrameBuffers(FrameBuffer *fb);
+  // aovs are rendered only when their framebuffers are set
+  void SetAovFrameBuffer(int aov, FrameBuffer *fb);
   void SetTargetObjects(ObjectGroup *grp);
   void SetTargetLights(Light **lights, int nlights);
 
@@ -87,6 +112,10 @@ public:
       SampleDoneCallback sample_done,
       TileDoneCallback tile_done);
 
+  void SetPassReportCallback(void *data,
+      PassStartCallback pass_start,
+      PassDoneCallback pass_done);
+
   int RenderScene();
 
 public:
@@ -99,6 +128,7 @@ public:
 
   Camera *camera_;
   FrameBuffer *framebuffer_;
+  FrameBuffer *aov_framebuffers_[AOV_COUNT];
   ObjectGroup *target_objects_;
   Light **target_lights_;
   int nlights_;
@@ -106,16 +136,24 @@ public:
   int resolution_[2];
   Rectangle frame_region_;
   int tilesize_[2];
+  int tile_order_;
   float filterwidth_[2];
+  int filtertype_;
 
   int sampler_type_;
   int pixelsamples_[2];
   int max_subd_;
   float subd_threshold_;
+  int max_samples_;
+  float variance_threshold_;
   float jitter_;
   double sample_time_start_;
   double sample_time_end_;
 
+  int progressive_;
+  double time_budget_;
+  int preview_;
+
   int cast_shadow_;
   int max_reflect_depth_;
   int max_refract_depth_;
@@ -124,12 +162,16 @@ public:
   double raymarch_shadow_step_;
   double raymarch_reflect_step_;
   double raymarch_refract_step_;
+  int raymarch_adaptive_;
+  int light_sample_budget_;
+  double russian_roulette_threshold_;
 
   int use_max_thread_;
   int thread_count_;
 
   FrameReport frame_report_;
   TileReport tile_report_;
+  PassReport pass_report_;
   FrameProgress frame_progress_;
 
   int32_t frame_id_;
@@ -14,18 +14,26 @@ namespace fj {
 
 Sampler::Sampler() :
   res_(1, 1),
+  render_region_(),
   rate_(1, 1),
   fwidth_(1., 1.),
   jitter_(1.),
+  seed_(0),
   max_subd_(1),
   subd_threshold_(.05),
+  max_samples_(64),
+  variance_threshold_(.02),
 
   need_jitter_(true),
   need_time_sampling_(false),
 
   sample_time_start_(0),
-  sample_time_end_(0)
+  sample_time_end_(0),
+
+  store_aovs_(false),
+  aovs_()
 {
+  render_region_.max = res_;
 }
 
 Sampler::~Sampler()
@@ -36,9 +44,17 @@ void Sampler::SetResolution(const Int2 &resolution)
 {
   assert(resolution[0] > 0 && resolution[1] > 0);
   res_ = resolution;
+  render_region_.min = Int2(0, 0);
+  render_region_.max = res_;
   update_sample_counts();
 }
 
+void Sampler::SetRenderRegion(const Rectangle &region)
+{
+  assert(region.min[0] < region.max[0] && region.min[1] < region.max[1]);
+  render_region_ = region;
+}
+
 void Sampler::SetPixelSamples(const Int2 &pixel_samples)
 {
   assert(pixel_samples[0] > 0 && pixel_samples[1] > 0);
@@ -66,6 +82,19 @@ void Sampler::SetSubdivisionThreshold(Real subd_threshold)
   subd_threshold_ = subd_threshold;
 }
 
+void Sampler::SetMaxPixelSamples(int max_samples)
+{
+  assert(max_samples > 0);
+  max_samples_ = max_samples;
+  update_sample_counts();
+}
+
+void Sampler::SetVarianceThreshold(Real variance_threshold)
+{
+  assert(variance_threshold >= 0);
+  variance_threshold_ = variance_threshold;
+}
+
 void Sampler::SetJitter(Real jitter)
 {
   assert(jitter >= 0 && jitter <= 1);
@@ -85,11 +114,21 @@ void Sampler::SetSampleTimeRange(Real start_time, Real end_time)
   need_time_sampling_ = true;
 }
 
+void Sampler::SetAovStored(bool stored)
+{
+  store_aovs_ = stored;
+}
+
 const Int2 &Sampler::GetResolution() const
 {
   return res_;
 }
 
+const Rectangle &Sampler::GetRenderRegion() const
+{
+  return render_region_;
+}
+
 const Int2 &Sampler::GetPixelSamples() const
 {
   return rate_;
@@ -110,6 +149,16 @@ Real Sampler::GetSubdivisionThreshold() const
   return subd_threshold_;
 }
 
+int Sampler::GetMaxPixelSamples() const
+{
+  return max_samples_;
+}
+
+Real Sampler::GetVarianceThreshold() const
+{
+  return variance_threshold_;
+}
+
 Vector2 Sampler::GetSampleTimeRange() const
 {
   return Vector2(sample_time_start_, sample_time_end_);
@@ -130,6 +179,22 @@ Real Sampler::GetJitter() const
   return jitter_;
 }
 
+void Sampler::SetSeed(int seed)
+{
+  assert(seed >= 0);
+  seed_ = seed;
+}
+
+int Sampler::GetSeed() const
+{
+  return seed_;
+}
+
+bool Sampler::IsAovStored() const
+{
+  return store_aovs_;
+}
+
 int Sampler::GenerateSamples(const Rectangle &region)
 {
   return generate_samples(region);
@@ -140,10 +205,50 @@ Sample *Sampler::GetNextSample()
   return get_next_sample();
 }
 
-void Sampler::GetSampleSetInPixel(std::vector<Sample> &pixelsamples,
-    int pixel_x, int pixel_y) const
+int Sampler::GetNextSamples(Sample **samples, int max_samples)
+{
+  assert(max_samples > 0);
+  return get_next_samples(samples, max_samples);
+}
+
+int Sampler::get_next_samples(Sample **samples, int max_samples)
 {
-  get_sampleset_in_pixel(pixelsamples, Int2(pixel_x, pixel_y));
+  samples[0] = get_next_sample();
+  return samples[0] == NULL ? 0 : 1;
+}
+
+void Sampler::GetOwnedSamples(std::vector<const Sample *> &samples) const
+{
+  samples.clear();
+  get_owned_samples(samples);
+}
+
+bool Sampler::is_owned_pixel(const Rectangle &region, const Int2 &pixel) const
+{
+  const Rectangle &render = GetRenderRegion();
+
+  for (int i = 0; i < 2; i++) {
+    if (pixel[i] < region.min[i] && region.min[i] != render.min[i]) {
+      return false;
+    }
+    if (pixel[i] >= region.max[i] && region.max[i] != render.max[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Sampler::attach_aovs(std::vector<Sample> &samples)
+{
+  if (!store_aovs_) {
+    return;
+  }
+
+  // aovs already traced are kept by resizing
+  aovs_.resize(samples.size());
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    samples[i].aov = &aovs_[i];
+  }
 }
 
 } // namespace xxx
@@ -5,65 +5,100 @@
 #define FJ_SAMPLER_H
 
 #include "fj_pixel_sample.h"
+#include "fj_rectangle.h"
 #include "fj_vector.h"
 #include "fj_types.h"
 #include <vector>
 
 namespace fj {
 
-class Rectangle;
-
 class Sampler {
 public:
   Sampler();
   virtual ~Sampler();
 
   void SetResolution(const Int2 &resolution);
+  // regions on the border of render region generate samples in the
+  // filter margin since no neighbor region will trace them
+  void SetRenderRegion(const Rectangle &region);
   void SetPixelSamples(const Int2 &pixel_samples);
   void SetFilterWidth(const Vector2 &filter_width);
   // TODO ADAPTIVE_TEST
   void SetMaxSubdivision(int max_subd);
   void SetSubdivisionThreshold(Real subd_threshold);
+  void SetMaxPixelSamples(int max_samples);
+  void SetVarianceThreshold(Real variance_threshold);
 
   void SetJitter(Real jitter);
+  // samples with different seeds jitter differently so that
+  // passes of the same region can be accumulated
+  void SetSeed(int seed);
   void SetSampleTimeRange(Real start_time, Real end_time);
+  // samples point to aovs only when they are stored
+  void SetAovStored(bool stored);
 
   const Int2    &GetResolution() const;
+  const Rectangle &GetRenderRegion() const;
   const Int2    &GetPixelSamples() const;
   const Vector2 &GetFilterWidth() const;
   // TODO ADAPTIVE_TEST
   int            GetMaxSubdivision() const;
   Real           GetSubdivisionThreshold() const;
+  int            GetMaxPixelSamples() const;
+  Real           GetVarianceThreshold() const;
 
   Vector2 GetSampleTimeRange() const;
   bool IsSamplingTime() const;
   bool IsJittered() const;
   Real GetJitter() const;
+  int GetSeed() const;
+  bool IsAovStored() const;
 
   int GenerateSamples(const Rectangle &region);
   Sample *GetNextSample();
-  void GetSampleSetInPixel(std::vector<Sample> &pixelsamples,
-      int pixel_x, int pixel_y) const;
+  // Gets up to max_samples samples that can be traced together and
+  // returns the count. Samplers deciding next samples from the previous
+  // results return one sample at a time.
+  int GetNextSamples(Sample **samples, int max_samples);
+  // Samples to be splatted for the region. Each sample in the frame is
+  // owned by exactly one region even if neighbors generate it as well.
+  void GetOwnedSamples(std::vector<const Sample *> &samples) const;
+
+protected:
+  // Tests whether the pixel belongs to the region or to its margin
+  // on the border of render region.
+  bool is_owned_pixel(const Rectangle &region, const Int2 &pixel) const;
+  // Points the samples to the aov storage if aovs are stored. Needs to
+  // be called again whenever samples are added since the storage is
+  // resized and moved with them.
+  void attach_aovs(std::vector<Sample> &samples);
 
 private:
   virtual void update_sample_counts() = 0;
   virtual int generate_samples(const Rectangle &region) = 0;
   virtual Sample *get_next_sample() = 0;
-  virtual void get_sampleset_in_pixel(std::vector<Sample> &pixelsamples,
-      const Int2 &pixel_pos) const = 0;
+  virtual int get_next_samples(Sample **samples, int max_samples);
+  virtual void get_owned_samples(std::vector<const Sample *> &samples) const = 0;
 
   Int2 res_;
+  Rectangle render_region_;
   Int2 rate_;
   Vector2 fwidth_;
   Real jitter_;
+  int seed_;
   int  max_subd_;
   Real subd_threshold_;
+  int  max_samples_;
+  Real variance_threshold_;
 
   bool need_jitter_;
   bool need_time_sampling_;
 
   Real sample_time_start_;
   Real sample_time_end_;
+
+  bool store_aovs_;
+  std::vector<AovSample> aovs_;
 };
 
 } // namespace xxx
@@ -53,6 +53,8 @@ Scene::~Scene()
 ObjectInstance *Scene::NewObjectInstance()
 {
   ObjectInstance *object = new ObjectInstance();
+  // starts from 1 so that id 0 means no object
+  object->SetID(ObjectInstanceList.size() + 1);
   return push_entry_(ObjectInstanceList, object);
 }
 
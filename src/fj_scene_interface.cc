@@ -7,11 +7,15 @@
 #include "fj_point_cloud_io.h"
 #include "fj_primitive_set.h"
 #include "fj_multi_thread.h"
+#include "fj_volume_io.h"
 #include "fj_curve_io.h"
 #include "fj_mesh_io.h"
 #include "fj_shader.h"
+#include "fj_filter.h"
+#include "fj_tiler.h"
 #include "fj_scene.h"
 #include "fj_timer.h"
+#include "fj_aov.h"
 #include "fj_box.h"
 
 #include <map>
@@ -71,6 +75,14 @@ static void set_scene(Scene *scene)
   the_scene = scene;
 }
 
+/* bounds, implicit groups and accelerators are built for the scene */
+static bool is_scene_prepared = false;
+
+static void invalidate_prepared_scene()
+{
+  is_scene_prepared = false;
+}
+
 // binding ID to ID
 typedef std::map<ID,ID> IDMap;
 IDMap object_to_primset;
@@ -174,6 +186,7 @@ Status SiOpenPlugin(const char *filename)
 Status SiOpenScene(void)
 {
   set_scene(new Scene());
+  invalidate_prepared_scene();
 
   if (get_scene() == NULL) {
     set_errno(SI_ERR_NO_MEMORY);
@@ -188,6 +201,7 @@ Status SiCloseScene(void)
 {
   delete get_scene();
   set_scene(NULL);
+  invalidate_prepared_scene();
 
   set_errno(SI_ERR_NONE);
   return SI_SUCCESS;
@@ -253,6 +267,63 @@ Status SiSaveFrameBuffer(ID framebuffer, const char *filename)
   return SI_SUCCESS;
 }
 
+Status SiSaveVolume(ID volume, const char *filename)
+{
+  const Entry entry = decode_id(volume);
+  Volume *volume_ptr = NULL;
+  int err = 0;
+
+  if (entry.type != Type_Volume) {
+    /* TODO error handling */
+    return SI_FAIL;
+  }
+
+  volume_ptr = get_scene()->GetVolume(entry.index);
+  if (volume_ptr == NULL) {
+    /* TODO error handling */
+    return SI_FAIL;
+  }
+
+  volume_ptr->Compact();
+
+  err = VolSaveFile(*volume_ptr, filename);
+  if (err) {
+    /* TODO error handling */
+    return SI_FAIL;
+  }
+
+  set_errno(SI_ERR_NONE);
+  return SI_SUCCESS;
+}
+
+Status SiLoadVolume(ID volume, const char *filename)
+{
+  const Entry entry = decode_id(volume);
+  Volume *volume_ptr = NULL;
+  int err = 0;
+
+  if (entry.type != Type_Volume) {
+    /* TODO error handling */
+    return SI_FAIL;
+  }
+
+  volume_ptr = get_scene()->GetVolume(entry.index);
+  if (volume_ptr == NULL) {
+    /* TODO error handling */
+    return SI_FAIL;
+  }
+
+  err = VolLoadFile(*volume_ptr, filename);
+  if (err) {
+    set_errno(SI_ERR_FAILLOAD);
+    return SI_FAIL;
+  }
+
+  invalidate_prepared_scene();
+  set_errno(SI_ERR_NONE);
+  return SI_SUCCESS;
+}
+
 Status SiRunProcedure(ID procedure)
 {
   const Entry entry = decode_id(procedure);
@@ -272,6 +343,7 @@ Status SiRunProcedure(ID procedure)
     return SI_FAIL;
   }
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return SI_SUCCESS;
 }
@@ -302,6 +374,7 @@ Status SiAddObjectToGroup(ID group, ID object)
 
   group_ptr->AddObject(object_ptr);
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return SI_SUCCESS;
 }
@@ -364,6 +437,7 @@ ID SiNewObjectInstance(ID primset)
     return SI_BADID;
   }
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
 
   const ID obj_id = encode_id(Type_ObjectInstance, GET_LAST_ADDED_ID(ObjectInstance));
@@ -390,6 +464,7 @@ ID SiNewObjectGroup(void)
     return SI_BADID;
   }
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return encode_id(Type_ObjectGroup, GET_LAST_ADDED_ID(ObjectGroup));
 }
@@ -432,6 +507,7 @@ ID SiNewPointCloud(const char *filename)
   accel_id = encode_id(Type_Accelerator, GET_LAST_ADDED_ID(Accelerator));
   bind_primset_to_accelerator(ptc_id, accel_id);
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return ptc_id;
 }
@@ -560,6 +636,7 @@ ID SiNewVolume(void)
 
   PropSetAllDefaultValues(volume, get_builtin_type_property_list(Type_Volume));
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return volume_id;
 }
@@ -594,6 +671,7 @@ ID SiNewCurve(const char *filename)
   accel_id = encode_id(Type_Accelerator, GET_LAST_ADDED_ID(Accelerator));
   bind_primset_to_accelerator(curve_id, accel_id);
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return curve_id;
 }
@@ -628,6 +706,7 @@ ID SiNewLight(int light_type)
   }
   PropSetAllDefaultValues(light, get_builtin_type_property_list(Type_Light));
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return encode_id(Type_Light, GET_LAST_ADDED_ID(Light));
 }
@@ -666,6 +745,7 @@ ID SiNewMesh(const char *filename)
   accel_id = encode_id(Type_Accelerator, GET_LAST_ADDED_ID(Accelerator));
   bind_primset_to_accelerator(mesh_id, accel_id);
 
+  invalidate_prepared_scene();
   set_errno(SI_ERR_NONE);
   return mesh_id;
 }
@@ -816,6 +896,41 @@ Status SiAssignFrameBuffer(ID renderer, ID framebuffer)
   return SI_SUCCESS;
 }
 
+Status SiAssignAovFrameBuffer(ID renderer, const char *aov_name,
+    ID framebuffer)
+{
+  Renderer *renderer_ptr = NULL;
+  FrameBuffer *framebuffer_ptr = NULL;
+  const int aov = AovFindByName(aov_name);
+
+  if (aov < 0)
+    return SI_FAIL;
+
+  {
+    const Entry entry = decode_id(renderer);
+
+    if (entry.type != Type_Renderer)
+      return SI_FAIL;
+
+    renderer_ptr = get_scene()->GetRenderer(entry.index);
+    if (renderer_ptr == NULL)
+      return SI_FAIL;
+  }
+  {
+    const Entry entry = decode_id(framebuffer);
+
+    if (entry.type != Type_FrameBuffer)
+      return SI_FAIL;
+
+    framebuffer_ptr = get_scene()->GetFrameBuffer(entry.index);
+    if (framebuffer_ptr == NULL)
+      return SI_FAIL;
+  }
+
+  renderer_ptr->SetAovFrameBuffer(aov, framebuffer_ptr);
+  return SI_SUCCESS;
+}
+
 Status SiSetProperty1(ID id, const char *name, double v0)
 {
   const Entry entry = decode_id(id);
@@ -977,6 +1092,24 @@ Status SiSetTileReportCallback(ID id, void *data,
   }
 }
 
+Status SiSetPassReportCallback(ID id, void *data,
+    PassStartCallback pass_start,
+    PassDoneCallback pass_done)
+{
+  const Entry entry = decode_id(id);
+
+  if (entry.type == Type_Renderer) {
+    Renderer *renderer_ptr = get_scene()->GetRenderer(entry.index);
+    renderer_ptr->SetPassReportCallback(
+        data,
+        pass_start,
+        pass_done);
+    return SI_SUCCESS;
+  } else {
+    return SI_FAIL;
+  }
+}
+
 const Property *SiGetPropertyList(const char *type_name)
 {
   return get_property_list(type_name);
@@ -1006,6 +1139,32 @@ static Entry decode_id(ID id)
   return entry;
 }
 
+static void setup_object_lights(void)
+{
+  const Light **lightlist = (const Light **) get_scene()->GetLightList();
+  const int nlights = get_scene()->GetLightCount();
+  const int N = get_scene()->GetObjectInstanceCount();
+  int i;
+
+  /* light sample counts cached in objects follow light properties */
+  for (i = 0; i < N; i++) {
+    ObjectInstance *obj = get_scene()->GetObjectInstance(i);
+    obj->SetLightList(lightlist, nlights);
+  }
+}
+
+static void update_transparent_shadows(void)
+{
+  const int N = get_scene()->GetObjectGroupCount();
+  int i;
+
+  /* shader opacity can change between renders */
+  for (i = 0; i < N; i++) {
+    ObjectGroup *grp = get_scene()->GetObjectGroup(i);
+    grp->UpdateTransparentShadow();
+  }
+}
+
 static int create_implicit_groups(void)
 {
   ObjectGroup *all_objects = NULL;
@@ -1026,12 +1185,11 @@ static int create_implicit_groups(void)
   }
 
   /* Preparing ObjectInstance */
+  setup_object_lights();
+
   N = get_scene()->GetObjectInstanceCount();
   for (i = 0; i < N; i++) {
     ObjectInstance *obj = get_scene()->GetObjectInstance(i);
-    const Light **lightlist = (const Light **) get_scene()->GetLightList();
-    int nlights = get_scene()->GetLightCount();
-    obj->SetLightList(lightlist, nlights);
 
     if (obj->GetReflectTarget() == NULL)
       obj->SetReflectTarget(all_objects);
@@ -1064,6 +1222,17 @@ static int create_implicit_groups(void)
   return SI_SUCCESS;
 }
 
+static void compact_volumes(void)
+{
+  const int N = get_scene()->GetVolumeCount();
+  int i;
+
+  for (i = 0; i < N; i++) {
+    Volume *volume = get_scene()->GetVolume(i);
+    volume->Compact();
+  }
+}
+
 static void compute_objects_bounds(void)
 {
   int N = 0;
@@ -1088,7 +1257,7 @@ static void compute_objects_bounds(void)
   }
 }
 
-static void build_accelerators(void)
+static int build_accelerators(void)
 {
   Timer timer;
   Elapse elapse;
@@ -1121,14 +1290,19 @@ static void build_accelerators(void)
     if (mutable_acc != NULL) {
       mutable_acc->Build();
     }
-    if (mutable_volume_acc != NULL) {
-      VolumeAccBuild(mutable_volume_acc);
+    /* groups without volumes get an empty tree */
+    if (mutable_volume_acc != NULL && !mutable_volume_acc->HasBuilt()) {
+      if (mutable_volume_acc->Build()) {
+        return -1;
+      }
     }
   }
 
   elapse = timer.GetElapse();
   printf("# Building Accelerators Done\n");
   printf("#   %dh %dm %ds\n\n", elapse.hour, elapse.min, elapse.sec);
+
+  return 0;
 }
 
 static int prepare_render(const Renderer *renderer)
@@ -1137,6 +1311,16 @@ static int prepare_render(const Renderer *renderer)
 
   printf("\n");
 
+  /* renders after changing only renderer, camera, framebuffer, shader
+   * or light settings reuse the accelerators built for the scene */
+  if (is_scene_prepared) {
+    printf("# Reusing Accelerators\n\n");
+    setup_object_lights();
+    update_transparent_shadows();
+    return 0;
+  }
+
+  compact_volumes();
   compute_objects_bounds();
 
   /* TODO need err? */
@@ -1146,8 +1330,14 @@ static int prepare_render(const Renderer *renderer)
     return SI_FAIL;
   }
 
-  build_accelerators();
+  update_transparent_shadows();
+  err = build_accelerators();
+  if (err) {
+    /* TODO error handling */
+    return SI_FAIL;
+  }
 
+  is_scene_prepared = true;
   return 0;
 }
 
@@ -1185,6 +1375,19 @@ static int set_property(const Entry *entry,
   const Property *src_props = NULL;
   void *dst_entry = NULL;
 
+  switch (entry->type) {
+  case Type_Renderer:
+  case Type_Camera:
+  case Type_FrameBuffer:
+  case Type_Shader:
+  case Type_Light:
+    break;
+  default:
+    /* geometry, transforms or groups may change */
+    invalidate_prepared_scene();
+    break;
+  }
+
   /* procedure and shader type properties */
   if (entry->type == Type_Procedure) {
     Procedure *procedure = get_scene()->GetProcedure(entry->index);
@@ -7,6 +7,9 @@
 #include "fj_compatibility.h"
 #include "fj_callback.h"
 #include "fj_renderer.h"
+#include "fj_filter.h"
+#include "fj_tiler.h"
+#include "fj_volume.h"
 
 namespace fj {
 
@@ -57,7 +60,34 @@ enum SiLightType {
 
 enum SiSamplerType {
   SI_FIXED_GRID_SAMPLER = RENDERER_FIXED_GRID_SAMPLER,
-  SI_ADAPTIVE_GRID_SAMPLER = RENDERER_ADAPTIVE_GRID_SAMPLER
+  SI_ADAPTIVE_GRID_SAMPLER = RENDERER_ADAPTIVE_GRID_SAMPLER,
+  SI_VARIANCE_SAMPLER = RENDERER_VARIANCE_SAMPLER
+};
+
+enum SiFilterType {
+  SI_BOX_FILTER = FLT_BOX,
+  SI_GAUSSIAN_FILTER = FLT_GAUSSIAN,
+  SI_MITCHELL_FILTER = FLT_MITCHELL,
+  SI_BLACKMAN_HARRIS_FILTER = FLT_BLACKMAN_HARRIS
+};
+
+enum SiTileOrder {
+  SI_TILE_SCANLINE = TILE_SCANLINE,
+  SI_TILE_SPIRAL = TILE_SPIRAL,
+  SI_TILE_HILBERT = TILE_HILBERT,
+  SI_TILE_CENTER_OUT = TILE_CENTER_OUT
+};
+
+enum SiVoxelFormat {
+  SI_VOXEL_FLOAT = VOXEL_FLOAT,
+  SI_VOXEL_HALF = VOXEL_HALF,
+  SI_VOXEL_BYTE = VOXEL_BYTE
+};
+
+enum SiVolumeFilter {
+  SI_VOLUME_FILTER_NEAREST = VOLUME_FILTER_NEAREST,
+  SI_VOLUME_FILTER_TRILINEAR = VOLUME_FILTER_TRILINEAR,
+  SI_VOLUME_FILTER_TRICUBIC = VOLUME_FILTER_TRICUBIC
 };
 
 /* Error interfaces */
@@ -71,6 +101,8 @@ FJ_API Status SiOpenScene(void);
 FJ_API Status SiCloseScene(void);
 FJ_API Status SiRenderScene(ID renderer);
 FJ_API Status SiSaveFrameBuffer(ID framebuffer, const char *filename);
+FJ_API Status SiSaveVolume(ID volume, const char *filename);
+FJ_API Status SiLoadVolume(ID volume, const char *filename);
 FJ_API Status SiRunProcedure(ID procedure);
 
 FJ_API Status SiAddObjectToGroup(ID group, ID object);
@@ -91,6 +123,10 @@ FJ_API ID SiNewLight(int light_type);
 FJ_API ID SiNewMesh(const char *filename);
 
 FJ_API Status SiAssignFrameBuffer(ID renderer, ID framebuffer);
+/* aov_name is one of depth, normal, object_id, diffuse, specular,
+ * indirect and volume */
+FJ_API Status SiAssignAovFrameBuffer(ID renderer, const char *aov_name,
+    ID framebuffer);
 FJ_API Status SiAssignObjectGroup(ID id, const char *name, ID group);
 FJ_API Status SiAssignTurbulence(ID id, const char *name, ID turbulence);
 FJ_API Status SiAssignTexture(ID id, const char *name, ID texture);
@@ -124,6 +160,10 @@ FJ_API Status SiSetTileReportCallback(ID id, void *data,
     SampleDoneCallback sample_done,
     TileDoneCallback tile_done);
 
+FJ_API Status SiSetPassReportCallback(ID id, void *data,
+    PassStartCallback pass_start,
+    PassDoneCallback pass_done);
+
 } // namespace xxx
 
 #endif // FJ_XXX_H
@@ -66,6 +66,29 @@ void Shader::Evaluate(const TraceContext &cxt, const SurfaceInput &in,
   vptr_->MyEvaluate(self_, &cxt, &in, out);
 }
 
+void Shader::EvaluateBatch(const TraceContext *cxts, const SurfaceInput *ins,
+    int count, SurfaceOutput *outs) const
+{
+  if (vptr_ == NULL || vptr_->MyEvaluateBatch == NULL) {
+    for (int i = 0; i < count; i++) {
+      Evaluate(cxts[i], ins[i], &outs[i]);
+    }
+    return;
+  }
+  vptr_->MyEvaluateBatch(self_, cxts, ins, count, outs);
+}
+
+bool Shader::IsOpaque() const
+{
+  if (vptr_ == NULL) {
+    return true;
+  }
+  if (vptr_->MyIsOpaque == NULL) {
+    return false;
+  }
+  return vptr_->MyIsOpaque(self_) != 0;
+}
+
 const Property *Shader::GetPropertyList() const
 {
   // TODO need NullPlugin?
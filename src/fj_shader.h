@@ -20,6 +20,14 @@ class FJ_API ShaderFunctionTable {
 public:
   void (*MyEvaluate)(const void *self, const TraceContext *cxt,
       const SurfaceInput *in, SurfaceOutput *out);
+  // evaluates count inputs with their own contexts at once so that
+  // properties are read once and the loop stays in the shader.
+  // optional. NULL calls MyEvaluate for each input
+  void (*MyEvaluateBatch)(const void *self, const TraceContext *cxts,
+      const SurfaceInput *ins, int count, SurfaceOutput *outs);
+  // returns 1 when the shader never outputs opacity less than 1.
+  // optional. NULL means the shader can be transparent
+  int (*MyIsOpaque)(const void *self);
 };
 
 enum ShdErrorNo {
@@ -37,6 +45,9 @@ public:
 
   int Initialize(const Plugin *plugin);
   void Evaluate(const TraceContext &cxt, const SurfaceInput &in, SurfaceOutput *out) const;
+  void EvaluateBatch(const TraceContext *cxts, const SurfaceInput *ins, int count,
+      SurfaceOutput *outs) const;
+  bool IsOpaque() const;
 
   const Property *GetPropertyList() const;
   int SetProperty(const std::string &prop_name, const PropertyValue &src_data) const;
@@ -4,8 +4,11 @@
 #include "fj_shading.h"
 #include "fj_volume_accelerator.h"
 #include "fj_object_instance.h"
+#include "fj_irradiance_cache.h"
+#include "fj_low_discrepancy.h"
 #include "fj_intersection.h"
 #include "fj_object_group.h"
+#include "fj_aov.h"
 #include "fj_accelerator.h"
 #include "fj_interval.h"
 #include "fj_numeric.h"
@@ -14,10 +17,13 @@
 #include "fj_light.h"
 #include "fj_ray.h"
 
+#include <algorithm>
+#include <functional>
 #include <cassert>
 #include <cstdio>
 #include <cfloat>
 #include <cmath>
+#include <vector>
 
 namespace fj {
 
@@ -29,14 +35,34 @@ static void setup_ray(const Vector *ray_orig, const Vector *ray_dir,
     double ray_tmin, double ray_tmax,
     Ray *ray);
 static void setup_surface_input(
+    const TraceContext *cxt,
     const Intersection *isect,
     const Ray *ray,
     SurfaceInput *in);
+static double ray_footprint(const TraceContext *cxt, double t);
 
 static int trace_surface(const TraceContext *cxt, const Ray &ray,
     Color4 *out_rgba, double *t_hit);
+static void shade_surface(const TraceContext *cxt, const Ray &ray,
+    const Intersection &isect, Color4 *out_rgba, double *t_hit,
+    AovSample *out_aov);
+static void shade_surface_packet(const TraceContext *cxts, const Ray *rays,
+    const Intersection *isects, const bool *hits, int nrays,
+    Color4 *out_rgba, double *t_hits, AovSample *out_aovs);
+static void write_surface_output(const Intersection &isect,
+    const SurfaceOutput &out, Color4 *out_rgba, double *t_hit,
+    AovSample *out_aov);
+static int trace_shadow(const TraceContext *cxt, const Ray &ray,
+    Color4 *out_rgba);
+static int select_light_samples(const TraceContext *cxt, const SurfaceInput *in,
+    std::vector<int> *counts, std::vector<float> *weights);
+static int composite_volume(const TraceContext *cxt, Ray *ray,
+    int hit_surface, const Color4 &surface_color, const double *t_hit,
+    Color4 *out_rgba, AovSample *out_aov);
 static int raymarch_volume(const TraceContext *cxt, const Ray *ray,
     Color4 *out_rgba);
+static double adaptive_raymarch_step(const TraceContext *cxt, double fixed_step,
+    const Interval *first_interval, const Interval &span);
 
 void SlFaceforward(const Vector *I, const Vector *N, Vector *Nf)
 {
@@ -142,9 +168,7 @@ int SlTrace(const TraceContext *cxt,
 {
   Ray ray;
   Color4 surface_color;
-  Color4 volume_color;
   int hit_surface = 0;
-  int hit_volume = 0;
 
   out_rgba->r = 0;
   out_rgba->g = 0;
@@ -154,27 +178,115 @@ int SlTrace(const TraceContext *cxt,
     return 0;
   }
 
+  // survivors of russian roulette are brightened to keep the mean
+  TraceContext ray_cxt = *cxt;
+  double survival = 1;
+  if (cxt->throughput < cxt->russian_roulette_threshold) {
+    const uint32_t scramble =
+        LdHashCombine(LdHashPoint(*ray_orig), LdHashPoint(*ray_dir));
+
+    survival = cxt->throughput / cxt->russian_roulette_threshold;
+    if (LdRandom01(0, scramble) >= survival) {
+      return 0;
+    }
+    ray_cxt.throughput = cxt->russian_roulette_threshold;
+  }
+
   setup_ray(ray_orig, ray_dir, ray_tmin, ray_tmax, &ray);
 
-  hit_surface = trace_surface(cxt, ray, &surface_color, t_hit);
+  hit_surface = trace_surface(&ray_cxt, ray, &surface_color, t_hit);
 
-  if (shadow_ray_has_reached_opcity_limit(cxt, surface_color.a)) {
-    *out_rgba = surface_color;
-    return 1;
+  const int hit = composite_volume(&ray_cxt, &ray, hit_surface, surface_color,
+      t_hit, out_rgba, NULL);
+
+  if (survival < 1) {
+    out_rgba->r /= survival;
+    out_rgba->g /= survival;
+    out_rgba->b /= survival;
   }
+  return hit;
+}
 
-  if (hit_surface) {
-    ray.tmax = *t_hit;
+void SlTracePacket(const TraceContext *cxt,
+    const Ray *rays, const double *times, int nrays,
+    Color4 *out_rgba, int *hits, AovSample *out_aovs)
+{
+  Intersection isects[MAX_PACKET_RAYS];
+  bool hit_surfaces[MAX_PACKET_RAYS];
+
+  if (out_aovs != NULL) {
+    for (int i = 0; i < nrays; i++) {
+      out_aovs[i] = AovSample();
+    }
   }
 
-  hit_volume = raymarch_volume(cxt, &ray, &volume_color);
+  if (has_reached_bounce_limit(cxt)) {
+    for (int i = 0; i < nrays; i++) {
+      out_rgba[i] = Color4();
+      hits[i] = 0;
+    }
+    return;
+  }
 
-  out_rgba->r = volume_color.r + surface_color.r * (1 - volume_color.a);
-  out_rgba->g = volume_color.g + surface_color.g * (1 - volume_color.a);
-  out_rgba->b = volume_color.b + surface_color.b * (1 - volume_color.a);
-  out_rgba->a = volume_color.a + surface_color.a * (1 - volume_color.a);
+  // rays are traced together until the first hits, then shaded in
+  // batches of hits sharing a shader
+  const Accelerator *acc = cxt->trace_target->GetSurfaceAccelerator();
+  acc->IntersectPacket(rays, times, nrays, isects, hit_surfaces);
 
-  return hit_surface || hit_volume;
+  TraceContext ray_cxts[MAX_PACKET_RAYS];
+  Color4 surface_colors[MAX_PACKET_RAYS];
+  double t_hits[MAX_PACKET_RAYS];
+
+  for (int i = 0; i < nrays; i++) {
+    ray_cxts[i] = *cxt;
+    ray_cxts[i].time = times[i];
+    t_hits[i] = FLT_MAX;
+  }
+
+  shade_surface_packet(ray_cxts, rays, isects, hit_surfaces, nrays,
+      surface_colors, t_hits, out_aovs);
+
+  for (int i = 0; i < nrays; i++) {
+    Ray ray = rays[i];
+    AovSample *aov = out_aovs != NULL ? &out_aovs[i] : NULL;
+
+    hits[i] = composite_volume(&ray_cxts[i], &ray, hit_surfaces[i],
+        surface_colors[i], &t_hits[i], &out_rgba[i], aov);
+  }
+}
+
+void SlIntersectPacket(const TraceContext *cxt,
+    const Ray *rays, const double *times, int nrays,
+    Intersection *isects)
+{
+  bool hits[MAX_PACKET_RAYS];
+
+  const Accelerator *acc = cxt->trace_target->GetSurfaceAccelerator();
+  acc->IntersectPacket(rays, times, nrays, isects, hits);
+
+  for (int i = 0; i < nrays; i++) {
+    if (!hits[i]) {
+      isects[i] = Intersection();
+    }
+  }
+}
+
+void SlShadeIntersection(const TraceContext *cxt,
+    const Ray *ray, const Intersection *isect,
+    Color4 *out_rgba, AovSample *out_aov)
+{
+  double t_hit = FLT_MAX;
+
+  if (out_aov != NULL) {
+    *out_aov = AovSample();
+  }
+
+  if (isect->object == NULL) {
+    *out_rgba = Color4();
+    return;
+  }
+
+  shade_surface(cxt, *ray, *isect, out_rgba, &t_hit, out_aov);
 }
 
 int SlSurfaceRayIntersect(const TraceContext *cxt,
@@ -219,6 +331,14 @@ TraceContext SlCameraContext(const ObjectGroup *target)
   cxt.raymarch_shadow_step = .05;
   cxt.raymarch_reflect_step = .05;
   cxt.raymarch_refract_step = .05;
+  cxt.raymarch_adaptive = 0;
+  cxt.pixel_spread = 0;
+  cxt.ray_width = 0;
+  cxt.light_sample_budget = 0;
+  cxt.throughput = 1;
+  cxt.russian_roulette_threshold = 0;
+  cxt.irradiance_cache = NULL;
+  cxt.light_sample_stack = NULL;
 
   return cxt;
 }
@@ -307,7 +427,7 @@ int SlIlluminance(const TraceContext *cxt, const LightSample *sample,
     return 0;
   }
 
-  light_color = sample->light->Illuminate(*sample, *Ps);
+  light_color = sample->weight * sample->light->Illuminate(*sample, *Ps);
   if (light_color.r < .0001 &&
     light_color.g < .0001 &&
     light_color.b < .0001) {
@@ -321,11 +441,12 @@ int SlIlluminance(const TraceContext *cxt, const LightSample *sample,
   if (cxt->cast_shadow) {
     TraceContext shad_cxt;
     Color4 C_occl;
-    double t_hit = FLT_MAX;
+    Ray ray;
     int hit = 0;
 
     shad_cxt = SlShadowContext(cxt, in->shaded_object);
-    hit = SlTrace(&shad_cxt, Ps, &out->Ln, .0001, out->distance, &C_occl, &t_hit);
+    setup_ray(Ps, &out->Ln, .0001, out->distance, &ray);
+    hit = trace_shadow(&shad_cxt, ray, &C_occl);
 
     if (hit) {
       // return 0;
@@ -341,56 +462,88 @@ int SlIlluminance(const TraceContext *cxt, const LightSample *sample,
   return 1;
 }
 
-  // TODO temp solution compute before rendering
-int SlGetLightSampleCount(const SurfaceInput *in)
+LightSample *SlNewLightSamples(const TraceContext *cxt, const SurfaceInput *in,
+    int *nsamples)
 {
   const Light **lights = in->shaded_object->GetLightList();
   const int nlights = SlGetLightCount(in);
-  int nsamples = 0;
-  int i;
-
-  if (lights == NULL) {
-    return 0;
-  }
-
-  for (i = 0; i < nlights; i++) {
-    nsamples += lights[i]->GetSampleCount();
-  }
-
-  return nsamples;
-}
-
-LightSample *SlNewLightSamples(const SurfaceInput *in)
-{
-  const Light **lights = in->shaded_object->GetLightList();
-  const int nlights = SlGetLightCount(in);
-  const int nsamples = SlGetLightSampleCount(in);
+  std::vector<int> counts;
+  std::vector<float> weights;
   int i;
 
   LightSample *samples = NULL;
   LightSample *sample = NULL;
 
-  if (nsamples == 0) {
+  // no counts means all samples of every light. the count cached in
+  // the object is refreshed from the lights every time a render starts
+  *nsamples = select_light_samples(cxt, in, &counts, &weights);
+  if (*nsamples == 0) {
     // TODO handling
     return NULL;
   }
 
-  samples = new LightSample[nsamples];
+  // shading points and lights have their own sample patterns
+  // so that the shadows have noise rather than banding
+  const uint32_t scramble = LdHashPoint(in->P);
+
+  if (cxt->light_sample_stack != NULL) {
+    samples = cxt->light_sample_stack->Push(*nsamples);
+  } else {
+    samples = new LightSample[*nsamples];
+  }
+
   sample = samples;
   for (i = 0; i < nlights; i++) {
-    const int nsmp = lights[i]->GetSampleCount();
-    lights[i]->GetSamples(sample, nsmp);
+    const int nsmp = counts.empty() ? lights[i]->GetSampleCount() : counts[i];
+    const float weight = weights.empty() ? 1 : weights[i];
+    if (nsmp == 0) {
+      continue;
+    }
+    lights[i]->GetSamples(sample, nsmp, LdHashCombine(scramble, i), cxt->time);
+    for (int j = 0; j < nsmp; j++) {
+      sample[j].weight = weight;
+    }
     sample += nsmp;
   }
+  assert(sample - samples == *nsamples);
 
   return samples;
 }
 
-void SlFreeLightSamples(LightSample * samples)
+void SlFreeLightSamples(const TraceContext *cxt, LightSample *samples)
 {
   if (samples == NULL)
     return;
-  delete [] samples;
+
+  if (cxt->light_sample_stack != NULL) {
+    cxt->light_sample_stack->Pop(samples);
+  } else {
+    delete [] samples;
+  }
+}
+
+int SlLookupIrradiance(const TraceContext *cxt,
+    const SurfaceInput *in, const void *self, double spacing,
+    Color *irradiance)
+{
+  if (cxt->irradiance_cache == NULL || spacing <= 0) {
+    return 0;
+  }
+
+  return cxt->irradiance_cache->Lookup(in->shaded_object, self,
+      in->P, in->N, spacing, irradiance);
+}
+
+void SlStoreIrradiance(const TraceContext *cxt,
+    const SurfaceInput *in, const void *self, double spacing,
+    const Color *irradiance)
+{
+  if (cxt->irradiance_cache == NULL || spacing <= 0) {
+    return;
+  }
+
+  cxt->irradiance_cache->Insert(in->shaded_object, self,
+      in->P, in->N, spacing, *irradiance);
 }
 
 #define MUL(a,val) do { \
@@ -400,8 +553,8 @@ void SlFreeLightSamples(LightSample * samples)
   } while(0)
 void SlBumpMapping(const Texture *bump_map,
     const Vector *dPdu, const Vector *dPdv,
-    const TexCoord *texcoord, double amplitude,
-    const Vector *N, Vector *N_bump)
+    const TexCoord *texcoord, const TexCoord *uv_footprint,
+    double amplitude, const Vector *N, Vector *N_bump)
 {
   Color4 C_tex0(0, 0, 0, 1);
   Color4 C_tex1(0, 0, 0, 1);
@@ -409,6 +562,7 @@ void SlBumpMapping(const Texture *bump_map,
   Vector N_dPdv;
   float Bu, Bv;
   float du, dv;
+  float du_diff, dv_diff;
   float val0, val1;
   const int xres = bump_map->GetWidth();
   const int yres = bump_map->GetHeight();
@@ -419,20 +573,22 @@ void SlBumpMapping(const Texture *bump_map,
 
   du = 1. / xres;
   dv = 1. / yres;
+  du_diff = Max(du, .5 * uv_footprint->u);
+  dv_diff = Max(dv, .5 * uv_footprint->v);
 
   // Bu = B(u - du, v) - B(v + du, v) / (2 * du)
-  C_tex0 = bump_map->Lookup(texcoord->u - du, texcoord->v);
-  C_tex1 = bump_map->Lookup(texcoord->u + du, texcoord->v);
+  C_tex0 = bump_map->Lookup(texcoord->u - du_diff, texcoord->v);
+  C_tex1 = bump_map->Lookup(texcoord->u + du_diff, texcoord->v);
   val0 = Luminance4(C_tex0);
   val1 = Luminance4(C_tex1);
-  Bu = (val0 - val1) / (2 * du);
+  Bu = (val0 - val1) / (2 * du_diff);
 
   // Bv = B(u, v - dv) - B(v, v + dv) / (2 * dv)
-  C_tex0 = bump_map->Lookup(texcoord->u, texcoord->v - dv);
-  C_tex1 = bump_map->Lookup(texcoord->u, texcoord->v + dv);
+  C_tex0 = bump_map->Lookup(texcoord->u, texcoord->v - dv_diff);
+  C_tex1 = bump_map->Lookup(texcoord->u, texcoord->v + dv_diff);
   val0 = Luminance4(C_tex0);
   val1 = Luminance4(C_tex1);
-  Bv = (val0 - val1) / (2 * dv);
+  Bv = (val0 - val1) / (2 * dv_diff);
 
   // N ~= N + Bv(N x Pu) + Bu(N x Pv)
   N_dPdu = Cross(*N, *dPdu);
@@ -488,6 +644,7 @@ static void setup_ray(const Vector *ray_orig, const Vector *ray_dir,
 }
 
 static void setup_surface_input(
+    const TraceContext *cxt,
     const Intersection *isect,
     const Ray *ray,
     SurfaceInput *in)
@@ -501,6 +658,18 @@ static void setup_surface_input(
 
   in->dPdu = isect->dPdu;
   in->dPdv = isect->dPdv;
+
+  // texture space footprint from the lengths of the derivatives
+  const double dPdu_len = Length(in->dPdu);
+  const double dPdv_len = Length(in->dPdv);
+  in->footprint = ray_footprint(cxt, isect->t_hit);
+  in->uv_footprint.u = dPdu_len > 0 ? in->footprint / dPdu_len : 0;
+  in->uv_footprint.v = dPdv_len > 0 ? in->footprint / dPdv_len : 0;
+}
+
+static double ray_footprint(const TraceContext *cxt, double t)
+{
+  return cxt->ray_width + cxt->pixel_spread * Max(t, 0.);
 }
 
 static int trace_surface(const TraceContext *cxt, const Ray &ray,
@@ -525,29 +694,184 @@ static int trace_surface(const TraceContext *cxt, const Ray &ray,
 #endif
 
   if (hit) {
-    SurfaceInput in;
-    SurfaceOutput out;
+    shade_surface(cxt, ray, isect, out_rgba, t_hit, NULL);
+  }
+
+  return hit;
+}
+
+static int trace_shadow(const TraceContext *cxt, const Ray &ray,
+    Color4 *out_rgba)
+{
+  const ObjectGroup *target = cxt->trace_target;
+  Color4 surface_color;
+  double t_hit = FLT_MAX;
+  int hit_surface = 0;
+
+  // any opaque object on the way blocks the light entirely
+  if (target->GetSurfaceAccelerator()->Occluded(ray, cxt->time)) {
+    *out_rgba = Color4(0, 0, 0, 1);
+    return 1;
+  }
 
-    setup_surface_input(&isect, &ray, &in);
+  // the nearest surface hit can only be a transparent one now
+  if (target->HasTransparentShadow()) {
+    hit_surface = trace_surface(cxt, ray, &surface_color, &t_hit);
+  }
+
+  Ray volume_ray = ray;
+  return composite_volume(cxt, &volume_ray, hit_surface, surface_color, &t_hit,
+      out_rgba, NULL);
+}
+
+static void shade_surface(const TraceContext *cxt, const Ray &ray,
+    const Intersection &isect, Color4 *out_rgba, double *t_hit,
+    AovSample *out_aov)
+{
+  SurfaceInput in;
+  SurfaceOutput out;
+
+  setup_surface_input(cxt, &isect, &ray, &in);
+
+  // rays traced by the shader start from the footprint at the hit
+  TraceContext shading_cxt = *cxt;
+  shading_cxt.ray_width = in.footprint;
+
+  const Shader *shader = isect.GetShader();
+  if (shader != NULL) {
+    shader->Evaluate(shading_cxt, in, &out);
+  } else {
+    out.Cs = NO_SHADER_COLOR;
+    out.Os = 1;
+  }
+
+  write_surface_output(isect, out, out_rgba, t_hit, out_aov);
+}
+
+class ShaderLess {
+public:
+  ShaderLess(const Intersection *isects) : isects_(isects) {}
+  bool operator()(int a, int b) const
+  {
+    // pointers to unrelated objects are only totally ordered by std::less
+    return std::less<const Shader *>()(
+        isects_[a].GetShader(), isects_[b].GetShader());
+  }
+private:
+  const Intersection *isects_;
+};
+
+static void shade_surface_packet(const TraceContext *cxts, const Ray *rays,
+    const Intersection *isects, const bool *hits, int nrays,
+    Color4 *out_rgba, double *t_hits, AovSample *out_aovs)
+{
+  int order[MAX_PACKET_RAYS];
+  int nhits = 0;
+
+  for (int i = 0; i < nrays; i++) {
+    if (hits[i]) {
+      order[nhits++] = i;
+    }
+  }
+  std::stable_sort(order, order + nhits, ShaderLess(isects));
+
+  TraceContext batch_cxts[MAX_PACKET_RAYS];
+  SurfaceInput batch_ins[MAX_PACKET_RAYS];
+  SurfaceOutput batch_outs[MAX_PACKET_RAYS];
+
+  for (int begin = 0; begin < nhits; ) {
+    const Shader *shader = isects[order[begin]].GetShader();
+    int count = 0;
+
+    while (begin + count < nhits &&
+        isects[order[begin + count]].GetShader() == shader) {
+      const int id = order[begin + count];
+      setup_surface_input(&cxts[id], &isects[id], &rays[id], &batch_ins[count]);
+      batch_cxts[count] = cxts[id];
+      batch_cxts[count].ray_width = batch_ins[count].footprint;
+      batch_outs[count] = SurfaceOutput();
+      count++;
+    }
 
-    const Shader *shader = isect.GetShader();
     if (shader != NULL) {
-      shader->Evaluate(*cxt, in, &out);
+      shader->EvaluateBatch(batch_cxts, batch_ins, count, batch_outs);
     } else {
-      out.Cs = NO_SHADER_COLOR;
-      out.Os = 1;
+      for (int i = 0; i < count; i++) {
+        batch_outs[i].Cs = NO_SHADER_COLOR;
+        batch_outs[i].Os = 1;
+      }
     }
 
-    out.Os = Clamp(out.Os, 0, 1);
-    out_rgba->r = out.Cs.r;
-    out_rgba->g = out.Cs.g;
-    out_rgba->b = out.Cs.b;
-    out_rgba->a = out.Os;
+    for (int i = 0; i < count; i++) {
+      const int id = order[begin + i];
+      AovSample *aov = out_aovs != NULL ? &out_aovs[id] : NULL;
+      write_surface_output(isects[id], batch_outs[i],
+          &out_rgba[id], &t_hits[id], aov);
+    }
+    begin += count;
+  }
+}
 
-    *t_hit = isect.t_hit;
+static void write_surface_output(const Intersection &isect,
+    const SurfaceOutput &surface_out, Color4 *out_rgba, double *t_hit,
+    AovSample *out_aov)
+{
+  SurfaceOutput out = surface_out;
+
+  out.Os = Clamp(out.Os, 0, 1);
+  out_rgba->r = out.Cs.r;
+  out_rgba->g = out.Cs.g;
+  out_rgba->b = out.Cs.b;
+  out_rgba->a = out.Os;
+
+  *t_hit = isect.t_hit;
+
+  if (out_aov != NULL) {
+    out_aov->SetScalar(AOV_DEPTH, isect.t_hit);
+    out_aov->SetVector(AOV_NORMAL, isect.N);
+    out_aov->SetScalar(AOV_OBJECT_ID, isect.object->GetID());
+    out_aov->SetColor(AOV_DIFFUSE, out.Cdiffuse);
+    out_aov->SetColor(AOV_SPECULAR, out.Cspecular);
+    out_aov->SetColor(AOV_INDIRECT, out.Cindirect);
   }
+}
 
-  return hit;
+static int composite_volume(const TraceContext *cxt, Ray *ray,
+    int hit_surface, const Color4 &surface_color, const double *t_hit,
+    Color4 *out_rgba, AovSample *out_aov)
+{
+  Color4 volume_color;
+  int hit_volume = 0;
+
+  if (shadow_ray_has_reached_opcity_limit(cxt, surface_color.a)) {
+    *out_rgba = surface_color;
+    return 1;
+  }
+
+  if (hit_surface) {
+    ray->tmax = *t_hit;
+  }
+
+  hit_volume = raymarch_volume(cxt, ray, &volume_color);
+
+  out_rgba->r = volume_color.r + surface_color.r * (1 - volume_color.a);
+  out_rgba->g = volume_color.g + surface_color.g * (1 - volume_color.a);
+  out_rgba->b = volume_color.b + surface_color.b * (1 - volume_color.a);
+  out_rgba->a = volume_color.a + surface_color.a * (1 - volume_color.a);
+
+  if (out_aov != NULL && hit_volume) {
+    // surface seen through the volume
+    const float transmittance = 1 - volume_color.a;
+    const int shading_aovs[] = {AOV_DIFFUSE, AOV_SPECULAR, AOV_INDIRECT};
+    for (int i = 0; i < 3; i++) {
+      const int aov = shading_aovs[i];
+      out_aov->SetColor(aov, transmittance * out_aov->GetColor(aov));
+    }
+    out_aov->SetColor(AOV_VOLUME,
+        Color(volume_color.r, volume_color.g, volume_color.b));
+  }
+
+  return hit_surface || hit_volume;
 }
 
 static int raymarch_volume(const TraceContext *cxt, const Ray *ray,
@@ -563,16 +887,14 @@ static int raymarch_volume(const TraceContext *cxt, const Ray *ray,
   out_rgba->a = 0;
 
   acc = cxt->trace_target->GetVolumeAccelerator();
-  hit = VolumeAccIntersect(acc, cxt->time, ray, &intervals);
+  hit = acc->Intersect(*ray, cxt->time, &intervals);
 
   if (!hit) {
     return 0;
   }
 
   {
-    Vector P;
-    Vector ray_delta;
-    double t = 0, t_start = 0, t_delta = 0, t_limit = 0;
+    double t_delta = 0;
     const float opacity_threshold = cxt->opacity_threshold;
 
     // t properties
@@ -593,74 +915,103 @@ static int raymarch_volume(const TraceContext *cxt, const Ray *ray,
       t_delta = cxt->raymarch_step;
       break;
     }
-    t_limit = intervals.GetMaxT();
-    t_limit = Min(t_limit, ray->tmax);
 
-    t_start = intervals.GetMinT();
-    if (t_start < 0) {
-      t_start = t_delta;
-    }
-    else {
-      t_start = t_start - fmod(t_start, t_delta) + t_delta;
-    }
+    // intervals are sorted by tmin. the ones containing the current
+    // sample point are kept in active while marching through each span
+    const Interval *next_interval = intervals.GetHead();
+    std::vector<const Interval *> active;
+    active.reserve(intervals.GetCount());
+
+    const int NSPANS = intervals.GetSpanCount();
+    for (int span_id = 0; span_id < NSPANS; span_id++) {
+      const Interval &span = intervals.GetSpan(span_id);
+      const double t_limit = Min(span.tmax, ray->tmax);
+      const double t_step = cxt->raymarch_adaptive ?
+          adaptive_raymarch_step(cxt, t_delta, next_interval, span) : t_delta;
+      double t_start = span.tmin;
+
+      // keep samples on the same grid across spans
+      if (t_start < 0) {
+        t_start = t_step;
+      }
+      else {
+        t_start = t_start - fmod(t_start, t_step) + t_step;
+      }
 
-    P = RayPointAt(*ray, t_start);
-    ray_delta.x = t_delta * ray->dir.x;
-    ray_delta.y = t_delta * ray->dir.y;
-    ray_delta.z = t_delta * ray->dir.z;
-    t = t_start;
-
-    // raymarch
-    while (t <= t_limit && out_rgba->a < opacity_threshold) {
-      const Interval *interval = intervals.GetHead();
-      Color color;
-      float opacity = 0;
-
-      // loop over volume candidates at this sample point
-      for (; interval != NULL; interval = interval->next) {
-        VolumeSample sample;
-        interval->object->GetVolumeSample(P, cxt->time, &sample);
-
-        // merge volume with max density
-        opacity = Max(opacity, t_delta * sample.density);
-
-        if (cxt->ray_context != CXT_SHADOW_RAY) {
-          SurfaceInput in;
-          SurfaceOutput out;
-
-          in.shaded_object = interval->object;
-          in.P = P;
-          in.N = Vector(0, 0, 0);
-
-          // TODO shading group
-          const Shader *shader = interval->object->GetShader(0);
-          if (shader != NULL) {
-            shader->Evaluate(*cxt, in, &out);
+      Vector P = RayPointAt(*ray, t_start);
+      const Vector ray_delta = t_step * ray->dir;
+      double t = t_start;
+
+      // raymarch
+      while (t <= t_limit && out_rgba->a < opacity_threshold) {
+        Color color;
+        float opacity = 0;
+
+        while (next_interval != NULL && next_interval->tmin <= t) {
+          active.push_back(next_interval);
+          next_interval = next_interval->next;
+        }
+
+        // loop over volumes containing this sample point
+        size_t nactive = 0;
+        for (size_t i = 0; i < active.size(); i++) {
+          const Interval *interval = active[i];
+          if (interval->tmax < t) {
+            continue;
+          }
+          active[nactive++] = interval;
+
+          VolumeSample sample;
+          if (cxt->ray_context == CXT_SHADOW_RAY) {
+            interval->object->GetVolumeShadowSample(P, cxt->time, &sample);
           } else {
-            out.Cs = NO_SHADER_COLOR;
-            out.Os = 1;
+            interval->object->GetVolumeSample(P, cxt->time, &sample);
           }
 
-          color.r = out.Cs.r * opacity;
-          color.g = out.Cs.g * opacity;
-          color.b = out.Cs.b * opacity;
+          // merge volume with max density
+          opacity = Max(opacity, t_step * sample.density);
+
+          if (cxt->ray_context != CXT_SHADOW_RAY) {
+            SurfaceInput in;
+            SurfaceOutput out;
+
+            in.shaded_object = interval->object;
+            in.P = P;
+            in.N = Vector(0, 0, 0);
+            in.footprint = ray_footprint(cxt, t);
+            // volumes have no texture space
+            in.uv_footprint = TexCoord(0, 0);
+
+            // TODO shading group
+            const Shader *shader = interval->object->GetShader(0);
+            if (shader != NULL) {
+              shader->Evaluate(*cxt, in, &out);
+            } else {
+              out.Cs = NO_SHADER_COLOR;
+              out.Os = 1;
+            }
+
+            color.r = out.Cs.r * opacity;
+            color.g = out.Cs.g * opacity;
+            color.b = out.Cs.b * opacity;
+          }
         }
-      }
+        active.resize(nactive);
 
-      // composite color
-      out_rgba->r = out_rgba->r + color.r * (1-out_rgba->a);
-      out_rgba->g = out_rgba->g + color.g * (1-out_rgba->a);
-      out_rgba->b = out_rgba->b + color.b * (1-out_rgba->a);
-      out_rgba->a = out_rgba->a + Clamp(opacity, 0, 1) * (1-out_rgba->a);
-
-      // advance sample point
-      P.x += ray_delta.x;
-      P.y += ray_delta.y;
-      P.z += ray_delta.z;
-      t += t_delta;
-    }
-    if (out_rgba->a >= opacity_threshold) {
-      out_rgba->a = 1;
+        // composite color
+        out_rgba->r = out_rgba->r + color.r * (1-out_rgba->a);
+        out_rgba->g = out_rgba->g + color.g * (1-out_rgba->a);
+        out_rgba->b = out_rgba->b + color.b * (1-out_rgba->a);
+        out_rgba->a = out_rgba->a + Clamp(opacity, 0, 1) * (1-out_rgba->a);
+
+        // advance sample point
+        P += ray_delta;
+        t += t_step;
+      }
+      if (out_rgba->a >= opacity_threshold) {
+        out_rgba->a = 1;
+        break;
+      }
     }
   }
   out_rgba->a = Clamp(out_rgba->a, 0, 1);
@@ -668,6 +1019,106 @@ static int raymarch_volume(const TraceContext *cxt, const Ray *ray,
   return hit;
 }
 
+static double adaptive_raymarch_step(const TraceContext *cxt, double fixed_step,
+    const Interval *first_interval, const Interval &span)
+{
+  // the finest volume in the span decides the step
+  double filter_size = REAL_MAX;
+  const Interval *interval = first_interval;
+  for (; interval != NULL && interval->tmin <= span.tmax; interval = interval->next) {
+    filter_size = Min(filter_size, interval->object->GetVolumeFilterSize(cxt->time));
+  }
+
+  // one voxel edge. filter size is the length of voxel diagonal
+  double step = filter_size / sqrt(3.);
+
+  // no need to be finer than the pixel footprint where the span starts
+  step = Max(step, ray_footprint(cxt, span.tmin));
+
+  // secondary rays are coarser by the ratio of their fixed steps
+  step *= fixed_step / cxt->raymarch_step;
+
+  return Max(step, .001);
+}
+
+static int select_light_samples(const TraceContext *cxt, const SurfaceInput *in,
+    std::vector<int> *counts, std::vector<float> *weights)
+{
+  const ObjectInstance *obj = in->shaded_object;
+  const Light **lights = obj->GetLightList();
+  const int nlights = lights == NULL ? 0 : SlGetLightCount(in);
+  const int budget = cxt->light_sample_budget;
+  int nsamples = 0;
+
+  // counts and weights are left empty when all samples are taken
+  if (nlights == 0 || budget <= 0 || obj->GetLocalLightSampleCount() <= budget) {
+    return obj->GetLightSampleCount();
+  }
+
+  counts->assign(nlights, 0);
+  weights->assign(nlights, 1);
+  for (int i = 0; i < nlights; i++) {
+    (*counts)[i] = lights[i]->GetSampleCount();
+  }
+
+  // lights at infinity keep all of their samples
+  std::vector<double> importance(nlights, 0.);
+  double sum = 0;
+  int last_local = 0;
+  int nlocals = 0;
+  for (int i = 0; i < nlights; i++) {
+    if (!lights[i]->IsInfinite()) {
+      importance[i] = lights[i]->EstimateContribution(in->P);
+      sum += importance[i];
+      last_local = i;
+      nlocals++;
+    }
+  }
+  // local lights are drawn uniformly when none seems to contribute
+  if (sum <= 0) {
+    for (int i = 0; i < nlights; i++) {
+      importance[i] = lights[i]->IsInfinite() ? 0 : 1;
+    }
+    sum = nlocals;
+  }
+
+  // budget draws of lights with one random offset stratify the draws.
+  // each light is drawn about budget * pdf times
+  const double offset = LdRandom01(0, LdHashPoint(in->P));
+  double cdf = 0;
+  int draw = 0;
+  for (int i = 0; i < nlights; i++) {
+    if (lights[i]->IsInfinite()) {
+      continue;
+    }
+
+    const double pdf = importance[i] / sum;
+    // the last one takes the draws left by rounding errors
+    cdf = i == last_local ? 1 : cdf + pdf;
+
+    int ndraws = 0;
+    while (draw < budget && (draw + offset) / budget < cdf) {
+      ndraws++;
+      draw++;
+    }
+
+    // a light drawn more times than it has samples uses all of them
+    const int nsmp = lights[i]->GetSampleCount();
+    if (ndraws == 0) {
+      (*counts)[i] = 0;
+      continue;
+    }
+    (*counts)[i] = ndraws < nsmp ? ndraws : nsmp;
+    (*weights)[i] = nsmp / (double) (*counts)[i] * ndraws / (pdf * budget);
+  }
+
+  for (int i = 0; i < nlights; i++) {
+    nsamples += (*counts)[i];
+  }
+
+  return nsamples;
+}
+
 static int shadow_ray_has_reached_opcity_limit(const TraceContext *cxt, float opac)
 {
   if (cxt->ray_context == CXT_SHADOW_RAY && opac > cxt->opacity_threshold) {
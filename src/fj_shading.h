@@ -13,7 +13,12 @@ namespace fj {
 
 class ObjectInstance;
 class ObjectGroup;
+class Intersection;
+class IrradianceCache;
+class LightSampleStack;
+class AovSample;
 class Texture;
+class Ray;
 
 enum RayContext {
   CXT_CAMERA_RAY = 0,
@@ -39,6 +44,34 @@ public:
   double raymarch_reflect_step;
   double raymarch_refract_step;
 
+  // step from voxel size and ray footprint instead of fixed steps.
+  // the fixed steps then only scale secondary rays against camera rays
+  int raymarch_adaptive;
+
+  // ray cone standing for ray differentials. the footprint of a ray is
+  // ray_width at its origin and grows by pixel_spread per unit distance.
+  // shaders get the footprint at the shading point as ray_width so that
+  // reflect and refract rays start from it
+  double pixel_spread;
+  double ray_width;
+
+  // max light samples per shading point from lights other than the
+  // ones at infinity. 0 samples all lights
+  int light_sample_budget;
+
+  // fraction of the ray color reaching the camera. shaders scale it
+  // by the weights of their reflect and refract rays. rays below the
+  // threshold survive with probability throughput / threshold
+  float throughput;
+  float russian_roulette_threshold;
+
+  // records of view independent shading owned by the thread.
+  // NULL disables caching
+  IrradianceCache *irradiance_cache;
+  // arrays of light samples reused by the thread.
+  // NULL allocates one for each shading point
+  LightSampleStack *light_sample_stack;
+
   const ObjectGroup *trace_target;
 };
 
@@ -56,6 +89,11 @@ public:
   Vector dPdu;
   Vector dPdv;
 
+  // width of the ray footprint at P in world space and in texture space.
+  // 0 when the ray has no footprint
+  double footprint;
+  TexCoord uv_footprint;
+
   const ObjectInstance *shaded_object;
 };
 
@@ -63,6 +101,12 @@ class FJ_API SurfaceOutput {
 public:
   Color Cs;
   float Os;
+
+  // parts of Cs written to aovs. left black by shaders that
+  // do not separate them
+  Color Cdiffuse;
+  Color Cspecular;
+  Color Cindirect;
 };
 
 class FJ_API LightOutput {
@@ -86,6 +130,21 @@ FJ_API void SlRefract(const Vector *I, const Vector *N, double ior,
 FJ_API int SlTrace(const TraceContext *cxt,
     const Vector *ray_orig, const Vector *ray_dir,
     double ray_tmin, double ray_tmax, Color4 *out_color, double *t_hit);
+// traces coherent rays such as camera rays sharing the traversal
+// of the surface accelerator. the number of rays is up to MAX_PACKET_RAYS.
+// aovs of the rays are written to out_aovs unless it is NULL
+FJ_API void SlTracePacket(const TraceContext *cxt,
+    const Ray *rays, const double *times, int nrays,
+    Color4 *out_color, int *hits, AovSample *out_aovs);
+// deferred shading. camera rays are intersected first and the hits are
+// shaded in a later pass. no hit is told by NULL object of intersection.
+// volumes are not marched
+FJ_API void SlIntersectPacket(const TraceContext *cxt,
+    const Ray *rays, const double *times, int nrays,
+    Intersection *isects);
+FJ_API void SlShadeIntersection(const TraceContext *cxt,
+    const Ray *ray, const Intersection *isect,
+    Color4 *out_color, AovSample *out_aov);
 FJ_API int SlSurfaceRayIntersect(const TraceContext *cxt,
     const Vector *ray_orig, const Vector *ray_dir,
     double ray_tmin, double ray_tmax,
@@ -109,15 +168,32 @@ FJ_API int SlIlluminance(const TraceContext *cxt, const LightSample *sample,
     const SurfaceInput *in, LightOutput *out);
 
 FJ_API int SlGetLightCount(const SurfaceInput *in);
-FJ_API int SlGetLightSampleCount(const SurfaceInput *in);
-FJ_API LightSample *SlNewLightSamples(const SurfaceInput *in);
-FJ_API void SlFreeLightSamples(LightSample * samples);
+// when the lights have more samples than the budget of the context,
+// lights are chosen by their estimated contribution and the samples
+// are weighted to make up for the ones not taken. the number of
+// samples taken is returned to nsamples
+FJ_API LightSample *SlNewLightSamples(const TraceContext *cxt,
+    const SurfaceInput *in, int *nsamples);
+FJ_API void SlFreeLightSamples(const TraceContext *cxt, LightSample *samples);
+
+// irradiance caching functions. shaders look up a result computed
+// within the spacing around the shading point before computing it and
+// store the one computed. records are shared only by the same shader
+// passed as self. a lookup returns 1 when found
+FJ_API int SlLookupIrradiance(const TraceContext *cxt,
+    const SurfaceInput *in, const void *self, double spacing,
+    Color *irradiance);
+FJ_API void SlStoreIrradiance(const TraceContext *cxt,
+    const SurfaceInput *in, const void *self, double spacing,
+    const Color *irradiance);
 
 // texture functions
+// differences of the bump map are taken over the larger of a texel
+// and the footprint so that distant bumps do not alias
 FJ_API void SlBumpMapping(const Texture *bump_map,
     const Vector *dPdu, const Vector *dPdv,
-    const TexCoord *texcoord, double amplitude,
-    const Vector *N, Vector *N_bump);
+    const TexCoord *texcoord, const TexCoord *uv_footprint,
+    double amplitude, const Vector *N, Vector *N_bump);
 
 } // namespace xxx
 
@@ -9,11 +9,32 @@
 #include "fj_color.h"
 
 #include <cstddef>
+#include <cassert>
 
 namespace fj {
 
 static const Color4 NO_TEXTURE_COLOR(1, .63, .63, 1);
 
+class GridLookup {
+public:
+  GridLookup() :
+      cache_list(NULL), filename(NULL), xres(0), yres(0),
+      column_begins(), row_begins(), colors(NULL) {}
+  ~GridLookup() {}
+
+  std::vector<TextureCache> *cache_list;
+  const std::string *filename;
+  int xres, yres;
+  // first grid column and row of each tile column and tile row
+  std::vector<int> column_begins;
+  std::vector<int> row_begins;
+  std::vector<Color4> *colors;
+};
+
+static ThreadStatus lookup_grid_tile_row(void *data, const ThreadContext *context);
+static void grid_to_uv(int xres, int yres, int x, int y, TexCoord *uv);
+static void find_grid_begins(int grid_res, int ntiles, std::vector<int> *begins);
+
 TextureCache::TextureCache() :
   fb_(),
   mip_(),
@@ -93,6 +114,22 @@ int TextureCache::GetTextureHeight() const
     return mip_.GetHeight();
 }
 
+int TextureCache::GetTileCountX() const
+{
+  if (!mip_.IsOpen())
+    return 0;
+  else
+    return mip_.GetTileCountX();
+}
+
+int TextureCache::GetTileCountY() const
+{
+  if (!mip_.IsOpen())
+    return 0;
+  else
+    return mip_.GetTileCountY();
+}
+
 bool TextureCache::IsOpen() const
 {
   return is_open_;
@@ -120,6 +157,35 @@ Color4 Texture::Lookup(float u, float v) const
   return this_cache.LookupTexture(u, v);
 }
 
+int Texture::LookupGrid(int xres, int yres, std::vector<Color4> *colors) const
+{
+  if (xres < 1 || yres < 1 || !cache_list_[0].IsOpen()) {
+    return -1;
+  }
+
+  const int xntiles = cache_list_[0].GetTileCountX();
+  const int yntiles = cache_list_[0].GetTileCountY();
+  if (xntiles < 1 || yntiles < 1) {
+    return -1;
+  }
+
+  GridLookup grid;
+  grid.cache_list = const_cast<std::vector<TextureCache> *>(&cache_list_);
+  grid.filename = &filename_;
+  grid.xres = xres;
+  grid.yres = yres;
+  grid.colors = colors;
+  find_grid_begins(xres, xntiles, &grid.column_begins);
+  find_grid_begins(yres, yntiles, &grid.row_begins);
+
+  colors->resize(xres * yres);
+
+  const int thread_count = cache_list_.size();
+  MtRunThreadLoop(&grid, lookup_grid_tile_row, thread_count, 0, yntiles);
+
+  return 0;
+}
+
 int Texture::LoadFile(const std::string &filename)
 {
   if (filename_ == "") {
@@ -132,6 +198,11 @@ int Texture::LoadFile(const std::string &filename)
   return cache_list_[0].OpenMipmap(filename_);
 }
 
+const std::string &Texture::GetFilename() const
+{
+  return filename_;
+}
+
 int Texture::GetWidth() const
 {
   if (!cache_list_[0].IsOpen()) {
@@ -148,4 +219,57 @@ int Texture::GetHeight() const
   return cache_list_[0].GetTextureHeight();
 }
 
+static ThreadStatus lookup_grid_tile_row(void *data, const ThreadContext *context)
+{
+  GridLookup *grid = reinterpret_cast<GridLookup *>(data);
+  const int ytile = context->iteration_id;
+  const int ybegin = grid->row_begins[ytile];
+  const int yend = grid->row_begins[ytile + 1];
+  const int xntiles = grid->column_begins.size() - 1;
+
+  assert(context->thread_id < static_cast<int>(grid->cache_list->size()));
+  TextureCache &cache = (*grid->cache_list)[context->thread_id];
+  if (!cache.IsOpen()) {
+    cache.OpenMipmap(*grid->filename);
+  }
+
+  // all lookups in a tile are done before moving to the next one
+  for (int xtile = 0; xtile < xntiles; xtile++) {
+    const int xbegin = grid->column_begins[xtile];
+    const int xend = grid->column_begins[xtile + 1];
+
+    for (int y = ybegin; y < yend; y++) {
+      for (int x = xbegin; x < xend; x++) {
+        TexCoord uv;
+        grid_to_uv(grid->xres, grid->yres, x, y, &uv);
+        (*grid->colors)[y * grid->xres + x] = cache.LookupTexture(uv.u, uv.v);
+      }
+    }
+  }
+
+  return THREAD_LOOP_CONTINUE;
+}
+
+static void grid_to_uv(int xres, int yres, int x, int y, TexCoord *uv)
+{
+  uv->u = (.5 + x) / xres;
+  uv->v = 1. - ((.5 + y) / yres);
+}
+
+static void find_grid_begins(int grid_res, int ntiles, std::vector<int> *begins)
+{
+  // pixel centers of the grid go through tiles in increasing order.
+  // a pixel put on the wrong side of a tile border costs only another
+  // tile read
+  begins->resize(ntiles + 1);
+  int i = 0;
+  for (int tile = 0; tile < ntiles; tile++) {
+    while (i < grid_res && (.5 + i) / grid_res * ntiles < tile) {
+      i++;
+    }
+    (*begins)[tile] = i;
+  }
+  (*begins)[ntiles] = grid_res;
+}
+
 } // namespace xxx
@@ -26,6 +26,8 @@ public:
 
   int GetTextureWidth() const;
   int GetTextureHeight() const;
+  int GetTileCountX() const;
+  int GetTileCountY() const;
   bool IsOpen() const;
 
 private:
@@ -46,8 +48,14 @@ public:
   // (r, g, b, 1) will be returned when texture is rgb.
   // (r, g, b, a) will be returned when texture is rgba.
   Color4 Lookup(float u, float v) const;
+  // Looks up values at the pixel centers of an xres x yres grid in the
+  // same way as Lookup(). pixel (x, y) is at u = (x + .5) / xres and
+  // v = 1 - (y + .5) / yres. rows of tiles are read in parallel and
+  // each thread reads a tile only once.
+  int LookupGrid(int xres, int yres, std::vector<Color4> *colors) const;
   int LoadFile(const std::string &filename);
 
+  const std::string &GetFilename() const;
   int GetWidth() const;
   int GetHeight() const;
 
@@ -5,8 +5,10 @@
 #include "fj_rectangle.h"
 #include "fj_numeric.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cassert>
+#include <cmath>
 
 namespace fj {
 
@@ -19,7 +21,8 @@ Tiler::Tiler() :
   xres_(0),
   yres_(0),
   xtile_size_(0),
-  ytile_size_(0)
+  ytile_size_(0),
+  tile_order_(TILE_SCANLINE)
 {
 }
 
@@ -53,6 +56,88 @@ void Tiler::Divide(int xres, int yres, int xtile_size, int ytile_size)
   ytile_size_ = ytile_size;
 }
 
+void Tiler::SetTileOrder(int tile_order)
+{
+  switch (tile_order) {
+  case TILE_SCANLINE:
+  case TILE_SPIRAL:
+  case TILE_HILBERT:
+  case TILE_CENTER_OUT:
+    tile_order_ = tile_order;
+    break;
+  default:
+    assert(!"invalid tile order");
+    break;
+  }
+}
+
+class TileKey {
+public:
+  TileKey() : key(0), index(0) {}
+  ~TileKey() {}
+
+  bool operator<(const TileKey &other) const
+  {
+    return key < other.key || (key == other.key && index < other.index);
+  }
+
+  double key;
+  int index;
+};
+
+static int hilbert_index(int n, int x, int y)
+{
+  // n is a power of 2 covering x and y
+  int d = 0;
+  for (int s = n / 2; s > 0; s /= 2) {
+    const int rx = (x & s) > 0;
+    const int ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+
+    // rotate the quadrant
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      const int tmp = x;
+      x = y;
+      y = tmp;
+    }
+  }
+  return d;
+}
+
+static double tile_order_key(int order, int x, int y, int xntiles, int yntiles)
+{
+  // tile position from the center of tiles
+  const double dx = x - .5 * (xntiles - 1);
+  const double dy = y - .5 * (yntiles - 1);
+
+  switch (order) {
+  case TILE_SPIRAL:
+    {
+      // square rings from center, and clockwise in each ring
+      const double ring = floor(Max(Abs(dx), Abs(dy)) + .5);
+      const double angle = atan2(dy, dx) / (2 * PI) + .5;
+      return ring + Min(angle, .999);
+    }
+  case TILE_HILBERT:
+    {
+      int n = 1;
+      while (n < xntiles || n < yntiles) {
+        n *= 2;
+      }
+      return hilbert_index(n, x, y);
+    }
+  case TILE_CENTER_OUT:
+    return dx * dx + dy * dy;
+  case TILE_SCANLINE:
+  default:
+    return y * xntiles + x;
+  }
+}
+
 void Tiler::GenerateTiles(const Rectangle &region)
 {
   const int xres = xres_;
@@ -105,11 +190,77 @@ void Tiler::GenerateTiles(const Rectangle &region)
     }
   }
 
+  // sort tiles in the order. tiles are generated in scanline order
+  std::vector<TileKey> keys(total_ntiles);
+  for (int i = 0; i < total_ntiles; i++) {
+    keys[i].key = tile_order_key(tile_order_,
+        i % xntiles, i / xntiles, xntiles, yntiles);
+    keys[i].index = i;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<Tile> sorted_tiles(total_ntiles);
+  for (int i = 0; i < total_ntiles; i++) {
+    sorted_tiles[i] = tmp_tiles[keys[i].index];
+    sorted_tiles[i].id = i;
+  }
+
   // commit
   total_ntiles_ = total_ntiles;
   xntiles_ = xntiles;
   yntiles_ = yntiles;
-  tiles_.swap(tmp_tiles);
+  tiles_.swap(sorted_tiles);
+}
+
+static int split_tile(const Tile &tile, Tile *quarters)
+{
+  // tiles smaller than this are not worth the overhead of splitting
+  const int MIN_SPLIT_SIZE = 8;
+
+  const int xsize = tile.xmax - tile.xmin;
+  const int ysize = tile.ymax - tile.ymin;
+  const int xdiv = xsize >= 2 * MIN_SPLIT_SIZE ? 2 : 1;
+  const int ydiv = ysize >= 2 * MIN_SPLIT_SIZE ? 2 : 1;
+  int count = 0;
+
+  for (int y = 0; y < ydiv; y++) {
+    for (int x = 0; x < xdiv; x++) {
+      Tile &quarter = quarters[count++];
+      quarter.xmin = tile.xmin + x * xsize / xdiv;
+      quarter.ymin = tile.ymin + y * ysize / ydiv;
+      quarter.xmax = tile.xmin + (x + 1) * xsize / xdiv;
+      quarter.ymax = tile.ymin + (y + 1) * ysize / ydiv;
+    }
+  }
+
+  return count;
+}
+
+void Tiler::SplitTailTiles(int thread_count)
+{
+  if (thread_count < 2) {
+    return;
+  }
+
+  // the last tile each thread takes is split, then the last quarters are
+  for (int round = 0; round < 2; round++) {
+    const int ntiles = static_cast<int>(tiles_.size());
+    const int tail_begin = ntiles > thread_count ? ntiles - thread_count : 0;
+
+    std::vector<Tile> split_tiles(tiles_.begin(), tiles_.begin() + tail_begin);
+    for (int i = tail_begin; i < ntiles; i++) {
+      Tile quarters[4];
+      const int count = split_tile(tiles_[i], quarters);
+      split_tiles.insert(split_tiles.end(), quarters, quarters + count);
+    }
+
+    for (std::size_t i = 0; i < split_tiles.size(); i++) {
+      split_tiles[i].id = i;
+    }
+    tiles_.swap(split_tiles);
+  }
+
+  total_ntiles_ = tiles_.size();
 }
 
 } // namespace xxx
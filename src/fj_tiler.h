@@ -10,6 +10,13 @@ namespace fj {
 
 class Rectangle;
 
+enum TileOrder {
+  TILE_SCANLINE = 0,
+  TILE_SPIRAL,
+  TILE_HILBERT,
+  TILE_CENTER_OUT
+};
+
 class Tile {
 public:
   Tile() : id(0), xmin(0), ymin(0), xmax(0), ymax(0) {}
@@ -27,7 +34,13 @@ public:
   const Tile *GetTile(int index) const;
 
   void Divide(int xres, int yres, int xtile_size, int ytile_size);
+  // hilbert order keeps the next tile close to the previous ones.
+  // spiral and center out orders render the center of frame first
+  void SetTileOrder(int tile_order);
   void GenerateTiles(const Rectangle &region);
+  // Splits the last tiles in the order into quarters twice so that
+  // the threads finish at nearly the same time at the end of frame.
+  void SplitTailTiles(int thread_count);
 
 public:
   int total_ntiles_;
@@ -39,6 +52,7 @@ public:
   int yres_;
   int xtile_size_;
   int ytile_size_;
+  int tile_order_;
 };
 
 } // namespace xxx
@@ -2,20 +2,18 @@
 // See LICENSE and README
 
 #include "fj_timer.h"
+#include "fj_os.h"
 
 namespace fj {
 
 void Timer::Start()
 {
-  time(&start_time_);
+  start_time_ = OsGetTime();
 }
 
 Elapse Timer::GetElapse() const
 {
-  time_t end_time;
-  time(&end_time);
-
-  const double total_seconds = difftime(end_time, start_time_);
+  const double total_seconds = GetElapsedSeconds();
   Elapse elapse;
   elapse.sec = 1;
 
@@ -28,4 +26,9 @@ Elapse Timer::GetElapse() const
   return elapse;
 }
 
+double Timer::GetElapsedSeconds() const
+{
+  return OsGetTime() - start_time_;
+}
+
 } // namespace xxx
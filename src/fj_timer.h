@@ -5,7 +5,6 @@
 #define FJ_TIMER_H
 
 #include "fj_compatibility.h"
-#include <ctime>
 
 namespace fj {
 
@@ -27,9 +26,10 @@ public:
 
   void Start();
   Elapse GetElapse() const;
+  double GetElapsedSeconds() const;
 
 private:
-  time_t start_time_;
+  double start_time_;
 };
 
 } // namespace xxx
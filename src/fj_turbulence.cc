@@ -68,4 +68,51 @@ Vector Turbulence::Evaluate3d(const Vector &position) const
   return amplitude_ * noise;
 }
 
+void Turbulence::EvaluateBatch(const float *x, const float *y, const float *z,
+    float *noise, int count) const
+{
+  const int W = NOISE_BATCH_WIDTH;
+  float px[W], py[W], pz[W];
+
+  for (int i = 0; i < count; i += W) {
+    const int n = count - i < W ? count - i : W;
+
+    for (int j = 0; j < n; j++) {
+      px[j] = x[i + j] * frequency_.x + offset_.x;
+      py[j] = y[i + j] * frequency_.y + offset_.y;
+      pz[j] = z[i + j] * frequency_.z + offset_.z;
+    }
+    PerlinNoiseBatch(px, py, pz, lacunarity_, gain_, octaves_, noise + i, n);
+
+    for (int j = 0; j < n; j++) {
+      noise[i + j] *= amplitude_.x;
+    }
+  }
+}
+
+void Turbulence::Evaluate3dBatch(const float *x, const float *y, const float *z,
+    float *noise_x, float *noise_y, float *noise_z, int count) const
+{
+  const int W = NOISE_BATCH_WIDTH;
+  float px[W], py[W], pz[W];
+
+  for (int i = 0; i < count; i += W) {
+    const int n = count - i < W ? count - i : W;
+
+    for (int j = 0; j < n; j++) {
+      px[j] = x[i + j] * frequency_.x + offset_.x;
+      py[j] = y[i + j] * frequency_.y + offset_.y;
+      pz[j] = z[i + j] * frequency_.z + offset_.z;
+    }
+    PerlinNoise3dBatch(px, py, pz, lacunarity_, gain_, octaves_,
+        noise_x + i, noise_y + i, noise_z + i, n);
+
+    for (int j = 0; j < n; j++) {
+      noise_x[i + j] *= amplitude_.x;
+      noise_y[i + j] *= amplitude_.y;
+      noise_z[i + j] *= amplitude_.z;
+    }
+  }
+}
+
 } // namespace xxx
@@ -25,6 +25,12 @@ public:
   double Evaluate(const Vector &position) const;
   Vector Evaluate3d(const Vector &position) const;
 
+  // Evaluates count points given in SoA layout at once.
+  void EvaluateBatch(const float *x, const float *y, const float *z,
+      float *noise, int count) const;
+  void Evaluate3dBatch(const float *x, const float *y, const float *z,
+      float *noise_x, float *noise_y, float *noise_z, int count) const;
+
 private:
   Vector amplitude_;
   Vector frequency_;
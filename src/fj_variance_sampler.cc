@@ -0,0 +1,281 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "fj_variance_sampler.h"
+#include "fj_rectangle.h"
+#include "fj_numeric.h"
+#include "fj_color.h"
+#include "fj_low_discrepancy.h"
+#include <cmath>
+
+namespace fj {
+
+// errors are relative to the pixel luminance, but dark pixels
+// are not refined beyond this luminance
+static const Real MIN_RELATIVE_LUMINANCE = .1;
+
+VarianceSampler::VarianceSampler() :
+  samples_(),
+  sample_pixel_(),
+  pixel_stats_(),
+
+  region_(),
+  nsubstrata_(1),
+
+  batch_start_(0),
+  current_index_(0)
+{
+}
+
+VarianceSampler::~VarianceSampler()
+{
+}
+
+void VarianceSampler::update_sample_counts()
+{
+  // strata are split into enough substrata for one per batch
+  const Int2 rate = GetPixelSamples();
+  const int max_batches = GetMaxPixelSamples() / (rate[0] * rate[1]);
+
+  nsubstrata_ = 1;
+  while (nsubstrata_ * nsubstrata_ < max_batches) {
+    nsubstrata_ *= 2;
+  }
+}
+
+int VarianceSampler::generate_samples(const Rectangle &region)
+{
+  const Int2 size = region.Size();
+  const int npixels = size[0] * size[1];
+
+  region_ = region;
+  samples_.clear();
+  sample_pixel_.clear();
+  pixel_stats_.clear();
+  pixel_stats_.resize(npixels);
+
+  const uint32_t seed = LdHash(GetSeed());
+
+  // shifting substrata randomly per pixel keeps the samples of
+  // any number of batches uniformly distributed over the pixel.
+  // without jitter, the first batch is on the centers of strata
+  const Real jitter = GetJitter();
+  const Real center = .5 - .5 / nsubstrata_;
+  for (int i = 0; i < npixels; i++) {
+    // the pattern is unique to the pixel, not to the region
+    const int xpixel = region.min[0] + i % size[0];
+    const int ypixel = region.min[1] + i / size[0];
+
+    PixelStat &stat = pixel_stats_[i];
+    stat.pattern = LdHashCombine(LdHashCombine(seed, xpixel), ypixel);
+    stat.shift[0] = center;
+    stat.shift[1] = center;
+
+    if (IsJittered()) {
+      stat.shift[0] += jitter * (LdRandom01(0, stat.pattern) - .5);
+      stat.shift[1] += jitter * (LdRandom01(1, stat.pattern) - .5);
+    }
+  }
+
+  // the first batch goes to every pixel
+  for (int i = 0; i < npixels; i++) {
+    add_pixel_samples(i, 0);
+  }
+  attach_aovs(samples_);
+
+  batch_start_ = 0;
+  current_index_ = 0;
+  return 0;
+}
+
+Sample *VarianceSampler::get_next_sample()
+{
+  Sample *sample = NULL;
+  return get_next_samples(&sample, 1) == 1 ? sample : NULL;
+}
+
+int VarianceSampler::get_next_samples(Sample **samples, int max_samples)
+{
+  const int nsamples = static_cast<int>(samples_.size());
+
+  // every sample in the batch has been traced when the next one is asked.
+  // samples in the same batch can be traced together
+  if (current_index_ == nsamples) {
+    update_pixel_stats(batch_start_, nsamples);
+    batch_start_ = nsamples;
+
+    const Int2 rate = GetPixelSamples();
+    const int batch_size = rate[0] * rate[1];
+
+    for (std::size_t i = 0; i < pixel_stats_.size(); i++) {
+      const PixelStat &stat = pixel_stats_[i];
+      if (need_more_samples(stat)) {
+        add_pixel_samples(i, stat.count / batch_size);
+      }
+    }
+    attach_aovs(samples_);
+
+    if (current_index_ == static_cast<int>(samples_.size())) {
+      normalize_sample_weights();
+      return 0;
+    }
+  }
+
+  // samples are referenced until the next call adds another batch
+  int count = 0;
+  while (count < max_samples && current_index_ < static_cast<int>(samples_.size())) {
+    samples[count++] = &samples_[current_index_++];
+  }
+  return count;
+}
+
+void VarianceSampler::get_owned_samples(std::vector<const Sample *> &samples) const
+{
+  // samples are only in the region
+  samples.reserve(samples_.size());
+  for (std::size_t i = 0; i < samples_.size(); i++) {
+    samples.push_back(&samples_[i]);
+  }
+}
+
+static Real wrap01(Real x)
+{
+  return x - Floor(x);
+}
+
+static Int2 substratum_of_batch(int batch_id, int nsubstrata)
+{
+  // reversing the bits of the interleaved index visits substrata
+  // so that every prefix of the batches is spread over the stratum
+  int nbits = 0;
+  while ((1 << nbits) < nsubstrata) {
+    nbits++;
+  }
+
+  Int2 sub(0, 0);
+  for (int i = 0; i < 2 * nbits; i++) {
+    if (batch_id & (1 << i)) {
+      const int bit = 2 * nbits - 1 - i;
+      sub[bit % 2] |= 1 << (bit / 2);
+    }
+  }
+  return sub;
+}
+
+void VarianceSampler::add_pixel_samples(int pixel_id, int batch_id)
+{
+  const Int2 rate = GetPixelSamples();
+  const Int2 res  = GetResolution();
+  const Real jitter = GetJitter();
+  const Vector2 sample_time_range = GetSampleTimeRange();
+
+  const int width = region_.Size()[0];
+  const int xpixel = region_.min[0] + pixel_id % width;
+  const int ypixel = region_.min[1] + pixel_id / width;
+
+  // uv delta (screen space uv)
+  const Real udelta = 1./(rate[0] * res[0]);
+  const Real vdelta = 1./(rate[1] * res[1]);
+
+  // each batch takes a different substratum in every stratum
+  const Int2 sub = substratum_of_batch(batch_id, nsubstrata_);
+  const PixelStat &stat = pixel_stats_[pixel_id];
+  const Vector2 &shift = stat.shift;
+  const Real sub_size = 1./nsubstrata_;
+
+  // hashed patterns for jitter and time of each sample in the pixel
+  const uint32_t u_pattern = LdHashCombine(stat.pattern, 1);
+  const uint32_t v_pattern = LdHashCombine(stat.pattern, 2);
+  const uint32_t time_pattern = LdHashCombine(stat.pattern, 3);
+
+  // one sample in each stratum of the pixel
+  for (int y = 0; y < rate[1]; y++) {
+    for (int x = 0; x < rate[0]; x++) {
+      const int pixel_sample_id = batch_id * rate[0] * rate[1] + y * rate[0] + x;
+      Real u_jitter = 0;
+      Real v_jitter = 0;
+
+      if (IsJittered()) {
+        u_jitter = jitter * (LdRandom01(pixel_sample_id, u_pattern) - .5);
+        v_jitter = jitter * (LdRandom01(pixel_sample_id, v_pattern) - .5);
+      }
+
+      // position in the stratum wraps around with the shift
+      const Real u = wrap01((sub[0] + .5 + u_jitter) * sub_size + shift[0]);
+      const Real v = wrap01((sub[1] + .5 + v_jitter) * sub_size + shift[1]);
+
+      Sample sample;
+      sample.uv.x =     (u + x + xpixel * rate[0]) * udelta;
+      sample.uv.y = 1 - (v + y + ypixel * rate[1]) * vdelta;
+
+      if (IsSamplingTime()) {
+        // times of the samples so far are stratified for any count
+        const Real rnd = LdVanDerCorput(pixel_sample_id, time_pattern);
+        sample.time = Fit(rnd, 0, 1, sample_time_range[0], sample_time_range[1]);
+      } else {
+        sample.time = 0;
+      }
+
+      samples_.push_back(sample);
+      sample_pixel_.push_back(pixel_id);
+    }
+  }
+}
+
+void VarianceSampler::update_pixel_stats(int begin, int end)
+{
+  for (int i = begin; i < end; i++) {
+    const Vector4 &data = samples_[i].data;
+    const Real lum = Luminance(Color(data[0], data[1], data[2]));
+    PixelStat &stat = pixel_stats_[sample_pixel_[i]];
+
+    stat.count++;
+    stat.sum  += lum;
+    stat.sum2 += lum * lum;
+    stat.alpha_sum  += data[3];
+    stat.alpha_sum2 += data[3] * data[3];
+  }
+}
+
+void VarianceSampler::normalize_sample_weights()
+{
+  // every pixel contributes as much as a pixel with a single batch
+  // so that refined pixels do not pull their neighbors in filtering
+  const Int2 rate = GetPixelSamples();
+  const Real batch_size = rate[0] * rate[1];
+
+  for (std::size_t i = 0; i < samples_.size(); i++) {
+    const PixelStat &stat = pixel_stats_[sample_pixel_[i]];
+    samples_[i].weight = batch_size / stat.count;
+  }
+}
+
+static Real standard_error(int count, Real sum, Real sum2)
+{
+  // unbiased sample variance over the count
+  const Real variance = (sum2 - sum * sum / count) / (count - 1);
+  return sqrt(Max(variance, 0.) / count);
+}
+
+bool VarianceSampler::need_more_samples(const PixelStat &stat) const
+{
+  const Int2 rate = GetPixelSamples();
+  const int batch_size = rate[0] * rate[1];
+
+  if (stat.count + batch_size > GetMaxPixelSamples()) {
+    return false;
+  }
+  if (stat.count < 2 * batch_size) {
+    return true;
+  }
+
+  const Real threshold = GetVarianceThreshold();
+  const Real mean = stat.sum / stat.count;
+  const Real error = standard_error(stat.count, stat.sum, stat.sum2);
+  const Real alpha_error = standard_error(stat.count, stat.alpha_sum, stat.alpha_sum2);
+
+  return error > threshold * Max(mean, MIN_RELATIVE_LUMINANCE) ||
+      alpha_error > threshold;
+}
+
+} // namespace xxx
@@ -0,0 +1,60 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#ifndef FJ_VARIANCE_SAMPLER_H
+#define FJ_VARIANCE_SAMPLER_H
+
+#include "fj_sampler.h"
+#include "fj_compatibility.h"
+
+namespace fj {
+
+// Traces pixel samples in batches of stratified samples and adds
+// another batch to the pixels whose standard error of the mean is
+// still beyond the variance threshold, up to the max pixel samples.
+// Every pixel gets at least two batches before its error is tested.
+class VarianceSampler : public Sampler {
+public:
+  VarianceSampler();
+  virtual ~VarianceSampler();
+
+private:
+  class PixelStat {
+  public:
+    PixelStat() : count(0), sum(0), sum2(0), alpha_sum(0), alpha_sum2(0),
+        shift(), pattern(0) {}
+    ~PixelStat() {}
+
+  public:
+    int count;
+    Real sum, sum2;             // luminance
+    Real alpha_sum, alpha_sum2; // alpha
+    Vector2 shift;              // toroidal shift of substrata
+    uint32_t pattern;           // hashed from the pixel position
+  };
+
+  virtual void update_sample_counts();
+  virtual int generate_samples(const Rectangle &region);
+  virtual Sample *get_next_sample();
+  virtual int get_next_samples(Sample **samples, int max_samples);
+  virtual void get_owned_samples(std::vector<const Sample *> &samples) const;
+
+  void add_pixel_samples(int pixel_id, int batch_id);
+  void update_pixel_stats(int begin, int end);
+  bool need_more_samples(const PixelStat &stat) const;
+  void normalize_sample_weights();
+
+  std::vector<Sample> samples_;
+  std::vector<int> sample_pixel_;
+  std::vector<PixelStat> pixel_stats_;
+
+  Rectangle region_;
+  int nsubstrata_;
+
+  int batch_start_;
+  int current_index_;
+};
+
+} // namespace xxx
+
+#endif // FJ_XXX_H
@@ -2,11 +2,31 @@
 // See LICENSE and README
 
 #include "fj_volume.h"
+#include "fj_file_io.h"
 #include "fj_numeric.h"
+#include <cstring>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
 
 namespace fj {
 
-VoxelBuffer::VoxelBuffer() : data_(), res_()
+static uint16_t float_to_half(float value);
+static float half_to_float(uint16_t value);
+static void bspline_weights(float t, float w[4]);
+
+// headers with more voxels than this are taken as broken rather than
+// allocated. 2^32 voxels are 16GB in float
+static const int64_t MAX_VOXEL_COUNT = (int64_t) 1 << 32;
+
+VoxelBuffer::VoxelBuffer() :
+  data_(),
+  half_data_(),
+  byte_data_(),
+  block_offset_(),
+  block_scale_(),
+  res_(),
+  format_(VOXEL_FLOAT)
 {
 }
 
@@ -16,7 +36,14 @@ VoxelBuffer::~VoxelBuffer()
 
 void VoxelBuffer::Resize(int xres, int yres, int zres)
 {
-  data_.resize(xres * yres * zres, 0);
+  // resized buffer always starts as float
+  half_data_.clear();
+  byte_data_.clear();
+  block_offset_.clear();
+  block_scale_.clear();
+  format_ = VOXEL_FLOAT;
+
+  data_.resize((int64_t) xres * yres * zres, 0);
   res_ = Resolution(xres, yres, zres);
 }
 
@@ -27,7 +54,95 @@ const Resolution &VoxelBuffer::GetResolution() const
 
 bool VoxelBuffer::IsEmpty() const
 {
-  return data_.empty();
+  return res_.x == 0 || res_.y == 0 || res_.z == 0;
+}
+
+void VoxelBuffer::SetFormat(int format)
+{
+  if (format == format_ || IsEmpty()) {
+    format_ = format;
+    return;
+  }
+
+  // decode into float first
+  if (format_ != VOXEL_FLOAT) {
+    std::vector<float> decoded((int64_t) res_.x * res_.y * res_.z);
+    for (int z = 0; z < res_.z; z++) {
+      for (int y = 0; y < res_.y; y++) {
+        for (int x = 0; x < res_.x; x++) {
+          const int64_t index = voxel_index(x, y, z);
+          decoded[index] = decode(index, x, y, z);
+        }
+      }
+    }
+    data_.swap(decoded);
+    std::vector<uint16_t>().swap(half_data_);
+    std::vector<uint8_t>().swap(byte_data_);
+    std::vector<float>().swap(block_offset_);
+    std::vector<float>().swap(block_scale_);
+    format_ = VOXEL_FLOAT;
+  }
+
+  if (format == VOXEL_HALF) {
+    half_data_.resize(data_.size());
+    for (size_t i = 0; i < data_.size(); i++) {
+      half_data_[i] = float_to_half(data_[i]);
+    }
+  }
+  else if (format == VOXEL_BYTE) {
+    int xblocks, yblocks, zblocks;
+    compute_block_count(&xblocks, &yblocks, &zblocks);
+    block_offset_.resize(xblocks * yblocks * zblocks, FLT_MAX);
+    block_scale_.resize(xblocks * yblocks * zblocks, -FLT_MAX);
+    byte_data_.resize(data_.size());
+
+    // find value range of each block. block_scale_ holds max for now
+    for (int z = 0; z < res_.z; z++) {
+      for (int y = 0; y < res_.y; y++) {
+        for (int x = 0; x < res_.x; x++) {
+          const float value = data_[voxel_index(x, y, z)];
+          const int64_t b = block_index(x, y, z);
+          block_offset_[b] = Min(block_offset_[b], value);
+          block_scale_[b]  = Max(block_scale_[b], value);
+        }
+      }
+    }
+    for (size_t b = 0; b < block_offset_.size(); b++) {
+      block_scale_[b] = (block_scale_[b] - block_offset_[b]) / 255.f;
+    }
+
+    for (int z = 0; z < res_.z; z++) {
+      for (int y = 0; y < res_.y; y++) {
+        for (int x = 0; x < res_.x; x++) {
+          const int64_t index = voxel_index(x, y, z);
+          const int64_t b = block_index(x, y, z);
+          const float scale = block_scale_[b];
+          const float q = scale > 0 ? (data_[index] - block_offset_[b]) / scale : 0;
+          byte_data_[index] = (uint8_t) Clamp(q + .5f, 0, 255);
+        }
+      }
+    }
+  }
+
+  if (format != VOXEL_FLOAT) {
+    std::vector<float>().swap(data_);
+  }
+  format_ = format;
+}
+
+int VoxelBuffer::GetFormat() const
+{
+  return format_;
+}
+
+size_t VoxelBuffer::GetMemorySize() const
+{
+  return
+      sizeof(float) * data_.size() +
+      sizeof(uint16_t) * half_data_.size() +
+      sizeof(uint8_t) * byte_data_.size() +
+      sizeof(float) * block_offset_.size() +
+      sizeof(float) * block_scale_.size();
 }
 
 void VoxelBuffer::SetValue(int x, int y, int z, float value)
@@ -39,7 +154,12 @@ void VoxelBuffer::SetValue(int x, int y, int z, float value)
   if (z < 0 || res_.z <= z)
     return;
 
-  const int64_t index = (z * res_.x * res_.y) + (y * res_.x) + x;
+  assert(format_ == VOXEL_FLOAT);
+  if (format_ != VOXEL_FLOAT) {
+    return;
+  }
+
+  const int64_t index = voxel_index(x, y, z);
   data_[index] = value;
 }
 
@@ -52,17 +172,276 @@ float VoxelBuffer::GetValue(int x, int y, int z) const
   if (z < 0 || res_.z <= z)
     return 0;
 
-  const int64_t index = (z * res_.x * res_.y) + (y * res_.x) + x;
-  return data_[index];
+  const int64_t index = voxel_index(x, y, z);
+  if (format_ == VOXEL_FLOAT) {
+    return data_[index];
+  } else {
+    return decode(index, x, y, z);
+  }
+}
+
+int VoxelBuffer::Write(FILE *file) const
+{
+  const int32_t header[4] = {format_, res_.x, res_.y, res_.z};
+  int err = 0;
+
+  err |= FjFile_WriteInt32(file, header, 4);
+
+  switch (format_) {
+  case VOXEL_HALF:
+    err |= FjFile_WriteInt16(file,
+        (const int16_t *) &half_data_[0], half_data_.size());
+    break;
+  case VOXEL_BYTE:
+    err |= FjFile_WriteFloat(file, &block_offset_[0], block_offset_.size());
+    err |= FjFile_WriteFloat(file, &block_scale_[0], block_scale_.size());
+    err |= FjFile_WriteInt8(file,
+        (const int8_t *) &byte_data_[0], byte_data_.size());
+    break;
+  default:
+    err |= FjFile_WriteFloat(file, &data_[0], data_.size());
+    break;
+  }
+
+  return err ? -1 : 0;
+}
+
+int VoxelBuffer::Read(FILE *file)
+{
+  int32_t header[4] = {0, 0, 0, 0};
+  int err = 0;
+
+  err = FjFile_ReadInt32(file, header, 4);
+  if (err) {
+    return -1;
+  }
+  if (header[0] < VOXEL_FLOAT || header[0] > VOXEL_BYTE) {
+    return -1;
+  }
+  if (header[1] < 1 || header[2] < 1 || header[3] < 1) {
+    return -1;
+  }
+  if ((int64_t) header[1] * header[2] > MAX_VOXEL_COUNT / header[3]) {
+    return -1;
+  }
+
+  Resize(header[1], header[2], header[3]);
+  const size_t nvoxels = data_.size();
+
+  switch (header[0]) {
+  case VOXEL_HALF:
+    std::vector<float>().swap(data_);
+    half_data_.resize(nvoxels);
+    err |= FjFile_ReadInt16(file, (int16_t *) &half_data_[0], nvoxels);
+    break;
+  case VOXEL_BYTE: {
+    int xblocks, yblocks, zblocks;
+    compute_block_count(&xblocks, &yblocks, &zblocks);
+    std::vector<float>().swap(data_);
+    block_offset_.resize(xblocks * yblocks * zblocks);
+    block_scale_.resize(xblocks * yblocks * zblocks);
+    byte_data_.resize(nvoxels);
+    err |= FjFile_ReadFloat(file, &block_offset_[0], block_offset_.size());
+    err |= FjFile_ReadFloat(file, &block_scale_[0], block_scale_.size());
+    err |= FjFile_ReadInt8(file, (int8_t *) &byte_data_[0], nvoxels);
+    }
+    break;
+  default:
+    err |= FjFile_ReadFloat(file, &data_[0], nvoxels);
+    break;
+  }
+  format_ = header[0];
+
+  if (err) {
+    Resize(0, 0, 0);
+    return -1;
+  }
+  return 0;
 }
 
-static float trilinear_buffer_value(const VoxelBuffer &buffer, const Vector &P);
-static float nearest_buffer_value(const VoxelBuffer &buffer, const Vector &P);
+int64_t VoxelBuffer::voxel_index(int x, int y, int z) const
+{
+  return ((int64_t) z * res_.x * res_.y) + ((int64_t) y * res_.x) + x;
+}
+
+int64_t VoxelBuffer::block_index(int x, int y, int z) const
+{
+  int xblocks, yblocks, zblocks;
+  compute_block_count(&xblocks, &yblocks, &zblocks);
+
+  return
+      ((int64_t) (z / VOXEL_BLOCK_SIZE) * xblocks * yblocks) +
+      ((int64_t) (y / VOXEL_BLOCK_SIZE) * xblocks) +
+      (x / VOXEL_BLOCK_SIZE);
+}
+
+float VoxelBuffer::decode(int64_t index, int x, int y, int z) const
+{
+  switch (format_) {
+  case VOXEL_HALF:
+    return half_to_float(half_data_[index]);
+  case VOXEL_BYTE: {
+    const int64_t b = block_index(x, y, z);
+    return block_offset_[b] + byte_data_[index] * block_scale_[b];
+    }
+  default:
+    return data_[index];
+  }
+}
+
+void VoxelBuffer::compute_block_count(int *xblocks, int *yblocks, int *zblocks) const
+{
+  *xblocks = (res_.x + VOXEL_BLOCK_SIZE - 1) / VOXEL_BLOCK_SIZE;
+  *yblocks = (res_.y + VOXEL_BLOCK_SIZE - 1) / VOXEL_BLOCK_SIZE;
+  *zblocks = (res_.z + VOXEL_BLOCK_SIZE - 1) / VOXEL_BLOCK_SIZE;
+}
+
+float VoxelBuffer::fetch(int64_t index, int x, int y, int z) const
+{
+  if (format_ == VOXEL_FLOAT) {
+    return data_[index];
+  } else {
+    return decode(index, x, y, z);
+  }
+}
+
+bool VoxelBuffer::contains(int xmin, int ymin, int zmin,
+    int xmax, int ymax, int zmax) const
+{
+  return
+      xmin >= 0 && ymin >= 0 && zmin >= 0 &&
+      xmax < res_.x && ymax < res_.y && zmax < res_.z;
+}
+
+float VoxelBuffer::SampleNearest(const Vector &P) const
+{
+  const int x = Clamp((int) P.x, 0, res_.x - 1);
+  const int y = Clamp((int) P.y, 0, res_.y - 1);
+  const int z = Clamp((int) P.z, 0, res_.z - 1);
+
+  return fetch(voxel_index(x, y, z), x, y, z);
+}
+
+float VoxelBuffer::SampleTrilinear(const Vector &P) const
+{
+  // voxel centers are at half integers
+  const Real px = P.x - .5;
+  const Real py = P.y - .5;
+  const Real pz = P.z - .5;
+  const int x0 = (int) floor(px);
+  const int y0 = (int) floor(py);
+  const int z0 = (int) floor(pz);
+  const float fx = px - x0;
+  const float fy = py - y0;
+  const float fz = pz - z0;
+
+  float v[8];
+
+  if (contains(x0, y0, z0, x0 + 1, y0 + 1, z0 + 1)) {
+    // all 8 neighbors are inside. fetch them without bounds checks
+    const int64_t dy = res_.x;
+    const int64_t dz = (int64_t) res_.x * res_.y;
+    const int64_t i = voxel_index(x0, y0, z0);
+
+    if (format_ == VOXEL_FLOAT) {
+      const float *p = &data_[i];
+      v[0] = p[0];       v[1] = p[1];
+      v[2] = p[dy];      v[3] = p[dy + 1];
+      v[4] = p[dz];      v[5] = p[dz + 1];
+      v[6] = p[dz + dy]; v[7] = p[dz + dy + 1];
+    } else {
+      v[0] = decode(i,               x0,     y0,     z0);
+      v[1] = decode(i + 1,           x0 + 1, y0,     z0);
+      v[2] = decode(i + dy,          x0,     y0 + 1, z0);
+      v[3] = decode(i + dy + 1,      x0 + 1, y0 + 1, z0);
+      v[4] = decode(i + dz,          x0,     y0,     z0 + 1);
+      v[5] = decode(i + dz + 1,      x0 + 1, y0,     z0 + 1);
+      v[6] = decode(i + dz + dy,     x0,     y0 + 1, z0 + 1);
+      v[7] = decode(i + dz + dy + 1, x0 + 1, y0 + 1, z0 + 1);
+    }
+  } else {
+    v[0] = GetValue(x0,     y0,     z0);
+    v[1] = GetValue(x0 + 1, y0,     z0);
+    v[2] = GetValue(x0,     y0 + 1, z0);
+    v[3] = GetValue(x0 + 1, y0 + 1, z0);
+    v[4] = GetValue(x0,     y0,     z0 + 1);
+    v[5] = GetValue(x0 + 1, y0,     z0 + 1);
+    v[6] = GetValue(x0,     y0 + 1, z0 + 1);
+    v[7] = GetValue(x0 + 1, y0 + 1, z0 + 1);
+  }
+
+  const float x00 = v[0] + fx * (v[1] - v[0]);
+  const float x10 = v[2] + fx * (v[3] - v[2]);
+  const float x01 = v[4] + fx * (v[5] - v[4]);
+  const float x11 = v[6] + fx * (v[7] - v[6]);
+  const float y0v = x00 + fy * (x10 - x00);
+  const float y1v = x01 + fy * (x11 - x01);
+
+  return y0v + fz * (y1v - y0v);
+}
+
+// weights of uniform cubic B-spline for the 4 voxels around t in [0, 1)
+static void bspline_weights(float t, float w[4])
+{
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  const float s = 1 - t;
+
+  w[0] = s * s * s / 6;
+  w[1] = (3 * t3 - 6 * t2 + 4) / 6;
+  w[2] = (-3 * t3 + 3 * t2 + 3 * t + 1) / 6;
+  w[3] = t3 / 6;
+}
+
+float VoxelBuffer::SampleTricubic(const Vector &P) const
+{
+  const Real px = P.x - .5;
+  const Real py = P.y - .5;
+  const Real pz = P.z - .5;
+  const int x1 = (int) floor(px);
+  const int y1 = (int) floor(py);
+  const int z1 = (int) floor(pz);
+
+  float wx[4], wy[4], wz[4];
+  bspline_weights(px - x1, wx);
+  bspline_weights(py - y1, wy);
+  bspline_weights(pz - z1, wz);
+
+  const int x0 = x1 - 1;
+  const int y0 = y1 - 1;
+  const int z0 = z1 - 1;
+  const bool inside = contains(x0, y0, z0, x0 + 3, y0 + 3, z0 + 3);
+  float value = 0;
+
+  for (int k = 0; k < 4; k++) {
+    float plane = 0;
+    for (int j = 0; j < 4; j++) {
+      float row = 0;
+      if (inside) {
+        const int64_t i = voxel_index(x0, y0 + j, z0 + k);
+        for (int n = 0; n < 4; n++) {
+          row += wx[n] * fetch(i + n, x0 + n, y0 + j, z0 + k);
+        }
+      } else {
+        for (int n = 0; n < 4; n++) {
+          row += wx[n] * GetValue(x0 + n, y0 + j, z0 + k);
+        }
+      }
+      plane += wy[j] * row;
+    }
+    value += wz[k] * plane;
+  }
+
+  return value;
+}
 
 Volume::Volume() :
   buffer_(),
   bounds_(),
-  size_()
+  size_(),
+  voxel_format_(VOXEL_FLOAT),
+  filter_(VOLUME_FILTER_TRILINEAR),
+  shadow_filter_(VOLUME_FILTER_TRILINEAR)
 {
   compute_filter_size();
 }
@@ -136,6 +515,10 @@ void Volume::SetValue(int x, int y, int z, float value)
   if (buffer_.IsEmpty()) {
     return;
   }
+  // decodes the whole buffer. Compact() encodes it again
+  if (buffer_.GetFormat() != VOXEL_FLOAT) {
+    buffer_.SetFormat(VOXEL_FLOAT);
+  }
   buffer_.SetValue(x, y, z, value);
 }
 
@@ -144,7 +527,78 @@ float Volume::GetValue(int x, int y, int z) const
   return buffer_.GetValue(x, y, z);
 }
 
+void Volume::SetVoxelFormat(int format)
+{
+  if (format < VOXEL_FLOAT || format > VOXEL_BYTE) {
+    return;
+  }
+  voxel_format_ = format;
+  buffer_.SetFormat(voxel_format_);
+}
+
+int Volume::GetVoxelFormat() const
+{
+  return voxel_format_;
+}
+
+void Volume::Compact()
+{
+  buffer_.SetFormat(voxel_format_);
+}
+
+int Volume::WriteVoxels(FILE *file) const
+{
+  return buffer_.Write(file);
+}
+
+int Volume::ReadVoxels(FILE *file)
+{
+  const int err = buffer_.Read(file);
+
+  voxel_format_ = buffer_.GetFormat();
+  compute_filter_size();
+
+  return err;
+}
+
+void Volume::SetFilter(int filter)
+{
+  if (filter < VOLUME_FILTER_NEAREST || filter > VOLUME_FILTER_TRICUBIC) {
+    return;
+  }
+  filter_ = filter;
+}
+
+int Volume::GetFilter() const
+{
+  return filter_;
+}
+
+void Volume::SetShadowFilter(int filter)
+{
+  if (filter < VOLUME_FILTER_NEAREST || filter > VOLUME_FILTER_TRICUBIC) {
+    return;
+  }
+  shadow_filter_ = filter;
+}
+
+int Volume::GetShadowFilter() const
+{
+  return shadow_filter_;
+}
+
 bool Volume::GetSample(const Vector &point, VolumeSample *sample) const
+{
+  return sample_buffer(point, filter_, sample);
+}
+
+bool Volume::GetShadowSample(const Vector &point, VolumeSample *sample) const
+{
+  return sample_buffer(point, shadow_filter_, sample);
+}
+
+bool Volume::sample_buffer(const Vector &point, int filter,
+    VolumeSample *sample) const
 {
   if (buffer_.IsEmpty()) {
     return false;
@@ -161,10 +615,16 @@ bool Volume::GetSample(const Vector &point, VolumeSample *sample) const
       (point.y - bounds_.min.y) / size_.y * res.y,
       (point.z - bounds_.min.z) / size_.z * res.z);
 
-  if (1) {
-    sample->density = trilinear_buffer_value(buffer_, P);
-  } else {
-    sample->density = nearest_buffer_value(buffer_, P);
+  switch (filter) {
+  case VOLUME_FILTER_NEAREST:
+    sample->density = buffer_.SampleNearest(P);
+    break;
+  case VOLUME_FILTER_TRICUBIC:
+    sample->density = buffer_.SampleTricubic(P);
+    break;
+  default:
+    sample->density = buffer_.SampleTrilinear(P);
+    break;
   }
 
   return true;
@@ -205,49 +665,67 @@ void VolGetIndexRange(const Volume *volume,
   volume->PointToIndex(P_max, xmax, ymax, zmax);
 }
 
-static float trilinear_buffer_value(const VoxelBuffer &buffer, const Vector &P)
+static uint16_t float_to_half(float value)
 {
-  const Vector P_sample(
-      P.x - .5,
-      P.y - .5,
-      P.z - .5);
-
-  const int lowest_corner[3] = {
-      (int) P_sample[0],
-      (int) P_sample[1],
-      (int) P_sample[2]};
-
-  int x, y, z;
-  float weight[3];
-  float value = 0;
-
-  for (int i = 0; i < 2; i++) {
-    x = lowest_corner[0] + i;
-    weight[0] = 1 - fabs(P_sample[0] - x);
-
-    for (int j = 0; j < 2; j++) {
-      y = lowest_corner[1] + j;
-      weight[1] = 1 - fabs(P_sample[1] - y);
+  uint32_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
 
-      for (int k = 0; k < 2; k++) {
-        z = lowest_corner[2] + k;
-        weight[2] = 1 - fabs(P_sample[2] - z);
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const int32_t exponent = (int32_t) ((bits >> 23) & 0xff) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffff;
 
-        value += weight[0] * weight[1] * weight[2] * buffer.GetValue(x, y, z);
-      }
+  // inf and nan
+  if (((bits >> 23) & 0xff) == 0xff) {
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+  }
+  // overflow
+  if (exponent >= 31) {
+    return sign | 0x7c00;
+  }
+  // denormal or underflow
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return sign;
     }
+    mantissa |= 0x800000;
+    const int shift = 14 - exponent;
+    uint32_t half = mantissa >> shift;
+    if ((mantissa >> (shift - 1)) & 1) {
+      half += 1;
+    }
+    return sign | half;
   }
 
-  return value;
+  // rounding may carry into exponent which gives the right result
+  uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+  if (mantissa & 0x1000) {
+    half += 1;
+  }
+  return half;
 }
 
-static float nearest_buffer_value(const VoxelBuffer &buffer, const Vector &P)
+static float half_to_float(uint16_t value)
 {
-  const int x = (int) P.x;
-  const int y = (int) P.y;
-  const int z = (int) P.z;
+  const uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+  uint32_t bits = 0;
+  float result = 0;
+
+  if (exponent == 0) {
+    // zero and denormal
+    result = ldexp((float) mantissa, -24);
+    return sign ? -result : result;
+  }
+  else if (exponent == 31) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
 
-  return buffer.GetValue(x, y, z);
+  memcpy(&result, &bits, sizeof(result));
+  return result;
 }
 
 } // namespace xxx
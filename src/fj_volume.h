@@ -9,6 +9,7 @@
 #include "fj_types.h"
 #include "fj_box.h"
 #include <vector>
+#include <cstdio>
 
 namespace fj {
 
@@ -21,6 +22,24 @@ public:
   int x, y, z;
 };
 
+// storage formats of voxel data. the compact formats are meant for
+// volumes which are filled once and then only sampled while rendering
+enum VoxelFormat {
+  VOXEL_FLOAT = 0, // 32-bit float
+  VOXEL_HALF,      // 16-bit half float
+  VOXEL_BYTE       // 8-bit quantized with per-block offset and scale
+};
+
+// edge length of quantization blocks for VOXEL_BYTE
+enum { VOXEL_BLOCK_SIZE = 8 };
+
+// reconstruction filters for sampling voxels at arbitrary points
+enum VolumeFilter {
+  VOLUME_FILTER_NEAREST = 0,
+  VOLUME_FILTER_TRILINEAR,
+  VOLUME_FILTER_TRICUBIC   // uniform cubic B-spline over 4x4x4 voxels
+};
+
 class FJ_API VoxelBuffer {
 public:
   VoxelBuffer();
@@ -30,12 +49,42 @@ public:
   const Resolution &GetResolution() const;
   bool IsEmpty() const;
 
+  // converts existing voxels into the new format
+  void SetFormat(int format);
+  int GetFormat() const;
+  size_t GetMemorySize() const;
+
+  // values can only be set to VOXEL_FLOAT buffers. compact ones need
+  // to be converted with SetFormat first
   void SetValue(int x, int y, int z, float value);
   float GetValue(int x, int y, int z) const;
 
+  int Write(FILE *file) const;
+  int Read(FILE *file);
+
+  // P is in voxel space where voxel (i, j, k) covers [i, i+1) and so on.
+  // nearest sampling clamps P to the border voxels so that points on the
+  // max faces of the bounds get them. the others treat voxels outside
+  // the buffer as zero
+  float SampleNearest(const Vector &P) const;
+  float SampleTrilinear(const Vector &P) const;
+  float SampleTricubic(const Vector &P) const;
+
 private:
+  int64_t voxel_index(int x, int y, int z) const;
+  int64_t block_index(int x, int y, int z) const;
+  float decode(int64_t index, int x, int y, int z) const;
+  float fetch(int64_t index, int x, int y, int z) const;
+  bool contains(int xmin, int ymin, int zmin, int xmax, int ymax, int zmax) const;
+  void compute_block_count(int *xblocks, int *yblocks, int *zblocks) const;
+
   std::vector<float> data_;
+  std::vector<uint16_t> half_data_;
+  std::vector<uint8_t> byte_data_;
+  std::vector<float> block_offset_;
+  std::vector<float> block_scale_;
   Resolution res_;
+  int format_;
 };
 
 class FJ_API VolumeSample {
@@ -65,9 +114,26 @@ public:
   void SetValue(int x, int y, int z, float value);
   float GetValue(int x, int y, int z) const;
 
+  // voxels modified after setting a compact format are stored as float
+  // until Compact() converts them back to the requested format
+  void SetVoxelFormat(int format);
+  int GetVoxelFormat() const;
+  void Compact();
+
+  int WriteVoxels(FILE *file) const;
+  int ReadVoxels(FILE *file);
+
+  // shadow rays use their own filter so that they can be cheaper
+  void SetFilter(int filter);
+  int GetFilter() const;
+  void SetShadowFilter(int filter);
+  int GetShadowFilter() const;
+
   bool GetSample(const Vector &point, VolumeSample *sample) const;
+  bool GetShadowSample(const Vector &point, VolumeSample *sample) const;
 
 public:
+  bool sample_buffer(const Vector &point, int filter, VolumeSample *sample) const;
   void compute_filter_size();
 
   VoxelBuffer buffer_;
@@ -75,6 +141,9 @@ public:
   Vector size_;
 
   Real filtersize_;
+  int voxel_format_;
+  int filter_;
+  int shadow_filter_;
 };
 
 FJ_API void VolGetIndexRange(const Volume *volume,
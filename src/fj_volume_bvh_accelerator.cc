@@ -0,0 +1,311 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "fj_volume_bvh_accelerator.h"
+#include "fj_interval.h"
+#include "fj_numeric.h"
+#include "fj_box.h"
+#include "fj_ray.h"
+
+#include <algorithm>
+#include <vector>
+#include <cassert>
+
+namespace fj {
+
+static const char ACCELERATOR_NAME[] = "Volume BVH";
+
+enum { BVH_STACKSIZE = 64 };
+// subtrees below this depth are split at the median, which adds no more
+// than 31 levels for any int count, so traversal fits in the stack
+enum { MAX_SAH_DEPTH = BVH_STACKSIZE - 32 };
+enum { SAH_BIN_COUNT = 16 };
+enum { MAX_LEAF_VOLUMES = 4 };
+
+// relative costs of a node traversal step and a volume bounds test
+static const Real TRAVERSAL_COST = 1;
+static const Real INTERSECTION_COST = 1;
+
+class VolumePrimitive {
+public:
+  VolumePrimitive() : bounds(), centroid(), index(0) {}
+  ~VolumePrimitive() {}
+
+  Box bounds;
+  Vector centroid;
+  Index index;
+};
+
+class SAHBin {
+public:
+  SAHBin() : bounds(), count(0) { bounds.ReverseInfinite(); }
+  ~SAHBin() {}
+
+  Box bounds;
+  int count;
+};
+
+// Tests whether the centroid is in the left side of the split bin.
+class CentroidInLeftBin {
+public:
+  CentroidInLeftBin(int axis, Real min, Real scale, int split) :
+      axis_(axis), min_(min), scale_(scale), split_(split) {}
+
+  bool operator()(const VolumePrimitive &prim) const
+  {
+    return bin_index(prim.centroid[axis_]) <= split_;
+  }
+
+  int bin_index(Real c) const
+  {
+    const int b = static_cast<int>((c - min_) * scale_);
+    return Clamp(b, 0, SAH_BIN_COUNT - 1);
+  }
+
+private:
+  int axis_;
+  Real min_;
+  Real scale_;
+  int split_;
+};
+
+// Orders primitives by centroid along the axis.
+class CentroidLess {
+public:
+  CentroidLess(int axis) : axis_(axis) {}
+
+  bool operator()(const VolumePrimitive &a, const VolumePrimitive &b) const
+  {
+    return a.centroid[axis_] < b.centroid[axis_];
+  }
+
+private:
+  int axis_;
+};
+
+static Real surface_area(const Box &box);
+static int build_bvh(std::vector<VolumeBVHNode> &nodes,
+    std::vector<VolumePrimitive> &prims, int begin, int end, int depth);
+static void make_leaf(VolumeBVHNode &node, int begin, int end);
+
+VolumeBVHAccelerator::VolumeBVHAccelerator() : nodes_(), volume_indices_()
+{
+}
+
+VolumeBVHAccelerator::~VolumeBVHAccelerator()
+{
+}
+
+int VolumeBVHAccelerator::build()
+{
+  const Index NPRIMS = GetVolumeCount();
+
+  nodes_.clear();
+  volume_indices_.clear();
+
+  // no volumes make an empty tree that no ray hits
+  if (NPRIMS == 0) {
+    return 0;
+  }
+
+  std::vector<VolumePrimitive> prims(NPRIMS);
+  for (Index i = 0; i < NPRIMS; i++) {
+    GetVolumeBounds(i, &prims[i].bounds);
+    prims[i].centroid = prims[i].bounds.Centroid();
+    prims[i].index = i;
+  }
+
+  nodes_.reserve(2 * NPRIMS);
+  build_bvh(nodes_, prims, 0, NPRIMS, 0);
+
+  volume_indices_.resize(NPRIMS);
+  for (Index i = 0; i < NPRIMS; i++) {
+    volume_indices_[i] = prims[i].index;
+  }
+
+  return 0;
+}
+
+bool VolumeBVHAccelerator::intersect(const Ray &ray, Real time,
+    IntervalList *intervals) const
+{
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  int stack[BVH_STACKSIZE];
+  int depth = 0;
+  int node_id = 0;
+  bool hit = false;
+
+  for (;;) {
+    const VolumeBVHNode &node = nodes_[node_id];
+    Real boxhit_tmin = 0;
+    Real boxhit_tmax = 0;
+
+    const bool hit_node = BoxRayIntersect(node.bounds,
+        ray.orig, ray.dir, ray.tmin, ray.tmax,
+        &boxhit_tmin, &boxhit_tmax);
+
+    if (hit_node) {
+      if (node.is_leaf()) {
+        for (int i = 0; i < node.count; i++) {
+          const Index volume_id = volume_indices_[node.offset + i];
+          hit |= RayVolumeIntersect(volume_id, ray, time, intervals);
+        }
+      } else {
+        // near child first so intervals are pushed almost in order
+        const int left = node_id + 1;
+        const int right = node.offset;
+        assert(depth < BVH_STACKSIZE);
+        if (ray.dir[node.axis] < 0) {
+          stack[depth++] = left;
+          node_id = right;
+        } else {
+          stack[depth++] = right;
+          node_id = left;
+        }
+        continue;
+      }
+    }
+
+    if (depth == 0) {
+      break;
+    }
+    node_id = stack[--depth];
+  }
+
+  return hit;
+}
+
+const char *VolumeBVHAccelerator::get_name() const
+{
+  return ACCELERATOR_NAME;
+}
+
+static Real surface_area(const Box &box)
+{
+  const Vector d = box.Diagonal();
+  return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static int build_bvh(std::vector<VolumeBVHNode> &nodes,
+    std::vector<VolumePrimitive> &prims, int begin, int end, int depth)
+{
+  const int node_id = static_cast<int>(nodes.size());
+  const int NPRIMS = end - begin;
+  nodes.push_back(VolumeBVHNode());
+
+  Box bounds;
+  Box centroid_bounds;
+  bounds.ReverseInfinite();
+  centroid_bounds.ReverseInfinite();
+  for (int i = begin; i < end; i++) {
+    bounds.AddBox(prims[i].bounds);
+    centroid_bounds.AddPoint(prims[i].centroid);
+  }
+  nodes[node_id].bounds = bounds;
+
+  if (NPRIMS == 1) {
+    make_leaf(nodes[node_id], begin, end);
+    return node_id;
+  }
+
+  // split along the longest axis of centroids
+  const Vector extent = centroid_bounds.Diagonal();
+  int axis = 0;
+  if (extent[1] > extent[axis]) axis = 1;
+  if (extent[2] > extent[axis]) axis = 2;
+
+  if (extent[axis] <= 0 || depth >= MAX_SAH_DEPTH) {
+    // all centroids coincide or the tree is too deep
+    if (NPRIMS <= MAX_LEAF_VOLUMES) {
+      make_leaf(nodes[node_id], begin, end);
+      return node_id;
+    }
+    const int mid = begin + NPRIMS / 2;
+    if (extent[axis] > 0) {
+      std::nth_element(prims.begin() + begin, prims.begin() + mid,
+          prims.begin() + end, CentroidLess(axis));
+    }
+    nodes[node_id].axis = axis;
+    build_bvh(nodes, prims, begin, mid, depth + 1);
+    const int right = build_bvh(nodes, prims, mid, end, depth + 1);
+    nodes[node_id].offset = right;
+    return node_id;
+  }
+
+  // binned surface area heuristic
+  const Real scale = SAH_BIN_COUNT * (1 - 1e-6) / extent[axis];
+  const CentroidInLeftBin binning(axis, centroid_bounds.min[axis], scale, 0);
+  SAHBin bins[SAH_BIN_COUNT];
+
+  for (int i = begin; i < end; i++) {
+    const int b = binning.bin_index(prims[i].centroid[axis]);
+    bins[b].count++;
+    bins[b].bounds.AddBox(prims[i].bounds);
+  }
+
+  Real cost[SAH_BIN_COUNT - 1];
+  {
+    Box left_bounds;
+    int left_count = 0;
+    left_bounds.ReverseInfinite();
+    for (int i = 0; i < SAH_BIN_COUNT - 1; i++) {
+      left_bounds.AddBox(bins[i].bounds);
+      left_count += bins[i].count;
+      cost[i] = left_count > 0 ? left_count * surface_area(left_bounds) : 0;
+    }
+  }
+  {
+    Box right_bounds;
+    int right_count = 0;
+    right_bounds.ReverseInfinite();
+    for (int i = SAH_BIN_COUNT - 1; i > 0; i--) {
+      right_bounds.AddBox(bins[i].bounds);
+      right_count += bins[i].count;
+      cost[i - 1] += right_count > 0 ? right_count * surface_area(right_bounds) : 0;
+    }
+  }
+
+  int best_split = 0;
+  for (int i = 1; i < SAH_BIN_COUNT - 1; i++) {
+    if (cost[i] < cost[best_split]) {
+      best_split = i;
+    }
+  }
+
+  const Real bounds_area = surface_area(bounds);
+  const Real split_cost = TRAVERSAL_COST + (bounds_area > 0 ?
+      INTERSECTION_COST * cost[best_split] / bounds_area : 0);
+  const Real leaf_cost = INTERSECTION_COST * NPRIMS;
+
+  if (NPRIMS <= MAX_LEAF_VOLUMES && leaf_cost <= split_cost) {
+    make_leaf(nodes[node_id], begin, end);
+    return node_id;
+  }
+
+  const CentroidInLeftBin in_left(axis, centroid_bounds.min[axis], scale, best_split);
+  std::vector<VolumePrimitive>::iterator mid_it =
+      std::partition(prims.begin() + begin, prims.begin() + end, in_left);
+  int mid = static_cast<int>(mid_it - prims.begin());
+  if (mid == begin || mid == end) {
+    mid = begin + NPRIMS / 2;
+  }
+
+  nodes[node_id].axis = axis;
+  build_bvh(nodes, prims, begin, mid, depth + 1);
+  const int right = build_bvh(nodes, prims, mid, end, depth + 1);
+  // nodes may have been reallocated by recursion
+  nodes[node_id].offset = right;
+
+  return node_id;
+}
+
+static void make_leaf(VolumeBVHNode &node, int begin, int end)
+{
+  node.offset = begin;
+  node.count = end - begin;
+}
+
+} // namespace xxx
@@ -0,0 +1,44 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#ifndef FJ_VOLUME_BVH_ACCELERATOR_H
+#define FJ_VOLUME_BVH_ACCELERATOR_H
+
+#include "fj_volume_accelerator.h"
+#include <vector>
+
+namespace fj {
+
+class VolumeBVHNode {
+public:
+  VolumeBVHNode() : bounds(), offset(0), count(0), axis(0) {}
+  ~VolumeBVHNode() {}
+
+  bool is_leaf() const { return count > 0; }
+
+  Box bounds;
+  // first index into volume indices for leaf, right child for interior
+  int offset;
+  int count;
+  int axis;
+};
+
+class VolumeBVHAccelerator : public VolumeAccelerator {
+public:
+  VolumeBVHAccelerator();
+  ~VolumeBVHAccelerator();
+
+private:
+  virtual int build();
+  virtual bool intersect(const Ray &ray, Real time, IntervalList *intervals) const;
+  virtual const char *get_name() const;
+
+  // flat depth-first layout. the left child of an interior node
+  // is always the next node in the array
+  std::vector<VolumeBVHNode> nodes_;
+  std::vector<Index> volume_indices_;
+};
+
+} // namespace xxx
+
+#endif // FJ_XXX_H
@@ -0,0 +1,82 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "fj_volume_io.h"
+#include "fj_file_io.h"
+#include "fj_volume.h"
+#include "fj_vector.h"
+#include "fj_box.h"
+
+#include <cstring>
+#include <cstdio>
+
+#define VOL_FILE_VERSION 1
+#define VOL_FILE_MAGIC "VOLM"
+#define VOL_MAGIC_SIZE 4
+
+namespace fj {
+
+int VolSaveFile(const Volume &volume, const char *filename)
+{
+  int8_t magic[] = VOL_FILE_MAGIC;
+  const int32_t version = VOL_FILE_VERSION;
+  const Box &bounds = volume.GetBounds();
+  const double box[6] = {
+      bounds.min.x, bounds.min.y, bounds.min.z,
+      bounds.max.x, bounds.max.y, bounds.max.z};
+  int err = 0;
+
+  FILE *file = fopen(filename, "wb");
+  if (file == NULL) {
+    return -1;
+  }
+
+  err |= FjFile_WriteInt8  (file, magic, VOL_MAGIC_SIZE);
+  err |= FjFile_WriteInt32 (file, &version, 1);
+  err |= FjFile_WriteDouble(file, box, 6);
+  err |= volume.WriteVoxels(file);
+
+  fclose(file);
+
+  return err ? -1 : 0;
+}
+
+int VolLoadFile(Volume &volume, const char *filename)
+{
+  int8_t magic[VOL_MAGIC_SIZE] = {'\0'};
+  int32_t version = 0;
+  double box[6] = {0, 0, 0, 0, 0, 0};
+  int err = 0;
+
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    return -1;
+  }
+
+  err = FjFile_ReadInt8(file, magic, VOL_MAGIC_SIZE);
+  if (err || memcmp(magic, VOL_FILE_MAGIC, VOL_MAGIC_SIZE) != 0) {
+    fclose(file);
+    return -1;
+  }
+  err = FjFile_ReadInt32(file, &version, 1);
+  if (err || version != VOL_FILE_VERSION) {
+    fclose(file);
+    return -1;
+  }
+  err = FjFile_ReadDouble(file, box, 6);
+  if (err) {
+    fclose(file);
+    return -1;
+  }
+
+  volume.SetBounds(Box(
+      Vector(box[0], box[1], box[2]),
+      Vector(box[3], box[4], box[5])));
+  err = volume.ReadVoxels(file);
+
+  fclose(file);
+
+  return err ? -1 : 0;
+}
+
+} // namespace xxx
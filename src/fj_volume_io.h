@@ -0,0 +1,19 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#ifndef FJ_VOLUME_IO_H
+#define FJ_VOLUME_IO_H
+
+#include "fj_compatibility.h"
+
+namespace fj {
+
+class Volume;
+
+// voxels are written in the format set by Volume::SetVoxelFormat
+FJ_API int VolSaveFile(const Volume &volume, const char *filename);
+FJ_API int VolLoadFile(Volume &volume, const char *filename);
+
+} // namespace xxx
+
+#endif // FJ_XXX_H
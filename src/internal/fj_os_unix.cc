@@ -6,6 +6,7 @@
 #include <string.h>
 #include <dlfcn.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 void *OsDlopen(const char *filename)
 {
@@ -49,3 +50,21 @@ int OsDlclose(void *handle)
     return 0;
   }
 }
+
+long OsGetFileModifiedTime(const char *filename)
+{
+  struct stat st;
+
+  if (stat(filename, &st) != 0) {
+    return -1;
+  }
+  return (long) st.st_mtime;
+}
+
+double OsGetTime(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
@@ -60,3 +60,28 @@ int OsDlclose(void *handle)
     return 0;
   }
 }
+
+long OsGetFileModifiedTime(const char *filename)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  ULARGE_INTEGER time;
+
+  if (!GetFileAttributesEx(filename, GetFileExInfoStandard, &data)) {
+    return -1;
+  }
+  time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+  time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+
+  /* 100 nanoseconds since 1601 to seconds since 1970 */
+  return (long) (time.QuadPart / 10000000. - 11644473600.);
+}
+
+double OsGetTime(void)
+{
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER count;
+
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return (double) count.QuadPart / frequency.QuadPart;
+}
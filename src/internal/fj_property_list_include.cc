@@ -68,6 +68,13 @@ static int set_ObjectInstance_shadow_target(void *self, const PropertyValue *val
   return 0;
 }
 
+static int set_ObjectInstance_transparent_shadow(void *self, const PropertyValue *value)
+{
+  ObjectInstance *obj = reinterpret_cast<ObjectInstance *>(self);
+  obj->SetTransparentShadow(value->vector[0] != 0);
+  return 0;
+}
+
 static int set_Turbulence_lacunarity(void *self, const PropertyValue *value)
 {
   Turbulence *turbulence = reinterpret_cast<Turbulence *>(self);
@@ -166,6 +173,39 @@ static int set_Renderer_raymarch_refract_step(void *self, const PropertyValue *v
   return 0;
 }
 
+static int set_Renderer_raymarch_adaptive(void *self, const PropertyValue *value)
+{
+  const int adaptive = (int) value->vector[0];
+  if (adaptive != 0 && adaptive != 1)
+    return -1;
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetRaymarchAdaptive(adaptive);
+  return 0;
+}
+
+static int set_Renderer_light_sample_budget(void *self, const PropertyValue *value)
+{
+  const int budget = (int) value->vector[0];
+  if (budget < 0)
+    return -1;
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetLightSampleBudget(budget);
+  return 0;
+}
+
+static int set_Renderer_russian_roulette_threshold(void *self, const PropertyValue *value)
+{
+  const double threshold = value->vector[0];
+  if (threshold < 0)
+    return -1;
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetRussianRouletteThreshold(threshold);
+  return 0;
+}
+
 static int set_Renderer_sample_time_range(void *self, const PropertyValue *value)
 {
   Renderer *renderer = reinterpret_cast<Renderer *>(self);
@@ -173,6 +213,31 @@ static int set_Renderer_sample_time_range(void *self, const PropertyValue *value
   return 0;
 }
 
+static int set_Renderer_progressive(void *self, const PropertyValue *value)
+{
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetProgressive(static_cast<int>(value->vector[0]));
+  return 0;
+}
+
+static int set_Renderer_preview(void *self, const PropertyValue *value)
+{
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetPreview(static_cast<int>(value->vector[0]));
+  return 0;
+}
+
+static int set_Renderer_progressive_time_budget(void *self, const PropertyValue *value)
+{
+  if (value->vector[0] < 0) {
+    return -1;
+  }
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetProgressiveTimeBudget(value->vector[0]);
+  return 0;
+}
+
 static int set_Renderer_resolution(void *self, const PropertyValue *value)
 {
   Renderer *renderer = reinterpret_cast<Renderer *>(self);
@@ -187,6 +252,17 @@ static int set_Renderer_tilesize(void *self, const PropertyValue *value)
   return 0;
 }
 
+static int set_Renderer_tile_order(void *self, const PropertyValue *value)
+{
+  const int tile_order = static_cast<int>(value->vector[0]);
+  if (tile_order < TILE_SCANLINE || tile_order > TILE_CENTER_OUT)
+    return -1;
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetTileOrder(tile_order);
+  return 0;
+}
+
 static int set_Renderer_filterwidth(void *self, const PropertyValue *value)
 {
   Renderer *renderer = reinterpret_cast<Renderer *>(self);
@@ -194,6 +270,17 @@ static int set_Renderer_filterwidth(void *self, const PropertyValue *value)
   return 0;
 }
 
+static int set_Renderer_filtertype(void *self, const PropertyValue *value)
+{
+  const int filtertype = static_cast<int>(value->vector[0]);
+  if (filtertype < FLT_BOX || filtertype > FLT_BLACKMAN_HARRIS)
+    return -1;
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetFilterType(filtertype);
+  return 0;
+}
+
 static int set_Renderer_sampler_type(void *self, const PropertyValue *value)
 {
   Renderer *renderer = reinterpret_cast<Renderer *>(self);
@@ -222,6 +309,28 @@ static int set_Renderer_adaptive_subdivision_threshold(void *self, const Propert
   return 0;
 }
 
+static int set_Renderer_variance_max_samples(void *self, const PropertyValue *value)
+{
+  if (value->vector[0] < 1) {
+    return -1;
+  }
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetMaxPixelSamples(static_cast<int>(value->vector[0]));
+  return 0;
+}
+
+static int set_Renderer_variance_threshold(void *self, const PropertyValue *value)
+{
+  if (value->vector[0] < 0) {
+    return -1;
+  }
+
+  Renderer *renderer = reinterpret_cast<Renderer *>(self);
+  renderer->SetVarianceThreshold(value->vector[0]);
+  return 0;
+}
+
 static int set_Renderer_render_region(void *self, const PropertyValue *value)
 {
   Renderer *renderer = reinterpret_cast<Renderer *>(self);
@@ -333,6 +442,39 @@ static int set_Volume_bounds_max(void *self, const PropertyValue *value)
   return 0;
 }
 
+static int set_Volume_voxel_format(void *self, const PropertyValue *value)
+{
+  const int format = (int) value->vector[0];
+  if (format < VOXEL_FLOAT || format > VOXEL_BYTE)
+    return -1;
+
+  Volume *volume = reinterpret_cast<Volume *>(self);
+  volume->SetVoxelFormat(format);
+  return 0;
+}
+
+static int set_Volume_filter(void *self, const PropertyValue *value)
+{
+  const int filter = (int) value->vector[0];
+  if (filter < VOLUME_FILTER_NEAREST || filter > VOLUME_FILTER_TRICUBIC)
+    return -1;
+
+  Volume *volume = reinterpret_cast<Volume *>(self);
+  volume->SetFilter(filter);
+  return 0;
+}
+
+static int set_Volume_shadow_filter(void *self, const PropertyValue *value)
+{
+  const int filter = (int) value->vector[0];
+  if (filter < VOLUME_FILTER_NEAREST || filter > VOLUME_FILTER_TRICUBIC)
+    return -1;
+
+  Volume *volume = reinterpret_cast<Volume *>(self);
+  volume->SetShadowFilter(filter);
+  return 0;
+}
+
 static int set_Light_intensity(void *self, const PropertyValue *value)
 {
   Light *light = reinterpret_cast<Light *>(self);
@@ -368,6 +510,16 @@ static int set_Light_environment_map(void *self, const PropertyValue *value)
   return 0;
 }
 
+static int set_Light_distribution_resolution(void *self, const PropertyValue *value)
+{
+  if (value->vector[0] < 0 || value->vector[1] < 0)
+    return -1;
+
+  Light *light = reinterpret_cast<Light *>(self);
+  light->SetDistributionResolution((int) value->vector[0], (int) value->vector[1]);
+  return 0;
+}
+
 static int set_Light_transform_order(void *self, const PropertyValue *value)
 {
   // TODO error handling
@@ -421,6 +573,7 @@ static const Property ObjectInstance_properties[] = {
   {PROP_OBJECTGROUP, "reflect_target",  {0, 0, 0, 0}, set_ObjectInstance_reflect_target},
   {PROP_OBJECTGROUP, "refract_target",  {0, 0, 0, 0}, set_ObjectInstance_refract_target},
   {PROP_OBJECTGROUP, "shadow_target",   {0, 0, 0, 0}, set_ObjectInstance_shadow_target},
+  {PROP_SCALAR,      "transparent_shadow", {0, 0, 0, 0}, set_ObjectInstance_transparent_shadow},
   END_OF_PROPERTY
 };
 
@@ -443,14 +596,24 @@ static const Property Renderer_properties[] = {
   {PROP_SCALAR,  "raymarch_shadow_step",  {.1, 0, 0, 0},     set_Renderer_raymarch_shadow_step},
   {PROP_SCALAR,  "raymarch_reflect_step", {.1, 0, 0, 0},     set_Renderer_raymarch_reflect_step},
   {PROP_SCALAR,  "raymarch_refract_step", {.1, 0, 0, 0},     set_Renderer_raymarch_refract_step},
+  {PROP_SCALAR,  "raymarch_adaptive",     {0, 0, 0, 0},      set_Renderer_raymarch_adaptive},
+  {PROP_SCALAR,  "light_sample_budget",   {0, 0, 0, 0},      set_Renderer_light_sample_budget},
+  {PROP_SCALAR,  "russian_roulette_threshold", {0, 0, 0, 0}, set_Renderer_russian_roulette_threshold},
   {PROP_VECTOR2, "sample_time_range",     {0, 1, 0, 0},      set_Renderer_sample_time_range},
+  {PROP_SCALAR,  "progressive",           {0, 0, 0, 0},      set_Renderer_progressive},
+  {PROP_SCALAR,  "progressive_time_budget", {0, 0, 0, 0},    set_Renderer_progressive_time_budget},
+  {PROP_SCALAR,  "preview",               {0, 0, 0, 0},      set_Renderer_preview},
   {PROP_VECTOR2, "resolution",            {320, 240, 0, 0},  set_Renderer_resolution},
   {PROP_VECTOR2, "tilesize",              {32, 32, 0, 0},    set_Renderer_tilesize},
+  {PROP_SCALAR,  "tile_order",            {TILE_SCANLINE, 0, 0, 0}, set_Renderer_tile_order},
   {PROP_VECTOR2, "filterwidth",           {2, 2, 0, 0},      set_Renderer_filterwidth},
+  {PROP_SCALAR,  "filtertype",            {FLT_GAUSSIAN, 0, 0, 0}, set_Renderer_filtertype},
   {PROP_SCALAR,  "sampler_type",          {0, 0, 0, 0},      set_Renderer_sampler_type},
   {PROP_VECTOR2, "pixelsamples",          {3, 3, 0, 0},      set_Renderer_pixelsamples},
   {PROP_SCALAR,  "adaptive_max_subdivision", {1, 0, 0, 0},   set_Renderer_adaptive_max_subdivision},
   {PROP_SCALAR,  "adaptive_subdivision_threshold", {.05, 0, 0, 0},   set_Renderer_adaptive_subdivision_threshold},
+  {PROP_SCALAR,  "variance_max_samples",  {64, 0, 0, 0},     set_Renderer_variance_max_samples},
+  {PROP_SCALAR,  "variance_threshold",    {.02, 0, 0, 0},    set_Renderer_variance_threshold},
   {PROP_VECTOR4, "render_region",         {0, 0, 320, 2400}, set_Renderer_render_region},
   {PROP_SCALAR,  "use_max_thread",        {1, 0, 0, 0},      set_Renderer_use_max_thread},
   {PROP_SCALAR,  "thread_count",          {8, 0, 0, 0},      set_Renderer_thread_count},
@@ -472,6 +635,9 @@ static const Property Volume_properties[] = {
   {PROP_VECTOR3, "resolution", {0, 0, 0, 0}, set_Volume_resolution},
   {PROP_VECTOR3, "bounds_min", {0, 0, 0, 0}, set_Volume_bounds_min},
   {PROP_VECTOR3, "bounds_max", {0, 0, 0, 0}, set_Volume_bounds_max},
+  {PROP_SCALAR,  "voxel_format", {VOXEL_FLOAT, 0, 0, 0}, set_Volume_voxel_format},
+  {PROP_SCALAR,  "filter", {VOLUME_FILTER_TRILINEAR, 0, 0, 0}, set_Volume_filter},
+  {PROP_SCALAR,  "shadow_filter", {VOLUME_FILTER_TRILINEAR, 0, 0, 0}, set_Volume_shadow_filter},
   END_OF_PROPERTY
 };
 
@@ -486,6 +652,7 @@ static const Property Light_properties[] = {
   {PROP_SCALAR,  "sample_count",    {16, 0, 0, 0}, set_Light_sample_count},
   {PROP_SCALAR,  "double_sided",    {0, 0, 0, 0},  set_Light_double_sided},
   {PROP_TEXTURE, "environment_map", {0, 0, 0, 0},  set_Light_environment_map},
+  {PROP_VECTOR2, "distribution_resolution", {0, 0, 0, 0}, set_Light_distribution_resolution},
   END_OF_PROPERTY
 };
 
@@ -0,0 +1,72 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "unit_test.h"
+#include "fj_irradiance_cache.h"
+#include "fj_object_instance.h"
+#include <cstdio>
+
+using namespace fj;
+
+int main()
+{
+  ObjectInstance obj;
+  ObjectInstance other;
+  // owners are only compared by address
+  int shader = 0;
+  int other_shader = 0;
+  const Vector P(.1, .2, .3);
+  const Vector N(0, 1, 0);
+  const Real spacing = .5;
+
+  {
+    IrradianceCache cache;
+    Color irradiance;
+
+    TEST(!cache.Lookup(&obj, &shader, P, N, spacing, &irradiance));
+    TEST_INT(cache.GetRecordCount(), 0);
+  }
+  {
+    IrradianceCache cache;
+    Color irradiance;
+
+    cache.Insert(&obj, &shader, P, N, spacing, Color(.2, .4, .6));
+    TEST_INT(cache.GetRecordCount(), 1);
+
+    // a record across cell boundaries is found from the other side
+    TEST(cache.Lookup(&obj, &shader, P, N, spacing, &irradiance));
+    TEST_FLOAT(irradiance.g, .4);
+    TEST(cache.Lookup(&obj, &shader, P + Vector(-.45, 0, 0), N, spacing, &irradiance));
+    TEST_FLOAT(irradiance.b, .6);
+
+    // misses beyond the spacing, facing away, on other objects
+    // or for other shaders
+    TEST(!cache.Lookup(&obj, &shader, P + Vector(.5, 0, 0), N, spacing, &irradiance));
+    TEST(!cache.Lookup(&obj, &shader, P, Vector(1, 0, 0), spacing, &irradiance));
+    TEST(!cache.Lookup(&other, &shader, P, N, spacing, &irradiance));
+    TEST(!cache.Lookup(&obj, &shader, P, N, .25, &irradiance));
+    TEST(!cache.Lookup(&obj, &other_shader, P, N, spacing, &irradiance));
+
+    cache.Clear();
+    TEST_INT(cache.GetRecordCount(), 0);
+    TEST(!cache.Lookup(&obj, &shader, P, N, spacing, &irradiance));
+  }
+  {
+    // closer records weigh more
+    IrradianceCache cache;
+    Color irradiance;
+
+    cache.Insert(&obj, &shader, P, N, spacing, Color(1, 1, 1));
+    cache.Insert(&obj, &shader, P + Vector(0, 0, .4), N, spacing, Color(0, 0, 0));
+
+    TEST(cache.Lookup(&obj, &shader, P + Vector(0, 0, .1), N, spacing, &irradiance));
+    TEST(irradiance.r > .5 && irradiance.r < 1);
+    TEST(cache.Lookup(&obj, &shader, P + Vector(0, 0, .2), N, spacing, &irradiance));
+    TEST_FLOAT(irradiance.r, .5);
+  }
+
+  printf("%s: %d/%d/%d: (FAIL/PASS/TOTAL)\n", __FILE__,
+    TestGetFailCount(), TestGetPassCount(), TestGetTotalCount());
+
+  return 0;
+}
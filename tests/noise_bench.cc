@@ -0,0 +1,55 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+// compares scalar and batch turbulence evaluation
+
+#include "fj_turbulence.h"
+#include "fj_random.h"
+#include "fj_vector.h"
+#include <vector>
+#include <cstdio>
+#include <ctime>
+
+using namespace fj;
+
+static double elapsed_sec(clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+  const int N = 1000000;
+  std::vector<float> x(N), y(N), z(N);
+  std::vector<float> nx(N), ny(N), nz(N);
+  Turbulence turbulence;
+  XorShift rng;
+  double sum = 0;
+
+  for (int i = 0; i < N; i++) {
+    const Vector P = rng.SolidCubeRand();
+    x[i] = P.x;
+    y[i] = P.y;
+    z[i] = P.z;
+  }
+
+  clock_t start = clock();
+  for (int i = 0; i < N; i++) {
+    const Vector noise = turbulence.Evaluate3d(Vector(x[i], y[i], z[i]));
+    sum += noise.x + noise.y + noise.z;
+  }
+  const double scalar_sec = elapsed_sec(start);
+
+  start = clock();
+  turbulence.Evaluate3dBatch(&x[0], &y[0], &z[0], &nx[0], &ny[0], &nz[0], N);
+  for (int i = 0; i < N; i++) {
+    sum -= nx[i] + ny[i] + nz[i];
+  }
+  const double batch_sec = elapsed_sec(start);
+
+  printf("Turbulence::Evaluate3d      %d points: %.3f sec\n", N, scalar_sec);
+  printf("Turbulence::Evaluate3dBatch %d points: %.3f sec\n", N, batch_sec);
+  printf("speedup: %.2fx (checksum %g)\n", scalar_sec / batch_sec, sum);
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "unit_test.h"
+#include "fj_turbulence.h"
+#include "fj_numeric.h"
+#include "fj_vector.h"
+#include "fj_noise.h"
+#include <cstdio>
+
+using namespace fj;
+
+static int max_diff_ok(const float *a, const Real *b, int count, Real tolerance)
+{
+  for (int i = 0; i < count; i++) {
+    if (Abs(a[i] - b[i]) > tolerance) {
+      printf("*   [%d] batch: %g scalar: %g\n", i, a[i], b[i]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int main()
+{
+  // odd count exercises the partial last block
+  const int N = 37;
+  float x[N], y[N], z[N];
+  float out[N], out_x[N], out_y[N], out_z[N];
+  Real expected[N], expected_x[N], expected_y[N], expected_z[N];
+
+  for (int i = 0; i < N; i++) {
+    x[i] = -3.1f + .37f * i;
+    y[i] =  1.7f - .21f * i;
+    z[i] =  .5f  + .13f * i;
+  }
+
+  {
+    PeriodicNoise3dBatch(x, y, z, out, N);
+    for (int i = 0; i < N; i++) {
+      expected[i] = PeriodicNoise3d(x[i], y[i], z[i]);
+    }
+    TEST(max_diff_ok(out, expected, N, 1e-5));
+  }
+  {
+    PerlinNoiseBatch(x, y, z, 2, .5, 6, out, N);
+    for (int i = 0; i < N; i++) {
+      expected[i] = PerlinNoise(Vector(x[i], y[i], z[i]), 2, .5, 6);
+    }
+    TEST(max_diff_ok(out, expected, N, 1e-4));
+  }
+  {
+    Turbulence turbulence;
+    turbulence.SetAmplitude(1, .5, 2);
+    turbulence.SetFrequency(2, 2, 2);
+    turbulence.SetOffset(.1, .2, .3);
+    turbulence.SetOctaves(4);
+
+    turbulence.EvaluateBatch(x, y, z, out, N);
+    turbulence.Evaluate3dBatch(x, y, z, out_x, out_y, out_z, N);
+    for (int i = 0; i < N; i++) {
+      const Vector P(x[i], y[i], z[i]);
+      const Vector noise = turbulence.Evaluate3d(P);
+      expected[i] = turbulence.Evaluate(P);
+      expected_x[i] = noise.x;
+      expected_y[i] = noise.y;
+      expected_z[i] = noise.z;
+    }
+    TEST(max_diff_ok(out, expected, N, 1e-4));
+    TEST(max_diff_ok(out_x, expected_x, N, 1e-4));
+    TEST(max_diff_ok(out_y, expected_y, N, 1e-4));
+    TEST(max_diff_ok(out_z, expected_z, N, 1e-4));
+  }
+
+  printf("%s: %d/%d/%d: (FAIL/PASS/TOTAL)\n", __FILE__,
+    TestGetFailCount(), TestGetPassCount(), TestGetTotalCount());
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "unit_test.h"
+#include "fj_scene_interface.h"
+#include "fj_mesh_io.h"
+#include "fj_vector.h"
+#include "fj_types.h"
+#include <vector>
+#include <cstdio>
+
+using namespace fj;
+
+static const char MESH_FILE[] = "rerender_test.mesh";
+
+static void write_floor_mesh(void)
+{
+  const Vector P[] = {
+    Vector(-2, 0, -2),
+    Vector( 2, 0, -2),
+    Vector( 2, 0,  2),
+    Vector(-2, 0,  2)
+  };
+  const Vector N[] = {
+    Vector(0, 1, 0),
+    Vector(0, 1, 0),
+    Vector(0, 1, 0),
+    Vector(0, 1, 0)
+  };
+  const Index3 indices[] = {
+    Index3(0, 2, 1),
+    Index3(0, 3, 2)
+  };
+
+  MeshOutput out;
+  out.Open(MESH_FILE);
+  out.SetPointCount(4);
+  out.SetPointPosition(P);
+  out.SetPointNormal(N);
+  out.SetFaceCount(2);
+  out.SetFaceIndex3(indices);
+  out.WriteFile();
+  out.Close();
+}
+
+// renders the floor under a grid light. when second_sample_count is
+// positive the light sample count is changed and the scene is rendered
+// again without reopening it
+static int render_floor(int sample_count, int second_sample_count,
+    const char *filename)
+{
+  SiOpenScene();
+  SiOpenPlugin("PlasticShader");
+
+  ID camera = SiNewCamera("PerspectiveCamera");
+  SiSetProperty3(camera, "translate", 0, 2, 5);
+  SiSetProperty3(camera, "rotate", -20, 0, 0);
+
+  ID shader = SiNewShader("PlasticShader");
+  ID mesh = SiNewMesh(MESH_FILE);
+  ID object = SiNewObjectInstance(mesh);
+  SiAssignShader(object, "DEFAULT_SHADING_GROUP", shader);
+
+  ID light = SiNewLight(SI_GRID_LIGHT);
+  SiSetProperty3(light, "translate", 0, 2, 0);
+  SiSetProperty3(light, "rotate", 90, 0, 0);
+  SiSetProperty1(light, "sample_count", sample_count);
+
+  ID framebuffer = SiNewFrameBuffer("rgba");
+  ID renderer = SiNewRenderer();
+  SiSetProperty2(renderer, "resolution", 32, 24);
+  SiSetProperty2(renderer, "pixelsamples", 1, 1);
+  SiAssignCamera(renderer, camera);
+  SiAssignFrameBuffer(renderer, framebuffer);
+
+  int err = SiRenderScene(renderer) != SI_SUCCESS;
+
+  if (second_sample_count > 0) {
+    SiSetProperty1(light, "sample_count", second_sample_count);
+    err |= SiRenderScene(renderer) != SI_SUCCESS;
+  }
+
+  err |= SiSaveFrameBuffer(framebuffer, filename) != SI_SUCCESS;
+  SiCloseScene();
+
+  return err;
+}
+
+static std::vector<char> read_file(const char *filename)
+{
+  std::vector<char> data;
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    return data;
+  }
+
+  int c;
+  while ((c = fgetc(fp)) != EOF) {
+    data.push_back((char) c);
+  }
+  fclose(fp);
+
+  return data;
+}
+
+int main()
+{
+  write_floor_mesh();
+
+  {
+    // light samples are taken from the current light properties
+    // in the renders reusing the scene
+    TEST_INT(render_floor(1, 64, "rerender_test_1_64.fb"), 0);
+    TEST_INT(render_floor(64, 0, "rerender_test_64.fb"), 0);
+
+    const std::vector<char> rerendered = read_file("rerender_test_1_64.fb");
+    const std::vector<char> rendered = read_file("rerender_test_64.fb");
+    TEST(!rendered.empty());
+    TEST(rerendered == rendered);
+  }
+  {
+    TEST_INT(render_floor(64, 1, "rerender_test_64_1.fb"), 0);
+    TEST_INT(render_floor(1, 0, "rerender_test_1.fb"), 0);
+
+    const std::vector<char> rerendered = read_file("rerender_test_64_1.fb");
+    const std::vector<char> rendered = read_file("rerender_test_1.fb");
+    TEST(!rendered.empty());
+    TEST(rerendered == rendered);
+  }
+
+  printf("%s: %d/%d/%d: (FAIL/PASS/TOTAL)\n", __FILE__,
+    TestGetFailCount(), TestGetPassCount(), TestGetTotalCount());
+
+  return 0;
+}
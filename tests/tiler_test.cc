@@ -0,0 +1,111 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "unit_test.h"
+#include "fj_rectangle.h"
+#include "fj_tiler.h"
+#include <vector>
+#include <cstdio>
+
+using namespace fj;
+
+static int count_uncovered_pixels(const Tiler &tiler, const Rectangle &region)
+{
+  const int xres = region.max[0];
+  const int yres = region.max[1];
+  std::vector<int> coverage(xres * yres, 0);
+
+  for (int i = 0; i < tiler.GetTileCount(); i++) {
+    const Tile *tile = tiler.GetTile(i);
+    for (int y = tile->ymin; y < tile->ymax; y++) {
+      for (int x = tile->xmin; x < tile->xmax; x++) {
+        coverage[y * xres + x]++;
+      }
+    }
+  }
+
+  int uncovered = 0;
+  for (int y = region.min[1]; y < region.max[1]; y++) {
+    for (int x = region.min[0]; x < region.max[0]; x++) {
+      if (coverage[y * xres + x] != 1) {
+        uncovered++;
+      }
+    }
+  }
+  return uncovered;
+}
+
+int main()
+{
+  Rectangle region;
+  region.min = Int2(0, 0);
+  region.max = Int2(200, 150);
+
+  {
+    Tiler tiler;
+    tiler.Divide(200, 150, 32, 32);
+    tiler.GenerateTiles(region);
+
+    TEST_INT(tiler.GetTileCount(), 7 * 5);
+    TEST_INT(tiler.GetTile(1)->xmin, 32);
+    TEST_INT(tiler.GetTile(1)->ymin, 0);
+    TEST_INT(count_uncovered_pixels(tiler, region), 0);
+  }
+  {
+    Tiler tiler;
+    tiler.Divide(200, 150, 32, 32);
+    tiler.SetTileOrder(TILE_HILBERT);
+    tiler.GenerateTiles(region);
+
+    TEST_INT(tiler.GetTileCount(), 7 * 5);
+    TEST_INT(count_uncovered_pixels(tiler, region), 0);
+
+    // each tile is next to the previous one
+    int jumps = 0;
+    for (int i = 1; i < tiler.GetTileCount(); i++) {
+      const Tile *prev = tiler.GetTile(i - 1);
+      const Tile *tile = tiler.GetTile(i);
+      const int dx = (tile->xmin - prev->xmin) / 32;
+      const int dy = (tile->ymin - prev->ymin) / 32;
+      if (dx * dx + dy * dy != 1) {
+        jumps++;
+      }
+    }
+    TEST(jumps < 5);
+  }
+  {
+    Tiler tiler;
+    tiler.Divide(200, 150, 32, 32);
+    tiler.SetTileOrder(TILE_CENTER_OUT);
+    tiler.GenerateTiles(region);
+
+    TEST_INT(count_uncovered_pixels(tiler, region), 0);
+    TEST_INT(tiler.GetTile(0)->xmin, 96);
+    TEST_INT(tiler.GetTile(0)->ymin, 64);
+  }
+  {
+    Tiler tiler;
+    tiler.Divide(200, 150, 32, 32);
+    tiler.SetTileOrder(TILE_SPIRAL);
+    tiler.GenerateTiles(region);
+
+    TEST_INT(count_uncovered_pixels(tiler, region), 0);
+    TEST_INT(tiler.GetTile(0)->xmin, 96);
+    TEST_INT(tiler.GetTile(0)->ymin, 64);
+  }
+  {
+    Tiler tiler;
+    tiler.Divide(200, 150, 32, 32);
+    tiler.GenerateTiles(region);
+    tiler.SplitTailTiles(4);
+
+    TEST(tiler.GetTileCount() > 7 * 5);
+    TEST_INT(tiler.GetTile(tiler.GetTileCount() - 1)->id, tiler.GetTileCount() - 1);
+    TEST_INT(count_uncovered_pixels(tiler, region), 0);
+  }
+
+  printf("%s: %d/%d/%d: (FAIL/PASS/TOTAL)\n", __FILE__,
+      TestGetFailCount(), TestGetPassCount(), TestGetTotalCount());
+
+  return 0;
+}
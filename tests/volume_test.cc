@@ -0,0 +1,121 @@
+// Copyright (c) 2011-2016 Hiroshi Tsubokawa
+// See LICENSE and README
+
+#include "unit_test.h"
+#include "fj_volume_io.h"
+#include "fj_file_io.h"
+#include "fj_numeric.h"
+#include "fj_volume.h"
+#include "fj_box.h"
+#include <cstdio>
+
+using namespace fj;
+
+static void fill_volume(Volume &volume)
+{
+  volume.SetBounds(Box(Vector(-1, -1, -1), Vector(1, 1, 1)));
+  volume.Resize(10, 12, 9);
+
+  for (int k = 0; k < 9; k++) {
+    for (int j = 0; j < 12; j++) {
+      for (int i = 0; i < 10; i++) {
+        volume.SetValue(i, j, k, .01f * (i + j * k));
+      }
+    }
+  }
+}
+
+static float max_error(const Volume &a, const Volume &b)
+{
+  float err = 0;
+
+  for (int k = 0; k < 9; k++) {
+    for (int j = 0; j < 12; j++) {
+      for (int i = 0; i < 10; i++) {
+        err = Max(err, Abs(a.GetValue(i, j, k) - b.GetValue(i, j, k)));
+      }
+    }
+  }
+  return err;
+}
+
+int main()
+{
+  {
+    Volume src, half, byte;
+    fill_volume(src);
+    fill_volume(half);
+    fill_volume(byte);
+
+    half.SetVoxelFormat(VOXEL_HALF);
+    byte.SetVoxelFormat(VOXEL_BYTE);
+
+    TEST_INT(half.GetVoxelFormat(), VOXEL_HALF);
+    TEST_INT(byte.GetVoxelFormat(), VOXEL_BYTE);
+    TEST(max_error(src, half) < 1e-3);
+    TEST(max_error(src, byte) < 1.3 / 255);
+  }
+  {
+    Volume src, loaded;
+    fill_volume(src);
+    src.SetVoxelFormat(VOXEL_BYTE);
+
+    TEST(VolSaveFile(src, "volume_test.bin") == 0);
+    TEST(VolLoadFile(loaded, "volume_test.bin") == 0);
+
+    int xres, yres, zres;
+    loaded.GetResolution(&xres, &yres, &zres);
+    TEST_INT(xres, 10);
+    TEST_INT(yres, 12);
+    TEST_INT(zres, 9);
+    TEST_INT(loaded.GetVoxelFormat(), VOXEL_BYTE);
+    TEST(loaded.GetBounds().max.x == 1);
+    TEST(max_error(src, loaded) == 0);
+  }
+  {
+    // modifying a compact volume keeps the requested format
+    Volume volume;
+    fill_volume(volume);
+    volume.SetVoxelFormat(VOXEL_HALF);
+    volume.SetValue(0, 0, 0, 2);
+    volume.Compact();
+
+    TEST_INT(volume.GetVoxelFormat(), VOXEL_HALF);
+    TEST(volume.GetValue(0, 0, 0) == 2);
+  }
+  {
+    // both filters reproduce the bilinear field in the interior
+    Volume volume;
+    fill_volume(volume);
+
+    const VoxelBuffer &buffer = volume.buffer_;
+    const Vector P(4.3, 5.7, 4.1);
+    const float expected = .01f * ((P.x - .5) + (P.y - .5) * (P.z - .5));
+
+    TEST(Abs(buffer.SampleTrilinear(P) - expected) < 1e-5);
+    TEST(Abs(buffer.SampleTricubic(P) - expected) < 1e-5);
+    TEST(buffer.SampleNearest(P) == volume.GetValue(4, 5, 4));
+    TEST(buffer.SampleNearest(Vector(10, 12, 9)) == volume.GetValue(9, 11, 8));
+
+    volume.SetVoxelFormat(VOXEL_HALF);
+    TEST(Abs(buffer.SampleTrilinear(P) - expected) < 1e-3);
+  }
+  {
+    // headers of too many voxels are rejected before allocating them
+    const int32_t header[4] = {VOXEL_FLOAT, 65536, 65536, 65536};
+    FILE *file = fopen("volume_test.bin", "wb");
+    FjFile_WriteInt32(file, header, 4);
+    fclose(file);
+
+    VoxelBuffer buffer;
+    file = fopen("volume_test.bin", "rb");
+    TEST_INT(buffer.Read(file), -1);
+    fclose(file);
+    TEST(buffer.IsEmpty());
+  }
+
+  printf("%s: %d/%d/%d: (FAIL/PASS/TOTAL)\n", __FILE__,
+    TestGetFailCount(), TestGetPassCount(), TestGetTotalCount());
+
+  return 0;
+}
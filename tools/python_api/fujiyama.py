@@ -161,6 +161,14 @@ class SceneInterface:
 		cmd = 'SaveFrameBuffer %s %s' % (framebuffer, temp_filename)
 		self.commands.append(cmd)
 
+	def SaveVolume(self, volume, filename):
+		cmd = 'SaveVolume %s %s' % (volume, filename)
+		self.commands.append(cmd)
+
+	def LoadVolume(self, volume, filename):
+		cmd = 'LoadVolume %s %s' % (volume, filename)
+		self.commands.append(cmd)
+
 	def RunProcedure(self, procedure):
 		cmd = 'RunProcedure %s' % (procedure)
 		self.commands.append(cmd)
@@ -269,6 +277,10 @@ class SceneInterface:
 		cmd = 'AssignFrameBuffer %s %s' % (renderer, framebuffer)
 		self.commands.append(cmd)
 
+	def AssignAovFrameBuffer(self, renderer, aov_name, framebuffer):
+		cmd = 'AssignAovFrameBuffer %s %s %s' % (renderer, aov_name, framebuffer)
+		self.commands.append(cmd)
+
 	def AssignTurbulence(self, entry_name, prop_name, turbulence):
 		cmd = 'AssignTurbulence %s %s %s' % (entry_name, prop_name, turbulence)
 		self.commands.append(cmd)
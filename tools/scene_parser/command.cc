@@ -56,6 +56,30 @@ static CommandResult SaveFrameBuffer_run(const CommandArgument *args)
   return result;
 }
 
+/* SaveVolume */
+static const int SaveVolume_args[] = {
+  ARG_COMMAND_NAME,
+  ARG_ENTRY_ID,
+  ARG_FILE_PATH};
+static CommandResult SaveVolume_run(const CommandArgument *args)
+{
+  CommandResult result;
+  result.status = SiSaveVolume(args[1].id, args[2].str);
+  return result;
+}
+
+/* LoadVolume */
+static const int LoadVolume_args[] = {
+  ARG_COMMAND_NAME,
+  ARG_ENTRY_ID,
+  ARG_FILE_PATH};
+static CommandResult LoadVolume_run(const CommandArgument *args)
+{
+  CommandResult result;
+  result.status = SiLoadVolume(args[1].id, args[2].str);
+  return result;
+}
+
 /* AddObjectToGroup */
 static const int AddObjectToGroup_args[] = {
   ARG_COMMAND_NAME,
@@ -258,6 +282,19 @@ static CommandResult AssignFrameBuffer_run(const CommandArgument *args)
   return result;
 }
 
+/* AssignAovFrameBuffer */
+static const int AssignAovFrameBuffer_args[] = {
+  ARG_COMMAND_NAME,
+  ARG_ENTRY_ID,
+  ARG_PROPERTY_NAME,
+  ARG_ENTRY_ID};
+static CommandResult AssignAovFrameBuffer_run(const CommandArgument *args)
+{
+  CommandResult result;
+  result.status = SiAssignAovFrameBuffer(args[1].id, args[2].str, args[3].id);
+  return result;
+}
+
 /* AssignObjectGroup */
 static const int AssignObjectGroup_args[] = {
   ARG_COMMAND_NAME,
@@ -460,6 +497,8 @@ static const Command command_list[] = {
   REGISTER_COMMAND(RenderScene),
   REGISTER_COMMAND(RunProcedure),
   REGISTER_COMMAND(SaveFrameBuffer),
+  REGISTER_COMMAND(SaveVolume),
+  REGISTER_COMMAND(LoadVolume),
   REGISTER_COMMAND(AddObjectToGroup),
   REGISTER_COMMAND(NewObjectInstance),
   REGISTER_COMMAND(NewFrameBuffer),
@@ -476,6 +515,7 @@ static const Command command_list[] = {
   REGISTER_COMMAND(NewLight),
   REGISTER_COMMAND(NewMesh),
   REGISTER_COMMAND(AssignFrameBuffer),
+  REGISTER_COMMAND(AssignAovFrameBuffer),
   REGISTER_COMMAND(AssignObjectGroup),
   REGISTER_COMMAND(AssignTurbulence),
   REGISTER_COMMAND(AssignTexture),
@@ -303,6 +303,29 @@ static int symbol_to_number(CommandArgument *arg)
   // sampler type
   if (strcmp(str, "FIXED_GRID_SAMPER") == 0)     {arg->num = SI_FIXED_GRID_SAMPLER; return 1;}
   if (strcmp(str, "ADAPTIVE_GRID_SAMPLER") == 0) {arg->num = SI_ADAPTIVE_GRID_SAMPLER; return 1;}
+  if (strcmp(str, "VARIANCE_SAMPLER") == 0)      {arg->num = SI_VARIANCE_SAMPLER; return 1;}
+
+  // filter type
+  if (strcmp(str, "BOX_FILTER") == 0)             {arg->num = SI_BOX_FILTER; return 1;}
+  if (strcmp(str, "GAUSSIAN_FILTER") == 0)        {arg->num = SI_GAUSSIAN_FILTER; return 1;}
+  if (strcmp(str, "MITCHELL_FILTER") == 0)        {arg->num = SI_MITCHELL_FILTER; return 1;}
+  if (strcmp(str, "BLACKMAN_HARRIS_FILTER") == 0) {arg->num = SI_BLACKMAN_HARRIS_FILTER; return 1;}
+
+  // tile order
+  if (strcmp(str, "TILE_SCANLINE") == 0)   {arg->num = SI_TILE_SCANLINE; return 1;}
+  if (strcmp(str, "TILE_SPIRAL") == 0)     {arg->num = SI_TILE_SPIRAL; return 1;}
+  if (strcmp(str, "TILE_HILBERT") == 0)    {arg->num = SI_TILE_HILBERT; return 1;}
+  if (strcmp(str, "TILE_CENTER_OUT") == 0) {arg->num = SI_TILE_CENTER_OUT; return 1;}
+
+  // voxel format
+  if (strcmp(str, "VOXEL_FLOAT") == 0) {arg->num = SI_VOXEL_FLOAT; return 1;}
+  if (strcmp(str, "VOXEL_HALF") == 0)  {arg->num = SI_VOXEL_HALF; return 1;}
+  if (strcmp(str, "VOXEL_BYTE") == 0)  {arg->num = SI_VOXEL_BYTE; return 1;}
+
+  // volume filter
+  if (strcmp(str, "VOLUME_FILTER_NEAREST") == 0)   {arg->num = SI_VOLUME_FILTER_NEAREST; return 1;}
+  if (strcmp(str, "VOLUME_FILTER_TRILINEAR") == 0) {arg->num = SI_VOLUME_FILTER_TRILINEAR; return 1;}
+  if (strcmp(str, "VOLUME_FILTER_TRICUBIC") == 0)  {arg->num = SI_VOLUME_FILTER_TRICUBIC; return 1;}
 
   return 0;
 }